@@ -3,7 +3,7 @@
 #include <vector>
 #include "Vertex.h"
 #include "CommonTypes.h"
-#include "Shader.h"
+#include "Matrix.h"
 
 class Bezier
 {
@@ -11,11 +11,11 @@ private:
 	std::vector<Vertex> controlPoints; // Control points, what the user defined
 	std::vector<Vertex> generatedCurve; // That's the actual curve when the user's finished
 	std::vector<Vertex> convexHull;
+	// No GL objects here, finished curves are packed in the SceneRenderer's buffer
 
-	unsigned int controlVAO, curveVAO, hullVAO; // Vertex Array Object for saving VBO settings
-	unsigned int controlVBO, curveVBO, hullVBO; // Vertex Buffer Object for each drawn shape
-
-	bool buffersInitialized = false;
+	// Applied by the vertex shader while the curve is dragged (see Polygon.h)
+	Matrix3x3 modelMatrix;
+	bool hasModelMatrix = false;
 
 	float stepSize = 0.01f;
 	int algorithm = 0; // 0 = normal pascal, 1 = De Casteljau (iterative)
@@ -31,29 +31,28 @@ public:
 	//PolyType type; // Not sure this will be useful for now
 
 	Bezier();
-	Bezier(const Bezier& other); // Copy constructor
-	Bezier& operator=(const Bezier& other); // Assignment operator
-	~Bezier();
+	// No GL handles anymore, so copies and moves carry every field (settings included)
+	Bezier(const Bezier& other) = default;
+	Bezier& operator=(const Bezier& other) = default;
+	// Moving just hands over the points (vector growth relies on noexcept)
+	Bezier(Bezier&& other) noexcept = default;
+	Bezier& operator=(Bezier&& other) noexcept = default;
 
 	void addControlPoint(float x, float y);
 	void addControlPoint(Vertex vertex);
 
-	void updateBuffers();
-	const void drawControlPoints(Shader& shader) const;	
-	const void drawGeneratedCurve(Shader& shader) const;
-	const void drawControlPointsPreview(Shader& shader) const;
-	const void drawGeneratedCurvePreview(Shader& shader) const;
-	const void drawConvexHull(Shader& shader) const;
-
 	const std::vector<Vertex>& getControlPoints() const { return controlPoints; };
 	const std::vector<Vertex>& getGeneratedCurve() const { return generatedCurve; };
 	const std::vector<Vertex>& getConvexHull() const { return convexHull; };
 	void setControlPoints(std::vector<Vertex> controlPointsVector) { controlPoints = controlPointsVector; generateConvexHull(); };
+	// Moves a single point in place. Doesn't regenerate the hull, call generateConvexHull() when done
+	void setControlPoint(size_t index, const Vertex& vertex) { controlPoints[index] = vertex; };
 	void setConvexHull(std::vector<Vertex> newConvexHull) { convexHull = newConvexHull; };
 
 	void generateCurve(); // When control points are set, this will be called
 	const int getAlgorithm() const { return algorithm; };
 	void swapAlgorithm() { algorithm = algorithm == 0 ? 1 : 0; generateCurve(); };
+	void setAlgorithm(int newAlgorithm) { algorithm = newAlgorithm; }; // Doesn't regenerate, caller decides when
 
 	const float getStepSize() const { return stepSize; };
 	void setStepSize(float step) { stepSize = step; };
@@ -62,6 +61,11 @@ public:
 
 	const double getGenerationTime() const { return generationTime; };
 
+	// nullptr when there's no pending transformation (identity)
+	const Matrix3x3* getModelMatrix() const { return hasModelMatrix ? &modelMatrix : nullptr; };
+	void setModelMatrix(const Matrix3x3& matrix) { modelMatrix = matrix; hasModelMatrix = true; };
+	void resetModelMatrix() { modelMatrix = Matrix3x3(); hasModelMatrix = false; };
+
 	void duplicateControlPoint(int index);
 
 	void generateConvexHull();
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <vector>
+
+// Control points of (a piece of) a curve, in a fixed size array so subdividing never allocates.
+// tStart and tEnd are where this piece sits on the original curve.
+struct CurveSpan
+{
+    static const int maxPoints = 16;
+
+    Vertex points[maxPoints];
+    int count = 0;
+    float tStart = 0.0f;
+    float tEnd = 1.0f;
+};
+
+struct BezierHit
+{
+    Vertex point;
+    float t1; // Parameter on the first curve
+    float t2; // Parameter on the second curve
+};
+
+// Bézier / Bézier intersection, without recursion : pairs of curve pieces left to test go on an
+// explicit stack that is kept between calls. Two methods :
+// - midpoint subdivision : split both pieces in half until they're flat, then intersect them as segments
+// - Bézier clipping (Sederberg-Nishita) : cut away the parts of one curve that are outside the "fat line"
+//   around the other one. The intervals shrink quadratically near a crossing, so it needs far fewer steps
+// Doesn't know about the Bezier class, it only works on control points.
+class BezierIntersector
+{
+private:
+    struct Task
+    {
+        CurveSpan a;
+        CurveSpan b;
+        int depth;
+        bool clipFirst; // Bézier clipping alternates which curve gets clipped against the other
+    };
+
+    std::vector<Task> stack; // Reused, so once it has grown enough nothing gets allocated
+
+    float flatnessThreshold;
+    int maxDepth;
+    int method = 0; // 0 = midpoint subdivision, 1 = Bézier clipping
+    int lastIterations = 0;
+    bool lastTruncated = false;
+
+    // Starts from two pieces (keeping their parameter ranges), hits before firstHit are left alone
+    void intersectSpans(const CurveSpan& a, const CurveSpan& b, std::vector<BezierHit>& hits, size_t firstHit);
+    void intersectBySubdivision(std::vector<BezierHit>& hits, size_t firstHit);
+    void intersectByClipping(std::vector<BezierHit>& hits, size_t firstHit);
+    // Adds the hit unless one from this call is already there
+    static void addHit(std::vector<BezierHit>& hits, size_t firstHit, const BezierHit& hit);
+    // Treats both pieces as the segments between their end points, adds the hit if they cross
+    static void addSegmentHit(const CurveSpan& a, const CurveSpan& b, std::vector<BezierHit>& hits, size_t firstHit);
+
+    // Splits at t with De Casteljau, the pieces keep track of their parameter range
+    static void subdivide(const CurveSpan& curve, float t, CurveSpan& left, CurveSpan& right);
+    // Max distance from the inner control points to the line between the end points
+    static float flatness(const CurveSpan& curve);
+    // SAT on the convex hulls of both control polygons
+    static bool hullsOverlap(const CurveSpan& a, const CurveSpan& b);
+    // Part [tMin, tMax] of curve (in its own 0..1 parameter) that can be inside the fat line of other.
+    // Returns 0 if there's none, 1 if found, 2 if other's end points are the same (no line to build)
+    static int fatLineInterval(const CurveSpan& curve, const CurveSpan& other, float& tMin, float& tMax);
+    // Splits where x or y change direction. Each piece is then monotone on both axes, so it can't cross
+    // itself. pieces needs room for 2 * CurveSpan::maxPoints. Returns the number of pieces
+    static int splitMonotone(const CurveSpan& curve, CurveSpan* pieces);
+    // Largest distance from the first control point, to know when a piece has become a point
+    static float extent(const CurveSpan& curve);
+
+public:
+    BezierIntersector(float flatnessThreshold = 0.005f, int maxDepth = 10)
+        : flatnessThreshold(flatnessThreshold), maxDepth(maxDepth) {};
+
+    void setMethod(int newMethod) { method = newMethod; };
+    int getMethod() const { return method; };
+    // Pieces tested (hull or fat line) during the last call, for comparing both methods
+    int getLastIterations() const { return lastIterations; };
+    // Bézier clipping ran out of iterations during the last call (tangent curves). What was left got
+    // intersected as segments instead, so the hits near the tangency are only approximate
+    bool wasLastTruncated() const { return lastTruncated; };
+
+    static bool canHandle(int controlPointCount) { return controlPointCount >= 2 && controlPointCount <= CurveSpan::maxPoints; };
+
+    // Appends every crossing between the two curves to hits (not cleared, so the caller can reuse it).
+    // Returns false without doing anything if one of the curves has too many control points.
+    bool intersect(const Vertex* pointsA, int countA, const Vertex* pointsB, int countB, std::vector<BezierHit>& hits);
+    bool intersect(const std::vector<Vertex>& pointsA, const std::vector<Vertex>& pointsB, std::vector<BezierHit>& hits)
+    {
+        return intersect(pointsA.data(), static_cast<int>(pointsA.size()), pointsB.data(), static_cast<int>(pointsB.size()), hits);
+    };
+
+    // Same thing for a curve with itself, t1 and t2 are both on that curve (t1 < t2)
+    bool selfIntersect(const Vertex* points, int count, std::vector<BezierHit>& hits);
+    bool selfIntersect(const std::vector<Vertex>& points, std::vector<BezierHit>& hits)
+    {
+        return selfIntersect(points.data(), static_cast<int>(points.size()), hits);
+    };
+};
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "Polygon.h"
 
+// Only geometry, nothing here touches OpenGL : callers upload the results they draw
 namespace Clipper
 {
 	Polygon clipPolygonCyrusBeck(const Polygon& subject, const Polygon& windowPolygon);
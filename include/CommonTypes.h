@@ -24,4 +24,14 @@ enum ShapeType {
     SHAPE_POLYGON,
     SHAPE_BEZIER,
     SHAPE_BEZIER_SEQUENCE
+};
+
+// For arrays with one entry per shape type
+const int SHAPE_TYPE_COUNT = 3;
+
+// A finished shape, the index is the one in PolyBuilder's list of that type
+struct ShapeRef
+{
+    ShapeType type;
+    int index;
 };
\ No newline at end of file
@@ -5,44 +5,101 @@
 
 #include <vector>
 
+// A curve changed by the last constraint pass, with its control points from before the pass
+struct CurveEdit
+{
+    size_t index;
+    Vertex before[4];
+};
+
 class CubicBezierSequence {
 private:
     std::vector<Bezier> curves;
-    int continuityType = 0; // 0 for C0, 1 for C1, 2 for C2
+    int continuityType = 0; // 0 for C0, 1 for C1, 2 for C2, 3 for C2 solved over the whole sequence
     float stepSize = 0.01f;
     int algorithm = 0; // 0 for pascal, 1 for de casteljau
     double generationTime;
     bool isClosed = false;
 
+    // Applied by the vertex shader while the sequence is dragged (see Polygon.h)
+    Matrix3x3 modelMatrix;
+    bool hasModelMatrix = false;
+
+    // Curves whose control points moved since the last flush (kept around to avoid reallocating).
+    // markDirty is called before the points change, so the first entry of a curve has its old points
+    std::vector<CurveEdit> dirtyCurves;
+    // What the last flush regenerated, sorted by curve index
+    std::vector<CurveEdit> changedCurves;
+    void markDirty(size_t curveIndex);
+    // Sets a single control point, marking the curve dirty only if it actually moved
+    void setCurvePoint(size_t curveIndex, int pointIndex, const Vertex& point);
+    // Regenerates hull and curve of every dirty curve, they become the changed curves
+    void flushDirtyCurves();
+
+    // Applies the constraints of curve i - 1 onto curve i. Returns false if they were already satisfied
+    bool enforceJunction(size_t i);
+    // Applies the first curve's constraints onto the end of the last curve (closed sequences)
+    bool enforceClosure();
+    // Places every P1 and P2 so the whole sequence is C2, in one (cyclic if closed) tridiagonal solve
+    void solveGlobalC2();
+
 public:
     CubicBezierSequence(int continuityType = 0, float stepSize = 0.01f, int algorithm = 0)
         : continuityType(continuityType), stepSize(stepSize), algorithm(algorithm) {};
 
-    ~CubicBezierSequence();
+    CubicBezierSequence(const CubicBezierSequence& other);
     CubicBezierSequence& operator=(const CubicBezierSequence& other);
+    CubicBezierSequence(CubicBezierSequence&& other) noexcept = default;
+    CubicBezierSequence& operator=(CubicBezierSequence&& other) noexcept = default;
 
-    // Add a new curve to the sequence
+    // Add a new curve to the sequence. It's generated by the next constraint pass (enforceConstraints...)
     void addCurve(const Bezier& curve);
+    // Replaces the curves with the points as they are (4 per curve, saved or imported ones) : no constraint
+    // is applied and nothing is generated, call regenerateCurves() once afterwards
+    void loadControlPoints(const Vertex* first, const Vertex* last, bool closed);
 
     std::vector<Bezier>& getCurves() { return curves; };
-    std::vector<Bezier> getCurves() const { return curves; };
+    const std::vector<Bezier>& getCurves() const { return curves; };
     int getNumberOfCurves() const { return curves.size(); };
     float getStepSize() const { return stepSize; };
     int getAlgorithm() const { return algorithm; };
     bool getIsClosed() const { return isClosed; };
 
+    // nullptr when there's no pending transformation (identity)
+    const Matrix3x3* getModelMatrix() const { return hasModelMatrix ? &modelMatrix : nullptr; };
+    void setModelMatrix(const Matrix3x3& matrix) { modelMatrix = matrix; hasModelMatrix = true; };
+    void resetModelMatrix() { modelMatrix = Matrix3x3(); hasModelMatrix = false; };
+
     void incrementStepSize();
     void decrementStepSize();
     void swapAlgorithm();
-    
+    void setStepSize(float step) { stepSize = step; };
+
+    // Regenerates every curve with the sequence's step size and algorithm on the worker pool.
+    // generationTime becomes the wall time of the whole batch.
+    void regenerateCurves();
+
+    // Sums the generation time of each curve (when they were generated one by one)
     void calculateGenerationTime();
     double getGenerationTime() const { return generationTime; };
 
     // Enforce continuity constraints on all curves
     void enforceConstraints();
+    // Only propagates from the edited curve onwards, stopping at the first junction already satisfied
+    void enforceConstraintsFrom(int editedCurveIndex);
+
+    // Moves one control point and propagates constraints from its curve (for vertex dragging).
+    // Returns the curves that changed (sorted, with their old points), valid until the next edit
+    const std::vector<CurveEdit>& moveControlPoint(int curveIndex, int pointIndex, const Vertex& position);
+    // Puts back the control points of some curves as they are (4 per curve, in the order of curveIndices),
+    // without applying any constraint : they were consistent when recorded. Only those curves are regenerated
+    void setCurvesControlPoints(const std::vector<size_t>& curveIndices, const std::vector<Vertex>& points);
+    // Replaces every control point (4 per curve), adding or removing curves to match, then enforces
+    // the constraints. For undo and point deletion, which can change the number of curves
+    void setControlPoints(const std::vector<Vertex>& points);
 
     int getContinuityType() const { return continuityType; };
-    // Set the continuity type (0=C0, 1=C1, 2=C2)
+    // Set the continuity type (0=C0, 1=C1, 2=C2, 3=global C2)
     void setContinuityType(int type);
 
     // Returns false if the point can be moved, considering current continuity type
@@ -51,9 +108,4 @@ public:
     // Functions for making closed curves
     void makeClosed();
     bool shouldBeClosed() const;
-
-    // Draw all curves
-    void draw(Shader& shader) const;
-
-    void drawPreview(Shader& shader) const;
 };
\ No newline at end of file
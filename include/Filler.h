@@ -1,5 +1,6 @@
 #pragma once
 #include "Polygon.h"
+#include <cstdint>
 #include <vector>
 
 struct Edge {
@@ -41,6 +42,7 @@ public:
 	static const int FILL_LCA = 1;
 	static const int FILL_SEED = 2;
 	static const int FILL_SEED_RECURSIVE = 3;
+	static const int FILL_COVERAGE = 4;
 
 	// Get/set the selected fill algorithm
 	static int getSelectedAlgorithm() { return selectedAlgorithm; }
@@ -49,6 +51,10 @@ public:
 	// Initialize the filler with screen dimensions
 	static void init(int width, int height);
 
+	// Size of the pixel grid the fill points are on
+	static int getScreenWidth() { return screenWidth; }
+	static int getScreenHeight() { return screenHeight; }
+
 	// Set the fill color
 	static void setFillColor(float r, float g, float b, float a);
 
@@ -64,6 +70,11 @@ public:
 	// Fill a polygon using the LCA algorithm (Liste des Cts Actifs)
 	static std::vector<Vertex> fillPolygonLCA(const Polygon& polygon);
 
+	// Anti-aliased fill : signed area accumulated per pixel like font rasterizers do, one pass over the
+	// edges then one over the bounds. Every pixel the polygon touches gets a point, and coverage gets how
+	// much of it is inside (255 = all of it). Non-zero winding
+	static std::vector<Vertex> fillPolygonCoverage(const Polygon& polygon, std::vector<uint8_t>& coverage);
+
 	// Seed-based filling (stack)
 	// AKA "Algorithme  germes version piles"
 	static std::vector<Vertex> fillFromSeed(const Polygon& polygon, float seedX, float seedY);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// Owns one OpenGL object and deletes it when it goes away.
+// Can't be copied (two owners would delete the same name), only moved : the moved-from one is left
+// empty so nothing gets deleted twice. Empty means 0, same as OpenGL's "no object".
+template <typename Traits>
+class GLResource
+{
+private:
+    unsigned int id = 0;
+
+public:
+    GLResource() {};
+    ~GLResource() { reset(); };
+
+    GLResource(const GLResource&) = delete;
+    GLResource& operator=(const GLResource&) = delete;
+
+    GLResource(GLResource&& other) noexcept : id(other.id) { other.id = 0; };
+    GLResource& operator=(GLResource&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+            id = other.id;
+            other.id = 0;
+        }
+        return *this;
+    };
+
+    // Generates the object if there isn't one yet
+    void create() { if (id == 0) Traits::generate(id); };
+    // Deletes the object, the wrapper is empty again
+    void reset()
+    {
+        if (id != 0)
+        {
+            Traits::destroy(id);
+            id = 0;
+        }
+    };
+
+    unsigned int get() const { return id; };
+    bool isCreated() const { return id != 0; };
+};
+
+struct GLBufferTraits
+{
+    static void generate(unsigned int& id) { glGenBuffers(1, &id); };
+    static void destroy(unsigned int& id) { glDeleteBuffers(1, &id); };
+};
+
+struct GLVertexArrayTraits
+{
+    static void generate(unsigned int& id) { glGenVertexArrays(1, &id); };
+    static void destroy(unsigned int& id) { glDeleteVertexArrays(1, &id); };
+};
+
+using GLBuffer = GLResource<GLBufferTraits>;
+using GLVertexArray = GLResource<GLVertexArrayTraits>;
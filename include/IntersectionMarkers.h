@@ -2,86 +2,114 @@
 
 #include "Vertex.h"
 #include "Shader.h"
+#include "GLResource.h"
 
+#include <algorithm>
 #include <vector>
 #include <glad/glad.h>
 
+// Red crosses on intersections, drawn with a single instanced draw call :
+// the cross shape is in one buffer and each marker is just a position in a per-instance buffer.
+// Needs the marker shader (shaders/vertex_marker.glsl), which adds the instance position.
+// Owns its GL objects, so it can be moved but not copied : read it through a reference.
 class IntersectionMarkers {
 private:
     std::vector<Vertex> points;
-    unsigned int vao, vbo;
+    GLVertexArray vao;
+    GLBuffer shapeVbo, instanceVbo;
+    size_t instanceCapacity = 0; // Positions the instance buffer can hold before growing
     float markerSize;
-    bool buffersInitialized;
 
-public:
-    IntersectionMarkers(float size = 0.01f) :
-        markerSize(size), buffersInitialized(false) {}
+    void initBuffers() {
+        vao.create();
+        shapeVbo.create();
+        instanceVbo.create();
 
-    ~IntersectionMarkers() {
-        if (buffersInitialized) {
-            glDeleteVertexArrays(1, &vao);
-            glDeleteBuffers(1, &vbo);
-        }
+        // Horizontal line then vertical line, centered on 0
+        Vertex cross[4] = {
+            { -markerSize, 0.0f }, { markerSize, 0.0f },
+            { 0.0f, -markerSize }, { 0.0f, markerSize }
+        };
+
+        glBindVertexArray(vao.get());
+
+        glBindBuffer(GL_ARRAY_BUFFER, shapeVbo.get());
+        glBufferData(GL_ARRAY_BUFFER, sizeof(cross), cross, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        // Attribute 1 moves to the next position once per instance instead of once per vertex
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribDivisor(1, 1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
     }
 
+public:
+    IntersectionMarkers(float size = 0.01f) :
+        markerSize(size) {}
+
     void addPoint(const Vertex& point) {
         points.push_back(point);
+
+        // Room left : only the new position gets uploaded
+        if (vao.isCreated() && points.size() <= instanceCapacity) {
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
+            glBufferSubData(GL_ARRAY_BUFFER, (points.size() - 1) * sizeof(Vertex), sizeof(Vertex), &points.back());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            return;
+        }
+
         updateBuffers();
     }
 
     void clear() {
+        // The buffer keeps its size, we just draw no instance
         points.clear();
-        updateBuffers();
+    }
+
+    size_t size() const { return points.size(); }
+
+    // Deletes the GL objects now (they're created again if needed). For owners that outlive the context
+    void releaseGL() {
+        vao.reset();
+        shapeVbo.reset();
+        instanceVbo.reset();
+        instanceCapacity = 0;
     }
 
     void updateBuffers() {
         // Initialize buffers if needed
-        if (!buffersInitialized) {
-            glGenVertexArrays(1, &vao);
-            glGenBuffers(1, &vbo);
-            buffersInitialized = true;
-        }
+        if (!vao.isCreated())
+            initBuffers();
+
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVbo.get());
 
-        // If there are no points, we're done
-        if (points.empty()) return;
-
-        // Create vertices for crosses (4 vertices per point)
-        std::vector<Vertex> crossVertices;
-        for (const auto& point : points) {
-            // Horizontal line
-            crossVertices.push_back({ point.x - markerSize, point.y });
-            crossVertices.push_back({ point.x + markerSize, point.y });
-            // Vertical line
-            crossVertices.push_back({ point.x, point.y - markerSize });
-            crossVertices.push_back({ point.x, point.y + markerSize });
+        // Doubling keeps adding points O(1) on average
+        if (points.size() > instanceCapacity) {
+            instanceCapacity = std::max<size_t>(64, std::max(points.size(), instanceCapacity * 2));
+            glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
         }
 
-        // Update buffer data
-        glBindVertexArray(vao);
-        glBindBuffer(GL_ARRAY_BUFFER, vbo);
-        glBufferData(GL_ARRAY_BUFFER, crossVertices.size() * sizeof(Vertex),
-            crossVertices.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
+        if (!points.empty())
+            glBufferSubData(GL_ARRAY_BUFFER, 0, points.size() * sizeof(Vertex), points.data());
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
     }
 
     void draw(Shader& shader) const {
-        if (points.empty() || !buffersInitialized) return;
+        if (points.empty() || !vao.isCreated()) return;
 
         shader.use();
-        shader.setColor("uColor", 1.0f, 0.0f, 0.0f, 1.0f);
+        shader.setColor(shader.getUniformLocation("uColor"), 1.0f, 0.0f, 0.0f, 1.0f);
 
-        glBindVertexArray(vao);
-        // Draw pairs of vertices as lines
-        for (int i = 0; i < points.size(); i++) {
-            glDrawArrays(GL_LINES, i * 4, 2);     // Horizontal line
-            glDrawArrays(GL_LINES, i * 4 + 2, 2); // Vertical line
-        }
+        glBindVertexArray(vao.get());
+        // 4 vertices (2 lines) per cross, one cross per point
+        glDrawArraysInstanced(GL_LINES, 0, 4, static_cast<GLsizei>(points.size()));
 
         glBindVertexArray(0); // Unbind to prevent side effects
     }
-};
\ No newline at end of file
+};
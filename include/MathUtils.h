@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Vertex.h"
+#include "Matrix.h"
+
+#include <cstddef>
+#include <vector>
 
 namespace MathUtils
 {
@@ -30,4 +34,26 @@ namespace MathUtils
     // Returns true if two line segments intersect, and intersection point gets set
     bool lineSegmentsIntersect(const Vertex& segmentA_start, const Vertex& segmentA_end,
         const Vertex& segmentB_start, const Vertex& segmentB_end, Vertex& intersectionPoint);
+    // Convex hull with Andrew's monotone chain, O(n log n). Hull is counter clockwise, without collinear points.
+    // Sorts points in place and writes the hull in hull, which needs room for 2 * count vertices. Returns the hull size
+    int monotoneChainHull(Vertex* points, int count, Vertex* hull);
+    std::vector<Vertex> monotoneChainHull(const std::vector<Vertex>& points);
+    // Adds a point to a hull made by monotoneChainHull in O(h), instead of rebuilding it
+    void insertIntoConvexHull(std::vector<Vertex>& hull, const Vertex& point);
+    // Solves a tridiagonal system (Thomas algorithm) in O(n). Coefficients are scalars, the right hand side
+    // is a vertex so x and y get solved together. lower[0] and upper[n - 1] aren't used.
+    // Returns an empty vector if the system can't be solved
+    std::vector<Vertex> solveTridiagonal(const std::vector<float>& lower, const std::vector<float>& diagonal,
+        const std::vector<float>& upper, const std::vector<Vertex>& rhs);
+    // Same thing for a cyclic system (closed splines) : lower[0] is the top right corner, upper[n - 1]
+    // the bottom left one. Sherman-Morrison brings it back to two tridiagonal solves. Needs n >= 3
+    std::vector<Vertex> solveCyclicTridiagonal(const std::vector<float>& lower, const std::vector<float>& diagonal,
+        const std::vector<float>& upper, const std::vector<Vertex>& rhs);
+    // Transforms count vertices from in to out (which can be the same array). Uses SSE (2 vertices at a time),
+    // or AVX (4) when the compiler targets it, then finishes the remaining ones one by one
+    void transformVertices(const Affine2x3& transform, const Vertex* in, Vertex* out, size_t count);
+    void transformVertices(const Matrix3x3& matrix, const Vertex* in, Vertex* out, size_t count);
+    // Same thing in place for points stored as separate x and y arrays. No shuffling needed there,
+    // x' = a x + b y + tx for 4 (SSE) or 8 (AVX) points at a time
+    void transformPoints(const Affine2x3& transform, float* xs, float* ys, size_t count);
 }
\ No newline at end of file
@@ -12,39 +12,42 @@ struct Matrix3x3
 {
 	float elements[3][3];
 
-	Matrix3x3()
-	{
-		for (int i = 0; i < 3; i++)
-		{
-			for (int j = 0; j < 3; j++)
-			{
-				elements[i][j] = (i == j) ? 1.0f : 0.0f;
-			}
-		}
-	}
+	// Identity
+	constexpr Matrix3x3() : elements{ { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } } {}
 
-	Matrix3x3 operator*(const Matrix3x3 other) const
-	{
-		Matrix3x3 result;
-
-		for (int i = 0; i < 3; i++)
-		{
-			for (int j = 0; j < 3; j++)
-			{
-				// Initialize to 0! if not the 3rd component jumps up to 3.0 when multiplying because result is identity by default
-				result.elements[i][j] = 0.0f;
-				for (int k = 0; k < 3; k++)
-				{
-					result.elements[i][j] += elements[i][k] * other.elements[k][j];
-				}
-			}
-		}
+	constexpr Matrix3x3(float e00, float e01, float e02, float e10, float e11, float e12, float e20, float e21, float e22) :
+		elements{ { e00, e01, e02 }, { e10, e11, e12 }, { e20, e21, e22 } } {}
 
-		return result;
+	// Written out instead of the triple loop : no loop counters, and the compiler sees every product
+	constexpr Matrix3x3 operator*(const Matrix3x3& other) const
+	{
+		const auto& m = elements;
+		const auto& o = other.elements;
+		return Matrix3x3(
+			m[0][0] * o[0][0] + m[0][1] * o[1][0] + m[0][2] * o[2][0],
+			m[0][0] * o[0][1] + m[0][1] * o[1][1] + m[0][2] * o[2][1],
+			m[0][0] * o[0][2] + m[0][1] * o[1][2] + m[0][2] * o[2][2],
+			m[1][0] * o[0][0] + m[1][1] * o[1][0] + m[1][2] * o[2][0],
+			m[1][0] * o[0][1] + m[1][1] * o[1][1] + m[1][2] * o[2][1],
+			m[1][0] * o[0][2] + m[1][1] * o[1][2] + m[1][2] * o[2][2],
+			m[2][0] * o[0][0] + m[2][1] * o[1][0] + m[2][2] * o[2][0],
+			m[2][0] * o[0][1] + m[2][1] * o[1][1] + m[2][2] * o[2][1],
+			m[2][0] * o[0][2] + m[2][1] * o[1][2] + m[2][2] * o[2][2]);
 	}
 };
 
-inline Matrix3x3 createTranslationMatrix(float tx, float ty)
+// Sine and cosine of the same angle in one call where the compiler has it
+inline void sinCos(float angle, float& sine, float& cosine)
+{
+#if defined(__GNUC__)
+	__builtin_sincosf(angle, &sine, &cosine);
+#else
+	sine = std::sin(angle);
+	cosine = std::cos(angle);
+#endif
+}
+
+constexpr Matrix3x3 createTranslationMatrix(float tx, float ty)
 {
 	Matrix3x3 outMatrix;
 
@@ -59,15 +62,17 @@ inline Matrix3x3 createRotationMatrix(float angle)
 {
 	Matrix3x3 outMatrix;
 
-	outMatrix.elements[0][0] = cos(angle); // first row first column
-	outMatrix.elements[0][1] = -sin(angle); // first row second column
-	outMatrix.elements[1][0] = sin(angle); // second row first column
-	outMatrix.elements[1][1] = cos(angle); // second row second column
+	float sine, cosine;
+	sinCos(angle, sine, cosine);
+	outMatrix.elements[0][0] = cosine; // first row first column
+	outMatrix.elements[0][1] = -sine; // first row second column
+	outMatrix.elements[1][0] = sine; // second row first column
+	outMatrix.elements[1][1] = cosine; // second row second column
 
 	return outMatrix;
 }
 
-inline Matrix3x3 createScalingMatrix(float sx, float sy)
+constexpr Matrix3x3 createScalingMatrix(float sx, float sy)
 {
 	Matrix3x3 outMatrix;
 
@@ -77,7 +82,7 @@ inline Matrix3x3 createScalingMatrix(float sx, float sy)
 	return outMatrix;
 }
 
-inline Matrix3x3 createShearingMatrix(float shx, float shy)
+constexpr Matrix3x3 createShearingMatrix(float shx, float shy)
 {
 	Matrix3x3 outMatrix;
 
@@ -88,7 +93,7 @@ inline Matrix3x3 createShearingMatrix(float shx, float shy)
 }
 
 // With implicit w = 1
-inline Vertex multiplyMatrixVertex(const Matrix3x3 matrix, const Vertex& inVertex)
+inline Vertex multiplyMatrixVertex(const Matrix3x3& matrix, const Vertex& inVertex)
 {
 	Vertex outVertex;
 
@@ -96,4 +101,93 @@ inline Vertex multiplyMatrixVertex(const Matrix3x3 matrix, const Vertex& inVerte
 	outVertex.y = matrix.elements[1][0] * inVertex.x + matrix.elements[1][1] * inVertex.y + matrix.elements[1][2] * 1.0f;
 
 	return outVertex;
-}
\ No newline at end of file
+}
+
+// The third row of our transformation matrices is always 0 0 1, so this only keeps the first two.
+// 6 floats instead of 9, and transforming a point is 4 multiplications and 4 additions.
+// Everything but the rotations is constexpr, and the "about" functions give directly what
+// translate to origin * transformation * translate back would, without the two extra products
+struct Affine2x3
+{
+	float a, b, tx; // First row
+	float c, d, ty; // Second row
+
+	constexpr Affine2x3() : a(1.0f), b(0.0f), tx(0.0f), c(0.0f), d(1.0f), ty(0.0f) {}
+
+	constexpr Affine2x3(float a, float b, float tx, float c, float d, float ty) :
+		a(a), b(b), tx(tx), c(c), d(d), ty(ty) {}
+
+	explicit constexpr Affine2x3(const Matrix3x3& matrix) :
+		a(matrix.elements[0][0]), b(matrix.elements[0][1]), tx(matrix.elements[0][2]),
+		c(matrix.elements[1][0]), d(matrix.elements[1][1]), ty(matrix.elements[1][2]) {}
+
+	constexpr Matrix3x3 toMatrix() const
+	{
+		return Matrix3x3(a, b, tx, c, d, ty, 0.0f, 0.0f, 1.0f);
+	}
+
+	// this * other : other is applied first
+	constexpr Affine2x3 operator*(const Affine2x3& other) const
+	{
+		return Affine2x3(
+			a * other.a + b * other.c, a * other.b + b * other.d, a * other.tx + b * other.ty + tx,
+			c * other.a + d * other.c, c * other.b + d * other.d, c * other.tx + d * other.ty + ty);
+	}
+
+	constexpr Vertex apply(const Vertex& vertex) const
+	{
+		return Vertex(a * vertex.x + b * vertex.y + tx, c * vertex.x + d * vertex.y + ty);
+	}
+
+	constexpr float determinant() const { return a * d - b * c; }
+
+	// Undoes this transformation, only means something when the determinant isn't 0
+	constexpr Affine2x3 inverse() const
+	{
+		float inverseDeterminant = 1.0f / determinant();
+		float ia = d * inverseDeterminant, ib = -b * inverseDeterminant;
+		float ic = -c * inverseDeterminant, id = a * inverseDeterminant;
+		return Affine2x3(ia, ib, -(ia * tx + ib * ty), ic, id, -(ic * tx + id * ty));
+	}
+
+	constexpr bool isIdentity() const
+	{
+		return a == 1.0f && b == 0.0f && tx == 0.0f && c == 0.0f && d == 1.0f && ty == 0.0f;
+	}
+
+	static constexpr Affine2x3 translation(float x, float y) { return Affine2x3(1.0f, 0.0f, x, 0.0f, 1.0f, y); }
+	static constexpr Affine2x3 scaling(float sx, float sy) { return Affine2x3(sx, 0.0f, 0.0f, 0.0f, sy, 0.0f); }
+	static constexpr Affine2x3 shearing(float shx, float shy) { return Affine2x3(1.0f, shx, 0.0f, shy, 1.0f, 0.0f); }
+	// From an already computed sine and cosine
+	static constexpr Affine2x3 rotation(float sine, float cosine) { return Affine2x3(cosine, -sine, 0.0f, sine, cosine, 0.0f); }
+	static Affine2x3 rotation(float angle)
+	{
+		float sine, cosine;
+		sinCos(angle, sine, cosine);
+		return rotation(sine, cosine);
+	}
+
+	// The linear part of transform applied around pivot instead of around the origin :
+	// x' = L (x - p) + p, so the translation is p - L p
+	static constexpr Affine2x3 about(const Affine2x3& linear, const Vertex& pivot)
+	{
+		return Affine2x3(
+			linear.a, linear.b, pivot.x - (linear.a * pivot.x + linear.b * pivot.y),
+			linear.c, linear.d, pivot.y - (linear.c * pivot.x + linear.d * pivot.y));
+	}
+	static constexpr Affine2x3 scalingAbout(float sx, float sy, const Vertex& pivot) { return about(scaling(sx, sy), pivot); }
+	static constexpr Affine2x3 shearingAbout(float shx, float shy, const Vertex& pivot) { return about(shearing(shx, shy), pivot); }
+	static Affine2x3 rotationAbout(float angle, const Vertex& pivot) { return about(rotation(angle), pivot); }
+
+	// Scale, then rotate, both around pivot, then translate : the usual TRS in one go
+	static Affine2x3 translateRotateScale(const Vertex& translation, float angle, float sx, float sy, const Vertex& pivot)
+	{
+		float sine, cosine;
+		sinCos(angle, sine, cosine);
+		Affine2x3 linear(cosine * sx, -sine * sy, 0.0f, sine * sx, cosine * sy, 0.0f);
+		Affine2x3 result = about(linear, pivot);
+		result.tx += translation.x;
+		result.ty += translation.y;
+		return result;
+	}
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
 #include "CommonTypes.h"
@@ -8,12 +9,15 @@
 #include "CubicBezierSequence.h"
 #include "Matrix.h"
 #include "IntersectionMarkers.h"
+#include "BezierIntersector.h"
+#include "UndoJournal.h"
 
 // For storing filled polygons
 struct FilledPolygon
 {
     Polygon polygon;       // The original polygon
     std::vector<Vertex> fillPoints; // The points to fill
+    std::vector<uint8_t> coverage;  // One per fill point (255 = fully inside), empty when all of them are
     float colorR, colorG, colorB, colorA; // Fill color
     unsigned int vao, vbo; // OpenGL handles for the fill points
 
@@ -23,10 +27,24 @@ struct FilledPolygon
     {}
 };
 
-// Struct for sequences transformation
-// Allows for "easy" mapping of transformed vertices from all the curves of a sequence
-struct SequenceTransformData {
-    std::vector<std::vector<Vertex>> originalCurvePoints;
+// What happened to the finished shapes since the renderer last looked, so it only re-uploads those.
+// Inserted and removed shift the later shapes of that type like in a vector
+struct SceneChange
+{
+    enum Kind
+    {
+        INSERTED,
+        UPDATED,      // Points, curves or display settings changed
+        REMOVED,
+        CLEARED,      // Every shape of that type is gone (index unused)
+        MODEL_MATRIX  // The shape got or lost its model matrix
+    };
+
+    Kind kind;
+    ShapeRef shape;
+    // UPDATED of a sequence : only curves firstCurve to firstCurve + curveCount - 1 changed (0 for the whole shape)
+    int firstCurve = 0;
+    int curveCount = 0;
 };
 
 class PolyBuilder
@@ -49,17 +67,121 @@ private:
     int continuityType = 0;    
     std::vector<CubicBezierSequence> finishedSequences;
 
-    Vertex calculateCenter(const std::vector<Vertex>& vertices);
-
-    std::vector<Vertex> transformOriginalVertices;
-    SequenceTransformData sequenceTransformData;
+    float globalStepSize = 0.01f;
+    double lastRegenerationTime = 0.0;
+
+    // Calls visit(points, count, firstVertexIndex) on each run of the shape's editable points, read where
+    // the shape keeps them : the vertices, the control points, or one run per curve of a sequence.
+    // Picking, bounds and transforms go through this instead of switching on the type themselves
+    template <typename Visit>
+    void visitShapePoints(ShapeRef shape, Visit&& visit) const
+    {
+        switch (shape.type)
+        {
+        case SHAPE_POLYGON:
+        {
+            const std::vector<Vertex>& vertices = finishedPolygons[shape.index].getVertices();
+            visit(vertices.data(), vertices.size(), 0);
+            break;
+        }
+        case SHAPE_BEZIER:
+        {
+            const std::vector<Vertex>& controlPoints = finishedBeziers[shape.index].getControlPoints();
+            visit(controlPoints.data(), controlPoints.size(), 0);
+            break;
+        }
+        case SHAPE_BEZIER_SEQUENCE:
+        {
+            int first = 0;
+            for (const Bezier& curve : finishedSequences[shape.index].getCurves())
+            {
+                visit(curve.getControlPoints().data(), curve.getControlPoints().size(), first);
+                first += static_cast<int>(curve.getControlPoints().size());
+            }
+            break;
+        }
+        }
+    }
+    // Every editable point of the shape in one list (sequences : 4 control points per curve)
+    void gatherShapePoints(ShapeRef shape, std::vector<Vertex>& points) const;
+    // Gives the shape new points and regenerates its curves
+    void setShapePoints(ShapeRef shape, const std::vector<Vertex>& points);
+    // Takes the shape out of the scene, or puts it back at its index
+    ShapeObject takeShape(ShapeRef shape);
+    void putShape(ShapeRef shape, ShapeObject&& object);
+    // nullptr goes back to no model matrix
+    void setModelMatrixOf(ShapeRef shape, const Matrix3x3* matrix);
+
+    // Every change to the finished shapes since the renderer's last update
+    std::vector<SceneChange> sceneChanges;
+    void noteSceneChange(SceneChange::Kind kind, ShapeRef shape) { sceneChanges.push_back({ kind, shape }); };
+    // One UPDATED per run of consecutive curves (sorted indices), so only those get uploaded again
+    void noteCurvesChanged(ShapeRef shape, const std::vector<size_t>& curveIndices);
+
+    // Shape being dragged : its vertices don't change until the drag ends, the shader applies transformMatrix
+    int transformShapeIndex = -1;
+    ShapeType transformShapeType = SHAPE_POLYGON;
+    Vertex transformCenter;
+    Matrix3x3 transformMatrix;
     bool isCurrentlyTransformingShape = false;
+    // Gives the shape being dragged its model matrix
+    void setShapeModelMatrix(const Matrix3x3& matrix);
+    // Rewrites the shape's vertices (regenerating curves)
+    void applyAffineToShape(ShapeRef shape, const Affine2x3& transform);
+
+    // Every change to the finished shapes goes in there, see undo() and redo()
+    UndoJournal journal;
+    // These do the change and record it
+    void transformShape(ShapeRef shape, const Affine2x3& transform);
+    void removeShape(ShapeRef shape);
+    // For a shape that was just pushed at the end of its list
+    void addShape(ShapeRef shape);
+    // Without recording anything, undo goes backwards through a step and redo forwards
+    void revertCommand(JournalCommand& command);
+    void replayCommand(JournalCommand& command);
 
     // SAT implementation to test intersection on two convex shapes, our bzier hulls
-    bool testHullIntersection(const std::vector<Vertex> shapeA, const std::vector<Vertex> shapeB);
+    bool testHullIntersection(const std::vector<Vertex>& shapeA, const std::vector<Vertex>& shapeB);
     // Actual recursive subdivision implementation for finding bzier intersections, if hulls intersect
     std::vector<Vertex> findBezierIntersections(const Bezier& curve1, const Bezier& curve2,
         float floatnessThreshold, int maxDepth);
+
+    // A curve taking part in the intersection pass : a finished bzier or one segment of a sequence
+    struct IntersectionCandidate
+    {
+        const Bezier* curve;
+        int shapeIndex;
+        int curveIndex; // -1 for finished bziers, segment index for sequences
+        float minX, minY, maxX, maxY; // Bounding box of the control points (contains the curve)
+    };
+    // Reused between passes
+    std::vector<IntersectionCandidate> intersectionCandidates;
+    std::vector<std::pair<size_t, size_t>> intersectionPairs;
+    std::vector<std::vector<BezierHit>> intersectionPairHits;
+    std::vector<int> intersectionPairIterations;
+    bool parallelIntersections = true;
+    int intersectionMethod = 0; // 0 = midpoint subdivision, 1 = Bzier clipping
+    // Stats of the last pass, to compare both methods
+    size_t lastIntersectionPairs = 0;
+    long long lastIntersectionIterations = 0;
+    double lastIntersectionTime = 0.0;
+    int lastIntersectionTruncated = 0; // Tests that ran out of iterations, their hits are approximate
+    std::vector<unsigned char> intersectionPairTruncated;
+
+    // Hit at the end point two neighbouring segments of a sequence share (t1 on curveA, t2 on curveB).
+    // They always touch there, that's not a crossing, but they can still cross somewhere else
+    static bool isSegmentJunctionHit(const CubicBezierSequence& sequence, int curveA, int curveB, float t1, float t2);
+    std::string intersectionCandidateName(const IntersectionCandidate& candidate) const;
+    // Bounding box of the control points, false if there aren't enough of them to be a curve
+    static bool makeIntersectionCandidate(const Bezier& curve, int shapeIndex, int curveIndex, IntersectionCandidate& candidate);
+    // Sweep and prune : sorts the candidates on the left side of their boxes, then lists the pairs whose boxes overlap
+    static void findOverlappingPairs(std::vector<IntersectionCandidate>& candidates, std::vector<std::pair<size_t, size_t>>& pairs);
+    // Used for self intersections, which run on the main thread
+    BezierIntersector selfIntersector;
+    std::vector<BezierHit> selfIntersectionScratch;
+    std::vector<IntersectionCandidate> selfIntersectionCandidates;
+    std::vector<std::pair<size_t, size_t>> selfIntersectionPairs;
+    std::vector<BezierHit> intersectionHits;
     IntersectionMarkers intersections;
     std::vector<std::string> foundIntersectionsText;
 
@@ -82,7 +204,8 @@ public:
     // Add a filled polygon to our storage
     void addFilledPolygon(const Polygon& poly,
         const std::vector<Vertex>& fillPoints,
-        float r, float g, float b, float a);
+        float r, float g, float b, float a,
+        const std::vector<uint8_t>& coverage = std::vector<uint8_t>());
 
     // Clear all filled polygons
     void clearFilledPolygons();
@@ -94,6 +217,10 @@ public:
     const std::vector<FilledPolygon>& getFilledPolygons() const;
 
     void addFinishedPolygon(const Polygon& polygon);
+    // Moved in, for shapes built elsewhere (scene loading)
+    void addFinishedPolygon(Polygon&& polygon);
+    void addFinishedBezier(Bezier&& bezier);
+    void addFinishedSequence(CubicBezierSequence&& sequence);
 
     void removeFinishedPolygon(int index);
 
@@ -109,6 +236,41 @@ public:
     // Check if is currently building polygon, for mouse input
     bool isBuilding() const;
 
+    // Any finished shape through a ShapeRef, for picking and the renderer.
+    // Sequences have 4 control points per curve, their vertexIndex is curve * 4 + point
+    static constexpr int typeBit(ShapeType type) { return 1 << type; };
+    static const int allShapeTypes = (1 << SHAPE_TYPE_COUNT) - 1;
+    size_t getShapeCount(ShapeType type) const;
+    bool isValidShape(ShapeRef shape) const;
+    size_t getShapePointCount(ShapeRef shape) const;
+    Vertex getShapePoint(ShapeRef shape, int vertexIndex) const;
+    // Bounding box of the editable points, false if the shape has none
+    bool getShapeBounds(ShapeRef shape, float& minX, float& minY, float& maxX, float& maxY) const;
+    // Average of the editable points
+    Vertex getShapeCenter(ShapeRef shape) const;
+    // nullptr when the shape isn't being dragged
+    const Matrix3x3* getShapeModelMatrix(ShapeRef shape) const;
+    // First shape (polygons, then bziers, then sequences) whose bounding box contains the point
+    bool pickShape(float x, float y, ShapeRef& shape, int typeMask = allShapeTypes) const;
+    // First point closer than radius
+    bool pickVertex(float x, float y, float radius, ShapeRef& shape, int& vertexIndex, int typeMask = allShapeTypes) const;
+
+    // The renderer replays these in order, then clears them
+    const std::vector<SceneChange>& getSceneChanges() const { return sceneChanges; };
+    void clearSceneChanges() { sceneChanges.clear(); };
+
+    // Everything changed between beginEdit() and endEdit() is undone at once (a drag, a clipping pass...)
+    void beginEdit(const std::string& name) { journal.beginStep(name); };
+    void endEdit() { journal.endStep(); };
+    bool undo();
+    bool redo();
+    const UndoJournal& getJournal() const { return journal; };
+    void clearHistory() { journal.clear(); };
+
+    // Removes every shape and fill, for loading a scene
+    void clearScene();
+    void reserveShapes(size_t polygons, size_t beziers, size_t sequences);
+
     // Bzier mode functions
     void toggleBezierMode() { bezierMode = !bezierMode; };
     void startBezierCurve();
@@ -120,14 +282,22 @@ public:
     void decrementBezierStepSize(size_t index);
     void toggleHullDisplay(size_t index);
 
+    // Changes the step size of every curve in the scene (free degree and sequences) at once
+    float getGlobalStepSize() const { return globalStepSize; };
+    void incrementGlobalStepSize();
+    void decrementGlobalStepSize();
+    // Regenerates all curves on the worker pool
+    void regenerateAllCurves();
+    double getLastRegenerationTime() const { return lastRegenerationTime; };
+
     void startCubicSequence();
     void appendToCubicSequence(float x, float y);
     void finishCubicSequence();
 
     void toggleCubicSequenceMode() { cubicSequenceMode = !cubicSequenceMode; };
     int getContinuityType() const { return continuityType; };
-    void setContinuityType(int type) { if (type >= 0 && type <= 2) continuityType = type; };
-    std::vector<CubicBezierSequence>& getFinishedBezierSequences() { return finishedSequences; };
+    void setContinuityType(int type) { if (type >= 0 && type <= 3) continuityType = type; };
+    const std::vector<CubicBezierSequence>& getFinishedBezierSequences() const { return finishedSequences; };
 
     void swapSequenceAlgorithm(size_t index);
     void incrementSequenceStepSize(size_t index);
@@ -141,7 +311,8 @@ public:
     void translate(int shapeIndex, ShapeType shapeType, float deltaX, float deltaY);
     void translateVertex(int shapeIndex, int vertexIndex, ShapeType shapeType, float deltaX, float deltaY);
 
-    // For linear transformations
+    // For linear transformations, and translations while dragging. The shape is drawn with a model matrix
+    // until stopTransformingShape(), which applies it to the vertices
     void startTransformingShape(int shapeIndex, ShapeType shapeType);
     void stopTransformingShape();
 
@@ -149,10 +320,29 @@ public:
     void applyRotationFromOriginal(int shapeIndex, ShapeType shapeType, float totalRotationAngle);
     void applyShearFromOriginal(int shapeIndex, ShapeType shapeType, float totalShearX, float totalShearY);
 
+    // Tests every pair of curves (finished bziers and sequence segments) whose bounding boxes overlap
     void tryFindingIntersections();
-    const std::vector<std::string> getFoundIntersectionsText() const { return foundIntersectionsText; };
-    const IntersectionMarkers getIntersectionMarkers() const { return intersections; };
+    // Self intersections of one curve (t1 < t2 on that curve), or of a whole sequence
+    // (there t is curve index + t on that curve, so 2.5 is the middle of the third curve)
+    void findSelfIntersections(const Bezier& curve, std::vector<BezierHit>& hits);
+    void findSelfIntersections(const CubicBezierSequence& sequence, std::vector<BezierHit>& hits);
+    // Curve i against curve j (i < j) of the sequence, without their shared junction
+    void intersectSequenceCurves(const CubicBezierSequence& sequence, int i, int j, std::vector<BezierHit>& hits);
+    bool getParallelIntersections() const { return parallelIntersections; };
+    void setParallelIntersections(bool parallel) { parallelIntersections = parallel; };
+    int getIntersectionMethod() const { return intersectionMethod; };
+    void setIntersectionMethod(int method) { if (method >= 0 && method <= 1) intersectionMethod = method; };
+    size_t getLastIntersectionPairs() const { return lastIntersectionPairs; };
+    long long getLastIntersectionIterations() const { return lastIntersectionIterations; };
+    double getLastIntersectionTime() const { return lastIntersectionTime; };
+    int getLastIntersectionTruncated() const { return lastIntersectionTruncated; };
+    // By reference : the GUI reads these every frame, and the markers own GL objects so they can't be copied
+    const std::vector<std::string>& getFoundIntersectionsText() const { return foundIntersectionsText; };
+    const IntersectionMarkers& getIntersectionMarkers() const { return intersections; };
     const void drawIntersectionMarkers(Shader& shader) const { intersections.draw(shader); };
+    // Deletes the markers' and fills' GL objects, call it before the context goes away
+    // (main's PolyBuilder is a global, it's destroyed after glfwTerminate)
+    void releaseGL();
 
     Polygon createPolygonFromBezierSequence(const CubicBezierSequence& bezierSequence);
 };
\ No newline at end of file
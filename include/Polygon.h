@@ -4,15 +4,18 @@
 
 #include "Vertex.h"
 #include "CommonTypes.h"
-#include "Shader.h"
+#include "Matrix.h"
 #include "CubicBezierSequence.h"
 
 class Polygon
 {
 private:
 	std::vector<Vertex> vertices; // Array of vertices - the polygon itself
-	unsigned int VAO, VBO; // Vertex Array Object and Buffer Object for OpenGL
-	bool buffersInitialized = false;
+
+	// Applied by the vertex shader while the polygon is dragged, so the vertices aren't rewritten
+	// every mouse move. PolyBuilder bakes it into the vertices when the transformation ends
+	Matrix3x3 modelMatrix;
+	bool hasModelMatrix = false;
 
 public:
 	PolyType type;
@@ -20,15 +23,18 @@ public:
 	Polygon();
 	Polygon(const Polygon& other); // Copy constructor
 	Polygon& operator=(const Polygon& other); // Assignment operator
-	~Polygon();
+	// Moving just hands over the vertices (vector growth relies on noexcept)
+	Polygon(Polygon&& other) noexcept = default;
+	Polygon& operator=(Polygon&& other) noexcept = default;
 	void addVertex(float x, float y);
 	void addVertex(Vertex vertex);
-	void updateBuffers();
-	const void draw() const;
-	const void drawPoints() const;
-	const void drawPreview(Shader& shader) const;
 	const std::vector<Vertex>& getVertices() const;
 	void setVertices(std::vector<Vertex> vertexVector);
 	bool isClockwise() const;
+
+	// nullptr when there's no pending transformation (identity)
+	const Matrix3x3* getModelMatrix() const { return hasModelMatrix ? &modelMatrix : nullptr; };
+	void setModelMatrix(const Matrix3x3& matrix) { modelMatrix = matrix; hasModelMatrix = true; };
+	void resetModelMatrix() { modelMatrix = Matrix3x3(); hasModelMatrix = false; };
 	void reverseOrientation(); // Makes polygon clockwise if counter clockwise and the opposite
 };
\ No newline at end of file
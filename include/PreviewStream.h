@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Vertex.h"
+#include "Shader.h"
+#include "GLResource.h"
+#include "Polygon.h"
+#include "Bezier.h"
+#include "CubicBezierSequence.h"
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+
+// Shapes being built change every click and are drawn every frame, so instead of each having
+// its own buffers they queue their points here and everything goes to the GPU in one upload per frame.
+// The buffer is a ring of a few sections : a frame writes into one section (mapped unsynchronized,
+// so the driver doesn't stall) while the GPU may still be reading the previous ones.
+// A fence per section makes sure we never write into one the GPU hasn't finished with.
+class PreviewStream
+{
+private:
+    struct DrawCommand
+    {
+        GLenum mode;
+        size_t first; // Index in the points queued this frame
+        size_t count;
+        float r, g, b, a;
+    };
+
+    static const int sectionCount = 3;
+
+    std::vector<Vertex> queuedPoints; // Kept between frames, so nothing gets allocated once it's big enough
+    std::vector<DrawCommand> commands;
+
+    GLVertexArray vao;
+    GLBuffer vbo;
+    size_t sectionSize = 0; // In vertices
+    GLsync fences[sectionCount] = {};
+    int currentSection = 0;
+
+    // (Re)creates the storage so a section can hold at least count vertices
+    void reserve(size_t count);
+    void deleteFences();
+
+public:
+    PreviewStream() {};
+    ~PreviewStream() { deleteFences(); };
+
+    // Owns fences and GL objects
+    PreviewStream(const PreviewStream&) = delete;
+    PreviewStream& operator=(const PreviewStream&) = delete;
+
+    // Queues the points, drawn with mode in the given color on the next flush
+    void add(GLenum mode, const std::vector<Vertex>& points, float r, float g, float b, float a);
+
+    // The shapes being built, in their preview colors. The shape classes know nothing about GL,
+    // so the batch tool can use them without a context
+    void addPolygon(const Polygon& polygon);
+    void addBezier(const Bezier& bezier); // The curve only shows up once there are more than 2 control points
+    void addSequence(const CubicBezierSequence& sequence);
+
+    // Uploads everything queued since the last flush in one go, then draws it in the order it was added
+    void flush(Shader& shader);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Hands out ranges of some storage it doesn't own (the SceneRenderer's GPU buffer).
+// Released ranges go in a free list, reused by the next allocation that fits.
+class RangeAllocator
+{
+private:
+    struct Block
+    {
+        size_t offset;
+        size_t count;
+    };
+
+    std::vector<Block> freeBlocks; // Sorted by offset, two blocks are never next to each other
+    size_t end = 0; // Everything before is either allocated or in the free list
+
+public:
+    // First free block big enough, or the end of the storage
+    size_t allocate(size_t count);
+    // The range goes back to the free list, merged with its neighbours (and dropped if it's at the end)
+    void release(size_t offset, size_t count);
+    void clear() { freeBlocks.clear(); end = 0; };
+
+    // How much storage the ranges need
+    size_t size() const { return end; };
+    size_t freeCount() const;
+};
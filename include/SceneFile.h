@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class PolyBuilder;
+
+// Saving and loading whole scenes.
+//
+// Binary layout (.pms), everything little endian :
+//   SceneFileHeader
+//   SceneShapeRecord * shapeCount   at shapeTableOffset
+//   Vertex * vertexCount            at vertexOffset, x y x y ... (same layout as Vertex)
+// Every shape's points are one contiguous run of the vertex block, so loading maps the file and
+// copies each run straight into its shape, without parsing anything or reading the file into a buffer.
+// Filled polygons store their polygon's vertices followed by their fill points (and coverage, see below).
+//
+// The format itself (SceneFormat.cpp) doesn't need OpenGL or a PolyBuilder, so the batch tool reads
+// and writes scenes with it. save / load / exportJson (SceneFile.cpp) go between it and the app.
+namespace SceneFile
+{
+    const uint32_t currentVersion = 1;
+    const char sceneMagic[4] = { 'P', 'M', 'S', 'C' };
+    const uint32_t byteOrderMark = 0x01020304;
+
+    enum SceneShapeKind : uint32_t
+    {
+        SCENE_POLYGON,
+        SCENE_BEZIER,
+        SCENE_SEQUENCE,
+        SCENE_FILLED_POLYGON
+    };
+
+    enum SceneShapeFlags : uint32_t
+    {
+        SCENE_FLAG_CLOSED = 1,    // Sequences
+        SCENE_FLAG_SHOW_HULL = 2, // Béziers
+        SCENE_FLAG_COVERAGE = 4   // Filled polygons with anti-aliased coverage, see coverageSlots()
+    };
+
+    struct SceneFileHeader
+    {
+        char magic[4];      // "PMSC"
+        uint32_t version;
+        uint32_t byteOrder; // 0x01020304 as written, to refuse files from a big endian machine
+        uint32_t shapeCount;
+        uint64_t shapeTableOffset;
+        uint64_t vertexOffset;
+        uint64_t vertexCount;
+        int32_t fillAlgorithm;
+        float fillColor[4];
+        uint32_t reserved;
+    };
+
+    struct SceneShapeRecord
+    {
+        uint32_t kind;       // SceneShapeKind
+        uint32_t polyType;   // PolyType of polygons
+        uint64_t firstVertex;
+        uint64_t vertexCount; // Sequences : 4 per curve
+        uint64_t fillCount;  // Filled polygons : fill points after the polygon's vertices
+        int32_t continuityType;
+        int32_t algorithm;
+        float stepSize;
+        uint32_t flags;      // SceneShapeFlags
+        float color[4];      // Filled polygons
+    };
+
+    static_assert(sizeof(SceneFileHeader) == 64, "The header is part of the file format");
+    static_assert(sizeof(SceneShapeRecord) == 64, "Shape records are part of the file format");
+    static_assert(sizeof(Vertex) == 2 * sizeof(float), "The vertex block is read as an array of Vertex");
+
+    // With SCENE_FLAG_COVERAGE, a filled polygon's fill points are followed by one coverage byte per point,
+    // padded to whole vertices so the vertex block stays an array of Vertex. This is how many it takes
+    inline uint64_t coverageSlots(uint64_t fillCount) { return (fillCount + sizeof(Vertex) - 1) / sizeof(Vertex); }
+
+    // Vertices a record uses in the vertex block
+    inline uint64_t recordSize(const SceneShapeRecord& record)
+    {
+        uint64_t size = record.vertexCount + record.fillCount;
+        if (record.kind == SCENE_FILLED_POLYGON && (record.flags & SCENE_FLAG_COVERAGE))
+            size += coverageSlots(record.fillCount);
+        return size;
+    }
+
+    // A whole scene as plain data, records pointing into one vertex array like in the file
+    struct SceneContents
+    {
+        int32_t fillAlgorithm = 0;
+        float fillColor[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+        std::vector<SceneShapeRecord> shapes;
+        std::vector<Vertex> vertices;
+    };
+
+    // Checks the header, the offsets and every record against the size, and every enum-like field
+    // against its range, before anything uses them
+    bool validate(const unsigned char* data, size_t size, const std::string& path);
+
+    // The records are used in place (load maps the file read-only), so step sizes can't be fixed
+    // by validate(). Whatever reads one goes through this : 0 would never finish generating a curve
+    inline float clampStepSize(float stepSize)
+    {
+        if (!(stepSize == stepSize)) // NaN
+            return 0.01f;
+        return stepSize < 0.001f ? 0.001f : (stepSize > 1.0f ? 1.0f : stepSize);
+    }
+
+    bool read(const std::string& path, SceneContents& contents);
+    bool write(const SceneContents& contents, const std::string& path);
+
+    // Error messages go to std::cerr, false means nothing was written / loaded
+    bool save(const PolyBuilder& polybuilder, const std::string& path);
+    // Replaces the scene (and clears the undo history)
+    bool load(PolyBuilder& polybuilder, const std::string& path);
+
+    // Same content as readable JSON, for debugging. Fill points are only counted
+    bool exportJson(const PolyBuilder& polybuilder, const std::string& path);
+}
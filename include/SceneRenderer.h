@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Vertex.h"
+#include "Shader.h"
+#include "GLResource.h"
+#include "CommonTypes.h"
+#include "RangeAllocator.h"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <glad/glad.h>
+
+class PolyBuilder;
+
+// Draws every finished shape from one shared buffer instead of one VAO and a few draw calls per shape.
+// Each shape owns a range of the buffer, and only the shapes PolyBuilder reports as changed
+// (see SceneChange) are packed and uploaded again, with glBufferSubData on their range.
+// When a sequence reports which of its curves changed and they kept their number of points,
+// only those curves' part of the range goes up (a drag step doesn't re-upload the whole spline).
+// The draws are sorted by layer, model matrix and color once, when shapes are added or removed,
+// and every run with the same state is a single glMultiDrawArrays. So the number of GL calls depends
+// on how many colors there are, not on how many shapes.
+// Filled polygons keep their own buffers (they can have a lot of points and rarely change).
+// A shape being dragged is drawn with its model matrix instead of having its points rewritten,
+// so its range isn't uploaded again during the drag.
+class SceneRenderer
+{
+private:
+    // Lower layers are drawn first, in the order shapes used to be drawn one by one
+    enum Layer
+    {
+        LAYER_OUTLINES,
+        LAYER_CLIPPED,
+        // The previews of shapes being built go here, see drawPolygons() and drawCurves()
+        LAYER_BEZIERS,
+        LAYER_HULLS,
+        LAYER_SEQUENCES
+    };
+
+    // Where a shape's points are in the buffer. Polygons only use parts[0], béziers are
+    // control points, curve then hull, sequences every control point then every curve
+    struct Slot
+    {
+        size_t offset = 0;
+        size_t capacity = 0; // In vertices, can be more than the parts once the shape lost points
+        size_t parts[3] = {};
+        bool showHull = false;
+        bool dirty = true;
+        // Sequences : where each curve's generated points start in parts[1], plus where the last one ends
+        std::vector<size_t> curveStarts;
+        // Runs of curves (first, count) changed since the last upload, while the slot itself isn't dirty
+        std::vector<std::pair<size_t, size_t>> dirtyCurves;
+    };
+
+    struct DrawItem
+    {
+        int layer;
+        bool hasModel;
+        ShapeRef shape; // Only for the model matrix, read from the shape when drawing
+        GLenum mode;
+        float r, g, b, a;
+        GLint first;
+        GLsizei count;
+    };
+
+    // Consecutive items with the same state, ranges of batchFirsts and batchCounts
+    struct Batch
+    {
+        bool hasModel;
+        ShapeRef shape;
+        GLenum mode;
+        float r, g, b, a;
+        size_t begin;
+        size_t count;
+    };
+
+    std::vector<Slot> slots[SHAPE_TYPE_COUNT]; // Same order as PolyBuilder's lists
+    RangeAllocator ranges;
+    std::vector<Vertex> uploadScratch; // Kept between uploads to avoid reallocating
+
+    std::vector<DrawItem> items;
+    std::vector<Batch> batches;
+    std::vector<GLint> batchFirsts;
+    std::vector<GLsizei> batchCounts;
+    size_t firstCurveBatch = 0; // Batches before it are drawn before the previews
+    bool batchesDirty = true;
+
+    GLVertexArray vao;
+    GLBuffer vbo;
+    size_t bufferCapacity = 0; // In vertices
+
+    void applyChanges(PolyBuilder& polybuilder);
+    static void measure(const PolyBuilder& polybuilder, ShapeRef shape, Slot& slot);
+    static void pack(const PolyBuilder& polybuilder, ShapeRef shape, std::vector<Vertex>& points);
+    // False if a dirty curve's points don't fit where they were anymore, the whole slot is uploaded then
+    static bool curvesKeptTheirSize(const PolyBuilder& polybuilder, ShapeRef shape, const Slot& slot);
+    void uploadCurves(const PolyBuilder& polybuilder, ShapeRef shape, Slot& slot);
+    void upload(const PolyBuilder& polybuilder);
+    void addItem(int layer, const Matrix3x3* model, ShapeRef shape, GLenum mode, size_t first, size_t count, float r, float g, float b, float a);
+    void addItems(const PolyBuilder& polybuilder, ShapeRef shape, const Slot& slot);
+    void rebuildBatches(const PolyBuilder& polybuilder);
+    void drawBatches(const PolyBuilder& polybuilder, Shader& shader, size_t begin, size_t end);
+
+public:
+    SceneRenderer() {};
+
+    // Uploads what changed since the last frame, call it once before drawing
+    void update(PolyBuilder& polybuilder);
+    // Filled polygons, then outlines and clipped polygons
+    void drawPolygons(const PolyBuilder& polybuilder, Shader& shader, Shader& fillShader);
+    // Béziers, their hulls and sequences, on top of the previews
+    void drawCurves(const PolyBuilder& polybuilder, Shader& shader);
+};
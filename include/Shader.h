@@ -2,12 +2,21 @@
 #include <glad/glad.h>
 #include <string>
 
+#include "Matrix.h"
+#include <utility>
+#include <vector>
+
 class Shader 
 {
 private:
 	void checkCompileErrors(unsigned int shader, const std::string type);
 	std::string loadShaderFile(const char* shaderPath);
 
+	// Every active uniform and its location, filled once after linking.
+	// A shader only has a handful, so a flat vector beats a map
+	std::vector<std::pair<std::string, int>> uniformLocations;
+	void cacheUniformLocations();
+
 public:
 	unsigned int id;
 
@@ -15,5 +24,16 @@ public:
 	~Shader();
 
 	void use() const;
-	void setColor(const std::string name, float r, float g, float b, float a) const;
+
+	// -1 if the shader has no such uniform (glUniform calls just ignore it).
+	// Look it up once and keep it, the typed setters below take the location
+	int getUniformLocation(const char* name) const;
+
+	void setFloat(int location, float value) const { glUniform1f(location, value); };
+	void setVec2(int location, float x, float y) const { glUniform2f(location, x, y); };
+	void setColor(int location, float r, float g, float b, float a) const { glUniform4f(location, r, g, b, a); };
+	// Our matrices are stored row by row, OpenGL wants columns so it transposes them
+	void setMat3(int location, const Matrix3x3& matrix) const { glUniformMatrix3fv(location, 1, GL_TRUE, &matrix.elements[0][0]); };
+	// By name, goes through the cache (no driver lookup)
+	void setColor(const char* name, float r, float g, float b, float a) const;
 };
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// RGBA8 image drawn on the CPU, for fill results without a window (reference images, the batch tool).
+// Blending is the window's glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) on all four channels,
+// so an image matches what the fills look like on screen.
+class SoftwareRaster
+{
+private:
+    int width;
+    int height;
+    std::vector<uint8_t> pixels; // RGBA, top row first
+
+    // How much of each pixel the shape being drawn covers, only cleared over its bounds
+    std::vector<uint8_t> mask;
+
+public:
+    SoftwareRaster(int width, int height);
+
+    int getWidth() const { return width; };
+    int getHeight() const { return height; };
+    const std::vector<uint8_t>& getPixels() const { return pixels; };
+
+    void clear(float r, float g, float b, float a);
+
+    // Blends the color over pixels [x0, x1) of row y. Coverage (0 - 255) scales the alpha
+    void blendSpan(int y, int x0, int x1, float r, float g, float b, float a, uint8_t coverage = 255);
+
+    // Fill points from Filler (one per pixel of its gridWidth x gridHeight grid, in NDC), scaled to the image.
+    // Each image pixel is blended once per call, even when several grid pixels land on it (with the
+    // highest of their coverages, when the fill has some)
+    void drawFillPoints(const std::vector<Vertex>& points, int gridWidth, int gridHeight, float r, float g, float b, float a,
+        const std::vector<uint8_t>& coverage = std::vector<uint8_t>());
+
+    // Binary PPM (P6), alpha dropped
+    bool writePPM(const std::string& path) const;
+    // Uncompressed PNG : stored deflate blocks, written row by row without building the file in memory
+    bool writePNG(const std::string& path) const;
+    // By extension, .ppm or anything else as PNG
+    bool write(const std::string& path) const;
+};
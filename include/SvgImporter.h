@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Vertex.h"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+class PolyBuilder;
+
+// Reads the <path d="..."> and <polygon points="..."> elements of an SVG file without building a DOM :
+// the file goes through a small state machine a chunk at a time, and path data is parsed while it's read.
+// Supported path commands : M L H V C S Q T Z (absolute and relative). Arcs (A) become straight lines.
+// Transforms, styles and every other element are ignored.
+namespace SvgImporter
+{
+    // One subpath of a <path>, or a <polygon>, in SVG coordinates (y goes down)
+    struct SvgShape
+    {
+        std::vector<Vertex> points; // Polygon vertices, or 4 control points per cubic curve when curved
+        bool curved = false;
+        bool closed = false;
+    };
+
+    struct ImportStats
+    {
+        size_t polygons = 0;
+        size_t sequences = 0;
+        size_t segments = 0;
+        size_t approximatedArcs = 0;
+        size_t skippedShapes = 0; // Too few points to be a polygon or a curve
+    };
+
+    // Calls onShape for each subpath as soon as it's complete (it can take the points).
+    // Only the shape being parsed is kept, so memory doesn't grow with the file
+    bool readFile(const std::string& path, const std::function<void(SvgShape&)>& onShape, ImportStats& stats);
+
+    // Reads the file twice : once for the bounds, then to add the shapes to the scene, scaled to fit
+    // the window (y up). Straight-only subpaths become polygons, the others C0 sequences. One undo step
+    bool importFile(PolyBuilder& polybuilder, const std::string& path);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "Vertex.h"
+#include "Matrix.h"
+#include "Polygon.h"
+#include "Bezier.h"
+#include "CubicBezierSequence.h"
+#include "CommonTypes.h"
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <variant>
+#include <vector>
+
+// A removed shape waiting to come back (or an added one that was undone, waiting for a redo)
+using ShapeObject = std::variant<std::monostate, Polygon, Bezier, CubicBezierSequence>;
+
+// One change to one shape, with only what's needed to do it again or undo it :
+// a vertex move is two points, a transformation is its 6 floats (undone with its inverse).
+// Only shapes out of the scene are kept whole, since nothing else has them anymore.
+struct JournalCommand
+{
+    enum Kind
+    {
+        MOVE_VERTEX,  // vertexIndex went from "from" to "to"
+        APPLY_MATRIX, // matrix was applied to every point
+        SET_POINTS,   // points went from "before" to "after" (deletions, transforms...)
+        SET_CURVES,   // some curves of a sequence went from "before" to "after", 4 points per curve
+        ADD_SHAPE,    // shape was added at its index
+        REMOVE_SHAPE  // shape was removed from its index
+    };
+
+    Kind kind;
+    ShapeRef shape;
+    int vertexIndex = -1;
+    Vertex from, to;
+    Affine2x3 matrix;
+    std::vector<Vertex> before, after;
+    std::vector<size_t> curveIndices; // SET_CURVES, sorted
+    ShapeObject storedShape; // The shape while it's out of the scene (removed, or added then undone)
+
+    // Roughly how much memory the command keeps alive
+    size_t memory() const;
+};
+
+// What one undo or redo goes through, like a whole drag or a clipping pass
+struct JournalStep
+{
+    std::string name;
+    std::vector<JournalCommand> commands;
+    size_t memory = 0;
+};
+
+// Undo and redo stacks of steps. Commands recorded while a step is open go in that step, and
+// consecutive ones on the same thing are merged (a drag is one vertex move, not one per mouse move).
+// When the steps use more than the budget, the oldest ones are forgotten.
+class UndoJournal
+{
+private:
+    std::deque<JournalStep> undoSteps;
+    std::deque<JournalStep> redoSteps;
+    JournalStep openStep;
+    int openDepth = 0;
+
+    size_t memoryUsed = 0;
+    size_t memoryBudget = 16 * 1024 * 1024;
+    size_t maxSteps = 256;
+
+    void pushUndoStep(JournalStep&& step);
+    void clearRedo();
+    void trim();
+
+public:
+    // Steps can be nested, everything until the outermost endStep() is undone together
+    void beginStep(const std::string& name);
+    void endStep();
+    bool isStepOpen() const { return openDepth > 0; };
+
+    // Outside of an open step, the command is a step on its own
+    void record(JournalCommand&& command);
+
+    bool canUndo() const { return !undoSteps.empty(); };
+    bool canRedo() const { return !redoSteps.empty(); };
+    const std::string& undoName() const { return undoSteps.back().name; };
+    const std::string& redoName() const { return redoSteps.back().name; };
+
+    // PolyBuilder takes the step, reverts (or replays) it, and gives it back for the other stack
+    JournalStep takeUndo();
+    JournalStep takeRedo();
+    void pushRedo(JournalStep&& step);
+    void pushUndoAfterRedo(JournalStep&& step);
+
+    void clear();
+    size_t getMemoryUsed() const { return memoryUsed; };
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; trim(); };
+};
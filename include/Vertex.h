@@ -36,5 +36,5 @@ struct Vertex
 		return *this;
 	}
 
-	Vertex(float x = 0.0f, float y = 0.0f) : x(x), y(y) {}
+	constexpr Vertex(float x = 0.0f, float y = 0.0f) : x(x), y(y) {}
 };
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads created once and reused for every batch.
+// Only meant for CPU work (curve generation, geometry), never for OpenGL calls:
+// the GL context belongs to the main thread, so uploads have to happen after the batch.
+class WorkerPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wakeCondition; // Workers sleep on this until a batch starts
+	std::condition_variable doneCondition; // The caller sleeps on this until the batch is done
+
+	const std::function<void(size_t)>* currentTask = nullptr;
+	size_t taskCount = 0;
+	size_t chunkSize = 1;
+	size_t nextIndex = 0;
+	size_t finishedCount = 0;
+	std::exception_ptr firstError; // From the first task that threw, rethrown by the caller
+	unsigned long long batchId = 0;
+	bool stopping = false;
+
+	std::mutex callerMutex; // Only one batch at a time
+
+	void workerLoop();
+	void runTasks(unsigned long long batch);
+
+public:
+	explicit WorkerPool(unsigned int threadCount);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Shared pool sized to the machine (one thread per core, the caller counts as one)
+	static WorkerPool& instance();
+
+	// Calls task(i) for every i in [0, count) and returns once they are all done.
+	// The calling thread works too. Calling it from inside a task runs serially.
+	// If a task throws, what's left of the batch is skipped and the first exception is rethrown here,
+	// once no thread uses the task anymore.
+	void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	size_t getThreadCount() const { return workers.size() + 1; };
+};
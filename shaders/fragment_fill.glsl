@@ -0,0 +1,11 @@
+#version 330 core
+
+in float vCoverage;
+
+out vec4 FragColor;
+uniform vec4 uColor;
+
+void main() {
+    // Partly covered pixels are blended in proportion (anti-aliased fills)
+    FragColor = vec4(uColor.rgb, uColor.a * vCoverage);
+}
\ No newline at end of file
@@ -1,7 +1,9 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
 
+uniform mat3 uModel; // Transformation of a shape being dragged, identity otherwise
+
 void main() {
-    gl_Position = vec4(aPos, 0.0, 1.0);
+    gl_Position = vec4((uModel * vec3(aPos, 1.0)).xy, 0.0, 1.0);
     gl_PointSize = 5.0; // Vertex point size
 }
\ No newline at end of file
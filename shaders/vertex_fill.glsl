@@ -1,7 +1,11 @@
 #version 330 core
 layout (location = 0) in vec2 aPos;
+layout (location = 1) in float aCoverage; // 0 - 1, constant 1 for fills without coverage
+
+out float vCoverage;
 
 void main() {
     gl_Position = vec4(aPos, 0.0, 1.0);
     gl_PointSize = 1.0; // Smaller point size for fill points
+    vCoverage = aCoverage;
 }
\ No newline at end of file
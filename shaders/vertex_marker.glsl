@@ -0,0 +1,7 @@
+#version 330 core
+layout (location = 0) in vec2 aPos;    // Cross shape, already scaled to the marker size
+layout (location = 1) in vec2 aOffset; // Marker position, one per instance
+
+void main() {
+    gl_Position = vec4(aOffset + aPos, 0.0, 1.0);
+}
\ No newline at end of file
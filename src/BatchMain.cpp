@@ -0,0 +1,516 @@
+// Headless batch tool : loads a scene, runs it through a list of stages (clipping, ear cutting, filling,
+// curve flattening) and writes the result with how long each stage took.
+// No window and no OpenGL context : shapes are CPU side only, the app's SceneRenderer is what uploads them.
+
+#include "SceneFile.h"
+#include "Polygon.h"
+#include "Bezier.h"
+#include "Clipper.h"
+#include "Filler.h"
+#include "SoftwareRaster.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Béziers and sequences, kept as they were read until something flattens them
+    struct CurveShape
+    {
+        SceneFile::SceneShapeRecord record;
+        std::vector<Vertex> controlPoints;
+    };
+
+    struct FilledShape
+    {
+        Polygon polygon;
+        std::vector<Vertex> fillPoints;
+        std::vector<uint8_t> coverage; // Empty unless filled with Filler::FILL_COVERAGE
+        float color[4];
+    };
+
+    struct BatchScene
+    {
+        std::vector<Polygon> polygons;
+        std::vector<CurveShape> curves;
+        std::vector<FilledShape> filled;
+        int32_t fillAlgorithm = Filler::FILL_SCANLINE;
+        float fillColor[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    };
+
+    struct StageTiming
+    {
+        std::string name;
+        double milliseconds;
+        size_t polygons;
+        size_t curves;
+        size_t filled;
+    };
+
+    void printUsage()
+    {
+        std::cout <<
+            "Usage: ProjetMath4RVJVBatch <scene.pms> [options] <stage>...\n"
+            "Options:\n"
+            "  -o <file>          Writes the resulting scene\n"
+            "  --timings <file>   Writes the stage timings as JSON (they're printed anyway)\n"
+            "  --size <W>x<H>     Pixel grid the fills are computed on (default 800x600)\n"
+            "  --image <file>     Draws the fills into a .png or .ppm after the last stage\n"
+            "  --image-size <W>x<H>  Size of that image (default : the fill grid)\n"
+            "Stages, run in the order given:\n"
+            "  clip-sh            Sutherland-Hodgman clip of every polygon and flattened curve by the window\n"
+            "  clip-cb            Same with Cyrus-Beck\n"
+            "  earcut             Replaces every polygon by its ear cutting triangles\n"
+            "  fill[:algorithm]   Fills every polygon : scanline, lca, seed, seed-recursive, coverage\n"
+            "                     (default : the scene's). Seeds are the polygons' vertex average\n"
+            "  flatten            Turns every Bézier and sequence into a polygon of its generated curve\n";
+    }
+
+    void loadScene(const SceneFile::SceneContents& contents, BatchScene& scene)
+    {
+        scene.fillAlgorithm = contents.fillAlgorithm;
+        std::memcpy(scene.fillColor, contents.fillColor, sizeof(scene.fillColor));
+
+        for (const SceneFile::SceneShapeRecord& record : contents.shapes)
+        {
+            auto first = contents.vertices.begin() + record.firstVertex;
+            auto last = first + record.vertexCount;
+
+            switch (record.kind)
+            {
+            case SceneFile::SCENE_POLYGON:
+            {
+                Polygon polygon;
+                polygon.type = static_cast<PolyType>(record.polyType);
+                polygon.setVertices(std::vector<Vertex>(first, last));
+                scene.polygons.push_back(std::move(polygon));
+                break;
+            }
+            case SceneFile::SCENE_BEZIER:
+            case SceneFile::SCENE_SEQUENCE:
+                scene.curves.push_back({ record, std::vector<Vertex>(first, last) });
+                break;
+            case SceneFile::SCENE_FILLED_POLYGON:
+            {
+                FilledShape filled;
+                filled.polygon.type = static_cast<PolyType>(record.polyType);
+                filled.polygon.setVertices(std::vector<Vertex>(first, last));
+                filled.fillPoints.assign(last, last + record.fillCount);
+                if ((record.flags & SceneFile::SCENE_FLAG_COVERAGE) && record.fillCount > 0)
+                {
+                    const uint8_t* coverage = reinterpret_cast<const uint8_t*>(&*(last + record.fillCount));
+                    filled.coverage.assign(coverage, coverage + record.fillCount);
+                }
+                std::memcpy(filled.color, record.color, sizeof(filled.color));
+                scene.filled.push_back(std::move(filled));
+                break;
+            }
+            }
+        }
+    }
+
+    // Same order as SceneFile::save : polygons, curves, then fills
+    void storeScene(const BatchScene& scene, SceneFile::SceneContents& contents)
+    {
+        contents.fillAlgorithm = scene.fillAlgorithm;
+        std::memcpy(contents.fillColor, scene.fillColor, sizeof(contents.fillColor));
+
+        auto addRecord = [&](SceneFile::SceneShapeRecord record, const std::vector<Vertex>& points) -> SceneFile::SceneShapeRecord&
+        {
+            record.firstVertex = contents.vertices.size();
+            record.vertexCount = points.size();
+            contents.vertices.insert(contents.vertices.end(), points.begin(), points.end());
+            contents.shapes.push_back(record);
+            return contents.shapes.back();
+        };
+
+        for (const Polygon& polygon : scene.polygons)
+        {
+            SceneFile::SceneShapeRecord record = {};
+            record.kind = SceneFile::SCENE_POLYGON;
+            record.polyType = polygon.type;
+            addRecord(record, polygon.getVertices());
+        }
+
+        for (const CurveShape& curve : scene.curves)
+            addRecord(curve.record, curve.controlPoints);
+
+        for (const FilledShape& filled : scene.filled)
+        {
+            SceneFile::SceneShapeRecord record = {};
+            record.kind = SceneFile::SCENE_FILLED_POLYGON;
+            record.polyType = filled.polygon.type;
+            std::memcpy(record.color, filled.color, sizeof(record.color));
+            SceneFile::SceneShapeRecord& added = addRecord(record, filled.polygon.getVertices());
+            added.fillCount = filled.fillPoints.size();
+            contents.vertices.insert(contents.vertices.end(), filled.fillPoints.begin(), filled.fillPoints.end());
+
+            if (!filled.coverage.empty())
+            {
+                added.flags = SceneFile::SCENE_FLAG_COVERAGE;
+                size_t start = contents.vertices.size();
+                // Packed into zeroed vertices, the same layout SceneFile::save writes
+                contents.vertices.resize(start + SceneFile::coverageSlots(filled.coverage.size()));
+                std::memcpy(&contents.vertices[start], filled.coverage.data(), filled.coverage.size());
+            }
+        }
+    }
+
+    // Like the context menu : the first window clips every polygon and flattened curve,
+    // and replaces the previous results of the same algorithm
+    bool clipStage(BatchScene& scene, bool sutherlandHodgman)
+    {
+        const Polygon* window = nullptr;
+        for (const Polygon& polygon : scene.polygons)
+        {
+            if (polygon.type == WINDOW)
+            {
+                window = &polygon;
+                break;
+            }
+        }
+        if (!window)
+        {
+            std::cerr << "Error: No window polygon to clip against" << std::endl;
+            return false;
+        }
+
+        PolyType resultType = sutherlandHodgman ? CLIPPED_SUTHERLAND_HODGMAN : CLIPPED_CYRUS_BECK;
+        std::vector<Polygon> kept;
+        std::vector<const Polygon*> subjects;
+        for (Polygon& polygon : scene.polygons)
+        {
+            if (polygon.type == resultType)
+                continue;
+            if (polygon.type == POLYGON || polygon.type == BEZIER_CURVE)
+                subjects.push_back(&polygon);
+        }
+
+        // Every subject is independent, the results keep the subjects' order
+        Polygon windowCopy = *window;
+        std::vector<Polygon> results(subjects.size());
+        WorkerPool::instance().parallelFor(subjects.size(), [&](size_t i) {
+            results[i] = sutherlandHodgman ? Clipper::clipPolygonSutherlandHodgman(*subjects[i], windowCopy)
+                                           : Clipper::clipPolygonCyrusBeck(*subjects[i], windowCopy);
+        });
+
+        for (Polygon& polygon : scene.polygons)
+            if (polygon.type != resultType)
+                kept.push_back(std::move(polygon));
+        for (Polygon& result : results)
+        {
+            if (result.getVertices().empty())
+                continue;
+            result.type = resultType;
+            kept.push_back(std::move(result));
+        }
+        scene.polygons = std::move(kept);
+        return true;
+    }
+
+    void earCutStage(BatchScene& scene)
+    {
+        std::vector<size_t> cut;
+        for (size_t i = 0; i < scene.polygons.size(); i++)
+            if (scene.polygons[i].type == POLYGON)
+                cut.push_back(i);
+
+        std::vector<std::vector<Polygon>> triangles(cut.size());
+        WorkerPool::instance().parallelFor(cut.size(), [&](size_t i) {
+            triangles[i] = Clipper::earCutting(scene.polygons[cut[i]]);
+        });
+
+        // The others stay where they are, triangles go at the end like in the app
+        std::vector<Polygon> kept;
+        for (Polygon& polygon : scene.polygons)
+            if (polygon.type != POLYGON)
+                kept.push_back(std::move(polygon));
+        for (std::vector<Polygon>& polygonTriangles : triangles)
+        {
+            for (Polygon& triangle : polygonTriangles)
+            {
+                triangle.type = POLYGON;
+                kept.push_back(std::move(triangle));
+            }
+        }
+        scene.polygons = std::move(kept);
+    }
+
+    // Filler keeps its pixel grid in statics, so this one stays on one thread
+    void fillStage(BatchScene& scene, int algorithm)
+    {
+        scene.filled.clear();
+        for (const Polygon& polygon : scene.polygons)
+        {
+            if (polygon.type != POLYGON || polygon.getVertices().size() < 3)
+                continue;
+
+            FilledShape filled;
+            filled.polygon = polygon;
+            std::memcpy(filled.color, scene.fillColor, sizeof(filled.color));
+
+            Vertex seed;
+            for (const Vertex& vertex : polygon.getVertices())
+                seed = seed + vertex;
+            seed = seed * (1.0f / polygon.getVertices().size());
+
+            switch (algorithm)
+            {
+            case Filler::FILL_SCANLINE: filled.fillPoints = Filler::fillPolygon(polygon); break;
+            case Filler::FILL_LCA: filled.fillPoints = Filler::fillPolygonLCA(polygon); break;
+            case Filler::FILL_SEED: filled.fillPoints = Filler::fillFromSeed(polygon, seed.x, seed.y); break;
+            case Filler::FILL_SEED_RECURSIVE: filled.fillPoints = Filler::fillFromSeedRecursive(polygon, seed.x, seed.y); break;
+            case Filler::FILL_COVERAGE: filled.fillPoints = Filler::fillPolygonCoverage(polygon, filled.coverage); break;
+            }
+            scene.filled.push_back(std::move(filled));
+        }
+    }
+
+    // Same polygon as PolyBuilder::createPolygonFromBezierSequence : every curve's generated points
+    // without the repeated junctions, counter clockwise
+    void flattenStage(BatchScene& scene)
+    {
+        std::vector<Polygon> flattened(scene.curves.size());
+        WorkerPool::instance().parallelFor(scene.curves.size(), [&](size_t i) {
+            const CurveShape& shape = scene.curves[i];
+            size_t pointsPerCurve = shape.record.kind == SceneFile::SCENE_SEQUENCE ? 4 : shape.controlPoints.size();
+            Polygon& polygon = flattened[i];
+
+            Bezier curve;
+            // The stages can be chained without going through a file, so don't trust the record either
+            curve.setStepSize(SceneFile::clampStepSize(shape.record.stepSize));
+            curve.setAlgorithm(shape.record.algorithm);
+            for (size_t first = 0; first + pointsPerCurve <= shape.controlPoints.size() && pointsPerCurve >= 2; first += pointsPerCurve)
+            {
+                curve.setControlPoints(std::vector<Vertex>(shape.controlPoints.begin() + first,
+                    shape.controlPoints.begin() + first + pointsPerCurve));
+                curve.generateCurve();
+
+                const std::vector<Vertex>& points = curve.getGeneratedCurve();
+                bool last = first + 2 * pointsPerCurve > shape.controlPoints.size();
+                size_t count = (last || points.empty()) ? points.size() : points.size() - 1;
+                for (size_t j = 0; j < count; j++)
+                    polygon.addVertex(points[j]);
+            }
+
+            if (polygon.isClockwise())
+                polygon.reverseOrientation();
+            polygon.type = BEZIER_CURVE;
+        });
+
+        for (Polygon& polygon : flattened)
+            if (polygon.getVertices().size() >= 2)
+                scene.polygons.push_back(std::move(polygon));
+        scene.curves.clear();
+    }
+
+    bool parseFillAlgorithm(const std::string& name, int& algorithm)
+    {
+        if (name == "scanline") algorithm = Filler::FILL_SCANLINE;
+        else if (name == "lca") algorithm = Filler::FILL_LCA;
+        else if (name == "seed") algorithm = Filler::FILL_SEED;
+        else if (name == "seed-recursive") algorithm = Filler::FILL_SEED_RECURSIVE;
+        else if (name == "coverage") algorithm = Filler::FILL_COVERAGE;
+        else return false;
+        return true;
+    }
+
+    // Paths can have backslashes (Windows) or quotes in them, which would break the JSON
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        escaped.reserve(text.size());
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned char>(c));
+                escaped += code;
+            }
+            else
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    bool writeTimings(const std::string& path, const std::string& input, const std::vector<StageTiming>& timings)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Error: Can't write " << path << std::endl;
+            return false;
+        }
+
+        double total = 0.0;
+        out << "{\n  \"input\": \"" << escapeJson(input) << "\",\n  \"threads\": " << WorkerPool::instance().getThreadCount()
+            << ",\n  \"stages\": [\n";
+        for (size_t i = 0; i < timings.size(); i++)
+        {
+            const StageTiming& timing = timings[i];
+            total += timing.milliseconds;
+            out << "    { \"name\": \"" << timing.name << "\", \"ms\": " << timing.milliseconds
+                << ", \"polygons\": " << timing.polygons << ", \"curves\": " << timing.curves
+                << ", \"filled\": " << timing.filled << " }" << (i + 1 < timings.size() ? "," : "") << "\n";
+        }
+        out << "  ],\n  \"total_ms\": " << total << "\n}\n";
+        return static_cast<bool>(out);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0)
+    {
+        printUsage();
+        return argc < 2 ? 2 : 0;
+    }
+
+    std::string input = argv[1];
+    std::string outputPath;
+    std::string timingsPath;
+    std::string imagePath;
+    int width = 800;
+    int height = 600;
+    int imageWidth = 0;
+    int imageHeight = 0;
+    std::vector<std::string> stages;
+
+    for (int i = 2; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool takesValue = argument == "-o" || argument == "--timings" || argument == "--size" ||
+            argument == "--image" || argument == "--image-size";
+        if (takesValue && i + 1 >= argc)
+        {
+            std::cerr << "Error: " << argument << " needs a value" << std::endl;
+            return 2;
+        }
+
+        if (argument == "-o")
+            outputPath = argv[++i];
+        else if (argument == "--timings")
+            timingsPath = argv[++i];
+        else if (argument == "--image")
+            imagePath = argv[++i];
+        else if (argument == "--size" || argument == "--image-size")
+        {
+            int& sizeWidth = argument == "--size" ? width : imageWidth;
+            int& sizeHeight = argument == "--size" ? height : imageHeight;
+            if (std::sscanf(argv[++i], "%dx%d", &sizeWidth, &sizeHeight) != 2 || sizeWidth <= 0 || sizeHeight <= 0)
+            {
+                std::cerr << "Error: " << argument << " expects something like 800x600" << std::endl;
+                return 2;
+            }
+        }
+        else
+            stages.push_back(argument);
+    }
+
+    // Checked before anything runs, so a typo doesn't fail after minutes of work
+    for (const std::string& stage : stages)
+    {
+        int algorithm;
+        bool valid = stage == "clip-sh" || stage == "clip-cb" || stage == "earcut" || stage == "flatten" || stage == "fill" ||
+            (stage.compare(0, 5, "fill:") == 0 && parseFillAlgorithm(stage.substr(5), algorithm));
+        if (!valid)
+        {
+            std::cerr << "Error: Unknown stage " << stage << std::endl;
+            printUsage();
+            return 2;
+        }
+    }
+
+    Filler::init(width, height);
+
+    std::vector<StageTiming> timings;
+    BatchScene scene;
+    auto timeStage = [&](const std::string& name, const auto& run) -> bool
+    {
+        auto start = std::chrono::steady_clock::now();
+        bool succeeded = run();
+        auto end = std::chrono::steady_clock::now();
+
+        StageTiming timing = { name, std::chrono::duration<double, std::milli>(end - start).count(),
+            scene.polygons.size(), scene.curves.size(), scene.filled.size() };
+        std::printf("%-16s %10.3f ms   %zu polygons, %zu curves, %zu filled\n", name.c_str(), timing.milliseconds,
+            timing.polygons, timing.curves, timing.filled);
+        timings.push_back(timing);
+        return succeeded;
+    };
+
+    bool succeeded = timeStage("load", [&]()
+        {
+            SceneFile::SceneContents contents;
+            if (!SceneFile::read(input, contents))
+                return false;
+            loadScene(contents, scene);
+            return true;
+        });
+
+    for (size_t i = 0; succeeded && i < stages.size(); i++)
+    {
+        const std::string& stage = stages[i];
+        succeeded = timeStage(stage, [&]()
+            {
+                if (stage == "clip-sh" || stage == "clip-cb")
+                    return clipStage(scene, stage == "clip-sh");
+
+                if (stage == "earcut")
+                    earCutStage(scene);
+                else if (stage == "flatten")
+                    flattenStage(scene);
+                else
+                {
+                    int algorithm = scene.fillAlgorithm;
+                    if (stage.size() > 5)
+                        parseFillAlgorithm(stage.substr(5), algorithm);
+                    fillStage(scene, algorithm);
+                }
+                return true;
+            });
+    }
+
+    if (succeeded && !imagePath.empty())
+    {
+        succeeded = timeStage("image", [&]()
+            {
+                // Same background as the window, so images look like screenshots of the fills
+                SoftwareRaster raster(imageWidth > 0 ? imageWidth : width, imageHeight > 0 ? imageHeight : height);
+                raster.clear(0.2f, 0.3f, 0.3f, 1.0f);
+                for (const FilledShape& filled : scene.filled)
+                    raster.drawFillPoints(filled.fillPoints, width, height,
+                        filled.color[0], filled.color[1], filled.color[2], filled.color[3], filled.coverage);
+                return raster.write(imagePath);
+            });
+    }
+
+    if (succeeded && !outputPath.empty())
+    {
+        succeeded = timeStage("write", [&]()
+            {
+                SceneFile::SceneContents contents;
+                storeScene(scene, contents);
+                return SceneFile::write(contents, outputPath);
+            });
+    }
+
+    // Written even after a failure, the stages that ran are still worth seeing
+    if (!timingsPath.empty() && !writeTimings(timingsPath, input, timings))
+        succeeded = false;
+
+    return succeeded ? 0 : 1;
+}
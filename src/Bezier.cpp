@@ -2,7 +2,6 @@
 #include "MathUtils.h"
 
 #include <algorithm>
-#include <glad/glad.h>
 #include <iostream>
 #include <cmath> // For pow()
 #include <chrono> // For calculating generation time
@@ -99,206 +98,16 @@ Bezier::Bezier()
 
 }
 
-Bezier::Bezier(const Bezier& other) : controlPoints(other.controlPoints), buffersInitialized(false)
-{ // Copy constructor
-    controlPoints = other.controlPoints;
-    
-    generatedCurve = other.generatedCurve;
-    convexHull = other.convexHull;
-    generationTime = other.generationTime;
-    //type = other.type;
-    if (other.buffersInitialized)
-    {
-        updateBuffers();
-    }
-}
-
-Bezier& Bezier::operator=(const Bezier& other)
-{ // Copy operator
-    if (this != &other)
-    {
-        if (buffersInitialized)
-        {
-            glDeleteVertexArrays(1, &controlVAO);
-            glDeleteVertexArrays(1, &curveVAO);
-            glDeleteVertexArrays(1, &hullVAO);
-            glDeleteBuffers(1, &controlVBO);
-            glDeleteBuffers(1, &curveVBO);
-            glDeleteBuffers(1, &hullVBO);
-            buffersInitialized = false;
-        }
-        controlPoints = other.controlPoints;
-        generatedCurve = other.generatedCurve;
-        convexHull = other.convexHull;
-        generationTime = other.generationTime;
-        
-        //type = other.type;
-        if (other.buffersInitialized)
-        {
-            updateBuffers();
-        }
-    }
-    return *this;
-}
-
-Bezier::~Bezier()
-{
-    if (buffersInitialized)
-    {
-        // When polygon is destroyed, clean up the OpenGL buffers
-        // This prevents memory leaks in the GPU
-        glDeleteVertexArrays(1, &controlVAO);
-        glDeleteVertexArrays(1, &curveVAO);
-        glDeleteVertexArrays(1, &hullVAO);
-        glDeleteBuffers(1, &controlVBO);
-        glDeleteBuffers(1, &curveVBO);
-        glDeleteBuffers(1, &hullVAO);
-    }
-}
-
 void Bezier::addControlPoint(float x, float y)
 {
-    controlPoints.push_back(Vertex(x, y));
+    addControlPoint(Vertex(x, y));
 }
 
 void Bezier::addControlPoint(Vertex vertex)
 {
     controlPoints.push_back(vertex);
-}
-
-void Bezier::updateBuffers()
-{
-    if (!buffersInitialized)
-    {
-        glGenVertexArrays(1, &controlVAO);
-        glGenVertexArrays(1, &curveVAO);
-        glGenVertexArrays(1, &hullVAO);
-        glGenBuffers(1, &controlVBO);
-        glGenBuffers(1, &curveVBO);
-        glGenBuffers(1, &hullVBO);
-        buffersInitialized = true;
-    }
-
-    // For more detailed info on those gl functions check out Polygon.cpp which has detailed comments
-    // Step 1: Bind the VAO - this records all subsequent buffer settings
-    glBindVertexArray(controlVAO);
-
-    // Step 2: Bind the VBO and upload vertex data to GPU
-    glBindBuffer(GL_ARRAY_BUFFER, controlVBO);
-    glBufferData(GL_ARRAY_BUFFER, controlPoints.size() * sizeof(Vertex), controlPoints.data(), GL_STATIC_DRAW);
-
-    // Step 3: Tell OpenGL how to interpret our vertex data
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Now do the same thing for the generated curve vertices
-    glBindVertexArray(curveVAO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, curveVBO);
-    glBufferData(GL_ARRAY_BUFFER, generatedCurve.size() * sizeof(Vertex), generatedCurve.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-
-    // Enable the vertex attribute we just configured
-    glEnableVertexAttribArray(0);
-    
-    if (convexHull.size() != 0)
-    {
-        // Again for the hull
-        glBindVertexArray(hullVAO);
-
-        glBindBuffer(GL_ARRAY_BUFFER, hullVBO);
-        glBufferData(GL_ARRAY_BUFFER, convexHull.size() * sizeof(Vertex), convexHull.data(), GL_STATIC_DRAW);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        // Enable the vertex attribute we just configured
-        glEnableVertexAttribArray(0);
-    }
-
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-}
-
-const void Bezier::drawControlPoints(Shader& shader) const
-{
-    shader.use();
-
-    // Debug: check for OpenGL errors
-    GLenum error = glGetError();
-    if (error != GL_NO_ERROR)
-    {
-        std::cout << "drawControlPoints -- OpenGL error before drawing: " << error << std::endl;
-    }
-
-    glBindVertexArray(controlVAO);
-    
-    shader.setColor("uColor", 1.0f, 0.0f, 0.5f, 1.0f);
-    glDrawArrays(GL_LINE_STRIP, 0, controlPoints.size());
-
-    shader.setColor("uColor", 1.0f, 1.0f, 1.0f, 1.0f);
-    glDrawArrays(GL_POINTS, 0, controlPoints.size());
-
-    error = glGetError();
-    if (error != GL_NO_ERROR)
-    {
-        std::cout << "drawControlPoints --  OpenGL error after drawing: " << error << std::endl;
-    }
-
-    glBindVertexArray(0); // Unbind to prevent side effects
-}
-
-const void Bezier::drawGeneratedCurve(Shader& shader) const
-{
-    shader.use();
-
-    glBindVertexArray(curveVAO);
-
-    shader.setColor("uColor", 0.0f, 0.0f, 1.0f, 1.0f);
-    glDrawArrays(GL_LINE_STRIP, 0, generatedCurve.size());
-
-    glBindVertexArray(0); // Unbind to prevent side effects
-}
-
-const void Bezier::drawControlPointsPreview(Shader& shader) const
-{
-    shader.use();
-
-    glBindVertexArray(controlVAO);
-
-    shader.setColor("uColor", 1.0f, 1.0f, 0.0f, 0.5f);
-    glDrawArrays(GL_LINE_STRIP, 0, controlPoints.size());
-
-    shader.setColor("uColor", 1.0f, 1.0f, 1.0f, 1.0f);
-    glDrawArrays(GL_POINTS, 0, controlPoints.size());
-
-    glBindVertexArray(0); // Unbind to prevent side effects
-}
-
-const void Bezier::drawGeneratedCurvePreview(Shader& shader) const
-{
-    shader.use();
-
-    glBindVertexArray(curveVAO);
-
-    shader.setColor("uColor", 0.0f, 1.0f, 1.0f, 1.0f);
-    glDrawArrays(GL_LINE_STRIP, 0, generatedCurve.size());
-
-    glBindVertexArray(0); // Unbind to prevent side effects
-}
-
-const void Bezier::drawConvexHull(Shader& shader) const
-{
-    shader.use();
-    glBindVertexArray(hullVAO);
-
-    shader.setColor("uColor", 0.0f, 1.0f, 0.5f, 0.25f);
-    glDrawArrays(GL_LINE_LOOP, 0, convexHull.size());
-
-    shader.setColor("uColor", 1.0f, 1.0f, 1.0f, 0.25f);
-    glDrawArrays(GL_POINTS, 0, convexHull.size());
-
-    glBindVertexArray(0); // Unbind to prevent side effects
+    // Keeps the hull up to date without rebuilding it
+    insertIntoConvexHull(convexHull, vertex);
 }
 
 void Bezier::generateCurve()
@@ -350,51 +159,22 @@ void Bezier::duplicateControlPoint(int index)
     generateCurve();
 }
 
-// Jarvis March Algorithm https://en.wikipedia.org/wiki/Gift_wrapping_algorithm
+// Andrew's monotone chain, see MathUtils
 void Bezier::generateConvexHull()
 {
-    int pointsSize = controlPoints.size();
-
-    if (pointsSize <= 2)
-        return;
-
-    std::vector<Vertex> resultHull;    
-    int leftmost = 0; // leftmost index
-
-    // Find leftmost point. i = 1 cause point initialized to first point in list
-    for (int i = 1; i < pointsSize; i++)
+    if (controlPoints.size() == 4)
     {
-        if (controlPoints[i].x < controlPoints[leftmost].x)
-            leftmost = i;
+        // Cubic fast path : fixed size, everything stays on the stack and the hull keeps its capacity
+        Vertex points[4] = { controlPoints[0], controlPoints[1], controlPoints[2], controlPoints[3] };
+        Vertex hull[8];
+        int hullSize = monotoneChainHull(points, 4, hull);
+        convexHull.assign(hull, hull + hullSize);
+        return;
     }
 
-    int currentPoint = leftmost;
-    int nextPoint;
-
-    do
-    {
-        resultHull.push_back(controlPoints[currentPoint]);
-
-        // % pointsSize allows us to loop back to 0 when reaching end of points
-        nextPoint = (currentPoint + 1) % pointsSize;
-
-        for (int i = 0; i < pointsSize; i++)
-        {
-            if (i == currentPoint) continue; // Skip current point
-
-            int o = orientation(controlPoints[currentPoint], controlPoints[i], controlPoints[nextPoint]);
-            // If point i is counter clockwise OR collinear and further away than nextPoint
-            if (o == 2 || (o == 0 && squaredDistance(controlPoints[currentPoint], controlPoints[i]) > squaredDistance(controlPoints[currentPoint], controlPoints[nextPoint])))
-                nextPoint = i;
-
-        }
-
-        currentPoint = nextPoint;
-
-    } while (currentPoint != leftmost);
-
-    convexHull = resultHull;
+    convexHull = monotoneChainHull(controlPoints);
 }
+
 std::pair<Bezier, Bezier> Bezier::subdivide(float t) const
 {
     Bezier leftCurve, rightCurve;
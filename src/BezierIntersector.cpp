@@ -0,0 +1,525 @@
+#include "BezierIntersector.h"
+#include "MathUtils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace MathUtils;
+
+void BezierIntersector::subdivide(const CurveSpan& curve, float t, CurveSpan& left, CurveSpan& right)
+{
+    int n = curve.count;
+
+    Vertex temp[CurveSpan::maxPoints];
+    std::copy(curve.points, curve.points + n, temp);
+
+    left.count = n;
+    right.count = n;
+    left.points[0] = curve.points[0];
+    right.points[n - 1] = curve.points[n - 1];
+
+    // Same as Bezier::subdivide, the edges of the De Casteljau triangle are the two new curves
+    for (int r = 1; r <= n - 1; r++)
+    {
+        for (int i = 0; i <= n - 1 - r; i++)
+            temp[i] = temp[i] * (1.0f - t) + temp[i + 1] * t;
+
+        left.points[r] = temp[0];
+        right.points[n - 1 - r] = temp[n - 1 - r];
+    }
+
+    float tSplit = curve.tStart + (curve.tEnd - curve.tStart) * t;
+    left.tStart = curve.tStart;
+    left.tEnd = tSplit;
+    right.tStart = tSplit;
+    right.tEnd = curve.tEnd;
+}
+
+float BezierIntersector::flatness(const CurveSpan& curve)
+{
+    const Vertex& start = curve.points[0];
+    const Vertex& end = curve.points[curve.count - 1];
+
+    Vertex line = end - start;
+    float lineLength = std::sqrt(line.x * line.x + line.y * line.y);
+
+    // A point (or almost) counts as flat
+    if (lineLength < 1e-6f)
+        return 0.0f;
+
+    float maxDistance = 0.0f;
+    for (int i = 1; i < curve.count - 1; i++)
+    {
+        float distance = std::abs(cross2D(line, curve.points[i] - start)) / lineLength;
+        maxDistance = std::max(maxDistance, distance);
+    }
+
+    return maxDistance;
+}
+
+// Overlap of both hulls projected on the normal of every edge of hull
+static bool separatedByEdgeOf(const Vertex* hull, int hullSize, const Vertex* otherHull, int otherSize)
+{
+    for (int i = 0; i < hullSize; i++)
+    {
+        Vertex edge = hull[(i + 1) % hullSize] - hull[i];
+        Vertex axis(-edge.y, edge.x);
+
+        float minA = FLT_MAX, maxA = -FLT_MAX;
+        for (int j = 0; j < hullSize; j++)
+        {
+            float projection = dot2D(hull[j], axis);
+            minA = std::min(minA, projection);
+            maxA = std::max(maxA, projection);
+        }
+
+        float minB = FLT_MAX, maxB = -FLT_MAX;
+        for (int j = 0; j < otherSize; j++)
+        {
+            float projection = dot2D(otherHull[j], axis);
+            minB = std::min(minB, projection);
+            maxB = std::max(maxB, projection);
+        }
+
+        if (maxA < minB || maxB < minA)
+            return true;
+    }
+
+    return false;
+}
+
+bool BezierIntersector::hullsOverlap(const CurveSpan& a, const CurveSpan& b)
+{
+    // monotoneChainHull sorts its input, so it gets copies
+    Vertex pointsA[CurveSpan::maxPoints], pointsB[CurveSpan::maxPoints];
+    Vertex hullA[2 * CurveSpan::maxPoints], hullB[2 * CurveSpan::maxPoints];
+    std::copy(a.points, a.points + a.count, pointsA);
+    std::copy(b.points, b.points + b.count, pointsB);
+
+    int hullSizeA = monotoneChainHull(pointsA, a.count, hullA);
+    int hullSizeB = monotoneChainHull(pointsB, b.count, hullB);
+
+    return !separatedByEdgeOf(hullA, hullSizeA, hullB, hullSizeB)
+        && !separatedByEdgeOf(hullB, hullSizeB, hullA, hullSizeA);
+}
+
+// Like MathUtils::lineSegmentsIntersect, but gives back where along each segment
+static bool segmentsIntersect(const Vertex& a0, const Vertex& a1, const Vertex& b0, const Vertex& b1,
+    float& ratioA, float& ratioB)
+{
+    Vertex directionA = a1 - a0;
+    Vertex directionB = b1 - b0;
+
+    float crossProduct = cross2D(directionA, directionB);
+    if (std::abs(crossProduct) < 1e-6f)
+        return false; // Parallel
+
+    Vertex startDifference = b0 - a0;
+    ratioA = cross2D(startDifference, directionB) / crossProduct;
+    ratioB = cross2D(startDifference, directionA) / crossProduct;
+
+    return ratioA >= 0.0f && ratioA <= 1.0f && ratioB >= 0.0f && ratioB <= 1.0f;
+}
+
+float BezierIntersector::extent(const CurveSpan& curve)
+{
+    float maxDistance = 0.0f;
+    for (int i = 1; i < curve.count; i++)
+        maxDistance = std::max(maxDistance, squaredDistance(curve.points[0], curve.points[i]));
+
+    return std::sqrt(maxDistance);
+}
+
+int BezierIntersector::fatLineInterval(const CurveSpan& curve, const CurveSpan& other, float& tMin, float& tMax)
+{
+    // The fat line is the line through other's end points, thick enough to hold all its control points
+    const Vertex& lineStart = other.points[0];
+    Vertex line = other.points[other.count - 1] - lineStart;
+    float lineLength = std::sqrt(line.x * line.x + line.y * line.y);
+    if (lineLength < 1e-9f)
+        return 2;
+
+    Vertex normal(-line.y / lineLength, line.x / lineLength);
+
+    // A tiny margin, or float noise can put a crossing just outside a line that has become very thin
+    const float margin = 1e-6f;
+    float dMin = -margin, dMax = margin;
+    for (int i = 1; i < other.count - 1; i++)
+    {
+        float distance = dot2D(normal, other.points[i] - lineStart);
+        dMin = std::min(dMin, distance - margin);
+        dMax = std::max(dMax, distance + margin);
+    }
+
+    // The signed distance to that line along curve is itself a Bézier curve, with control points
+    // (i / degree, distance of point i). Its hull tells where it can be between dMin and dMax
+    Vertex distancePoints[CurveSpan::maxPoints];
+    Vertex hull[2 * CurveSpan::maxPoints];
+    int degree = curve.count - 1;
+    for (int i = 0; i < curve.count; i++)
+        distancePoints[i] = Vertex(static_cast<float>(i) / degree, dot2D(normal, curve.points[i] - lineStart));
+
+    int hullSize = monotoneChainHull(distancePoints, curve.count, hull);
+
+    tMin = FLT_MAX;
+    tMax = -FLT_MAX;
+    for (int i = 0; i < hullSize; i++)
+    {
+        const Vertex& p = hull[i];
+        const Vertex& q = hull[(i + 1) % hullSize];
+
+        if (p.y >= dMin && p.y <= dMax)
+        {
+            tMin = std::min(tMin, p.x);
+            tMax = std::max(tMax, p.x);
+        }
+
+        // Where the hull edge crosses the borders of the fat line
+        for (float border : { dMin, dMax })
+        {
+            if ((p.y - border) * (q.y - border) < 0.0f)
+            {
+                float t = p.x + (border - p.y) * (q.x - p.x) / (q.y - p.y);
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+        }
+    }
+
+    if (tMin > tMax)
+        return 0;
+
+    tMin = std::max(0.0f, tMin);
+    tMax = std::min(1.0f, tMax);
+    return 1;
+}
+
+void BezierIntersector::addHit(std::vector<BezierHit>& hits, size_t firstHit, const BezierHit& hit)
+{
+    // Neighbouring pieces can find the same crossing
+    for (size_t i = firstHit; i < hits.size(); i++)
+    {
+        if (squaredDistance(hits[i].point, hit.point) < 1e-6f)
+            return;
+    }
+
+    hits.push_back(hit);
+}
+
+void BezierIntersector::addSegmentHit(const CurveSpan& a, const CurveSpan& b, std::vector<BezierHit>& hits, size_t firstHit)
+{
+    const Vertex& a0 = a.points[0];
+    const Vertex& a1 = a.points[a.count - 1];
+    const Vertex& b0 = b.points[0];
+    const Vertex& b1 = b.points[b.count - 1];
+
+    float ratioA, ratioB;
+    if (!segmentsIntersect(a0, a1, b0, b1, ratioA, ratioB))
+        return;
+
+    BezierHit hit;
+    hit.point = a0 + (a1 - a0) * ratioA;
+    hit.t1 = a.tStart + (a.tEnd - a.tStart) * ratioA;
+    hit.t2 = b.tStart + (b.tEnd - b.tStart) * ratioB;
+    addHit(hits, firstHit, hit);
+}
+
+bool BezierIntersector::intersect(const Vertex* pointsA, int countA, const Vertex* pointsB, int countB,
+    std::vector<BezierHit>& hits)
+{
+    if (!canHandle(countA) || !canHandle(countB))
+        return false;
+
+    CurveSpan a, b;
+    std::copy(pointsA, pointsA + countA, a.points);
+    std::copy(pointsB, pointsB + countB, b.points);
+    a.count = countA;
+    b.count = countB;
+
+    // Hits from an earlier call aren't ours to deduplicate against
+    intersectSpans(a, b, hits, hits.size());
+    return true;
+}
+
+void BezierIntersector::intersectSpans(const CurveSpan& a, const CurveSpan& b, std::vector<BezierHit>& hits, size_t firstHit)
+{
+    stack.clear();
+    stack.push_back({ a, b, 0, true });
+
+    lastIterations = 0;
+    lastTruncated = false;
+    if (method == 1)
+        intersectByClipping(hits, firstHit);
+    else
+        intersectBySubdivision(hits, firstHit);
+}
+
+// Value at t of a polynomial given by its Bernstein coefficients (De Casteljau on numbers)
+static float evaluateBernstein(const float* coefficients, int count, float t)
+{
+    float temp[CurveSpan::maxPoints];
+    std::copy(coefficients, coefficients + count, temp);
+
+    for (int r = 1; r < count; r++)
+        for (int i = 0; i < count - r; i++)
+            temp[i] = temp[i] * (1.0f - t) + temp[i + 1] * t;
+
+    return temp[0];
+}
+
+int BezierIntersector::splitMonotone(const CurveSpan& curve, CurveSpan* pieces)
+{
+    // Where the derivative of x or y is 0. The derivative of a Bézier curve is a Bézier curve
+    // one degree lower, with control points degree * (P(i+1) - P(i)) (the factor doesn't change the roots)
+    float splits[2 * CurveSpan::maxPoints];
+    int splitCount = 0;
+
+    int derivativeCount = curve.count - 1;
+    if (derivativeCount >= 2)
+    {
+        for (int axis = 0; axis < 2; axis++)
+        {
+            float derivative[CurveSpan::maxPoints];
+            for (int i = 0; i < derivativeCount; i++)
+            {
+                Vertex difference = curve.points[i + 1] - curve.points[i];
+                derivative[i] = axis == 0 ? difference.x : difference.y;
+            }
+
+            // Sign changes between samples, refined by bisection, and samples landing right on a root.
+            // Enough samples for the at most derivativeCount - 1 roots to land in different intervals
+            const int samples = 8 * derivativeCount;
+            float previousT = 0.0f;
+            float previousValue = evaluateBernstein(derivative, derivativeCount, 0.0f);
+            for (int s = 1; s <= samples; s++)
+            {
+                float t = static_cast<float>(s) / samples;
+                float value = evaluateBernstein(derivative, derivativeCount, t);
+
+                // Symmetric curves often have their roots exactly at 1/4, 1/2... there's no sign
+                // change on either side of such a sample, so it would be missed
+                if (value == 0.0f)
+                {
+                    if (splitCount < 2 * CurveSpan::maxPoints)
+                        splits[splitCount++] = t;
+                }
+                else if ((previousValue < 0.0f && value > 0.0f) || (previousValue > 0.0f && value < 0.0f))
+                {
+                    float low = previousT, high = t;
+                    float lowValue = previousValue;
+                    for (int iteration = 0; iteration < 32; iteration++)
+                    {
+                        float middle = (low + high) * 0.5f;
+                        float middleValue = evaluateBernstein(derivative, derivativeCount, middle);
+                        if ((middleValue < 0.0f) == (lowValue < 0.0f))
+                        {
+                            low = middle;
+                            lowValue = middleValue;
+                        }
+                        else
+                        {
+                            high = middle;
+                        }
+                    }
+
+                    if (splitCount < 2 * CurveSpan::maxPoints)
+                        splits[splitCount++] = (low + high) * 0.5f;
+                }
+
+                previousT = t;
+                previousValue = value;
+            }
+        }
+    }
+
+    std::sort(splits, splits + splitCount);
+
+    // Cut left to right, skipping splits too close to the previous one or to the ends
+    int pieceCount = 0;
+    CurveSpan remaining = curve;
+    float lastSplit = 0.0f;
+    for (int i = 0; i < splitCount; i++)
+    {
+        float t = splits[i];
+        if (t - lastSplit < 1e-4f || t > 1.0f - 1e-4f)
+            continue;
+
+        // remaining covers [lastSplit, 1], t has to be brought back to its own 0..1
+        CurveSpan rest;
+        subdivide(remaining, (t - lastSplit) / (1.0f - lastSplit), pieces[pieceCount++], rest);
+        remaining = rest;
+        lastSplit = t;
+    }
+    pieces[pieceCount++] = remaining;
+
+    return pieceCount;
+}
+
+bool BezierIntersector::selfIntersect(const Vertex* points, int count, std::vector<BezierHit>& hits)
+{
+    if (!canHandle(count))
+        return false;
+
+    // Up to quadratics, curves can't cross themselves
+    if (count < 4)
+        return true;
+
+    CurveSpan curve;
+    std::copy(points, points + count, curve.points);
+    curve.count = count;
+
+    CurveSpan pieces[2 * CurveSpan::maxPoints];
+    int pieceCount = splitMonotone(curve, pieces);
+
+    // A closed curve's ends touch, that's not a crossing either
+    bool isClosed = squaredDistance(points[0], points[count - 1]) < 1e-12f;
+    const float junctionTolerance = 1e-3f;
+
+    size_t firstHit = hits.size();
+    int iterations = 0;
+    bool truncated = false;
+    for (int i = 0; i < pieceCount; i++)
+    {
+        for (int j = i + 1; j < pieceCount; j++)
+        {
+            size_t before = hits.size();
+            intersectSpans(pieces[i], pieces[j], hits, firstHit);
+            iterations += lastIterations;
+            truncated = truncated || lastTruncated;
+
+            // Neighbouring pieces always meet where they were cut, drop that point
+            bool areNeighbours = j == i + 1;
+            bool closingPieces = isClosed && i == 0 && j == pieceCount - 1;
+            if (!areNeighbours && !closingPieces)
+                continue;
+
+            float junctionT1 = areNeighbours ? pieces[i].tEnd : 0.0f;
+            float junctionT2 = areNeighbours ? pieces[j].tStart : 1.0f;
+            hits.erase(std::remove_if(hits.begin() + before, hits.end(), [&](const BezierHit& hit) {
+                return std::abs(hit.t1 - junctionT1) < junctionTolerance && std::abs(hit.t2 - junctionT2) < junctionTolerance;
+            }), hits.end());
+        }
+    }
+
+    lastIterations = iterations;
+    lastTruncated = truncated;
+    return true;
+}
+
+void BezierIntersector::intersectBySubdivision(std::vector<BezierHit>& hits, size_t firstHit)
+{
+    while (!stack.empty())
+    {
+        // Copied out because pushing the children may reallocate the stack
+        Task task = stack.back();
+        stack.pop_back();
+        lastIterations++;
+
+        if (!hullsOverlap(task.a, task.b))
+            continue;
+
+        // Both pieces are close enough to lines (or we went deep enough), treat them as segments
+        if ((flatness(task.a) < flatnessThreshold && flatness(task.b) < flatnessThreshold) || task.depth >= maxDepth)
+        {
+            addSegmentHit(task.a, task.b, hits, firstHit);
+            continue;
+        }
+
+        // Pushed in reverse so left/left gets tested first, like the recursive version
+        size_t base = stack.size();
+        stack.resize(base + 4);
+
+        CurveSpan aLeft, aRight, bLeft, bRight;
+        subdivide(task.a, 0.5f, aLeft, aRight);
+        subdivide(task.b, 0.5f, bLeft, bRight);
+
+        stack[base] = { aRight, bRight, task.depth + 1, true };
+        stack[base + 1] = { aRight, bLeft, task.depth + 1, true };
+        stack[base + 2] = { aLeft, bRight, task.depth + 1, true };
+        stack[base + 3] = { aLeft, bLeft, task.depth + 1, true };
+    }
+}
+
+void BezierIntersector::intersectByClipping(std::vector<BezierHit>& hits, size_t firstHit)
+{
+    // Pieces smaller than this are considered points
+    const float pointTolerance = 1e-5f;
+    // Halving happens when a clip keeps more than 80% of the curve (probably several crossings),
+    // this bounds how many times (overlapping curves would halve forever otherwise)
+    const int maxSplitDepth = 4 * maxDepth;
+    // Last resort against tangent curves, where clipping converges slowly
+    const int maxIterations = 4096;
+
+    while (!stack.empty() && lastIterations < maxIterations)
+    {
+        Task task = stack.back();
+        stack.pop_back();
+        lastIterations++;
+
+        if (extent(task.a) < pointTolerance && extent(task.b) < pointTolerance)
+        {
+            BezierHit hit;
+            hit.point = (task.a.points[0] + task.a.points[task.a.count - 1]) * 0.5f;
+            hit.t1 = (task.a.tStart + task.a.tEnd) * 0.5f;
+            hit.t2 = (task.b.tStart + task.b.tEnd) * 0.5f;
+            addHit(hits, firstHit, hit);
+            continue;
+        }
+
+        CurveSpan& clipped = task.clipFirst ? task.a : task.b;
+        const CurveSpan& fatLine = task.clipFirst ? task.b : task.a;
+
+        float tMin, tMax;
+        int result = fatLineInterval(clipped, fatLine, tMin, tMax);
+        if (result == 0)
+            continue; // Nothing of this curve is near the other one
+
+        if (result == 1)
+        {
+            // Keep only [tMin, tMax] of the clipped curve
+            CurveSpan left, right, unused;
+            subdivide(clipped, tMax, left, unused);
+            subdivide(left, tMax > 1e-12f ? tMin / tMax : 0.0f, unused, right);
+            clipped = right;
+        }
+
+        // Clipping didn't help much (or couldn't be done), split the longest one in half instead
+        if ((result == 2 || tMax - tMin > 0.8f) && task.depth < maxSplitDepth)
+        {
+            bool splitFirst = (task.a.tEnd - task.a.tStart) > (task.b.tEnd - task.b.tStart);
+            CurveSpan& split = splitFirst ? task.a : task.b;
+
+            CurveSpan left, right;
+            subdivide(split, 0.5f, left, right);
+
+            size_t base = stack.size();
+            stack.resize(base + 2);
+            stack[base] = task;
+            stack[base + 1] = task;
+            (splitFirst ? stack[base].a : stack[base].b) = right;
+            (splitFirst ? stack[base + 1].a : stack[base + 1].b) = left;
+            stack[base].depth = task.depth + 1;
+            stack[base + 1].depth = task.depth + 1;
+            stack[base].clipFirst = !task.clipFirst;
+            stack[base + 1].clipFirst = !task.clipFirst;
+            continue;
+        }
+
+        task.clipFirst = !task.clipFirst;
+        stack.push_back(task);
+    }
+
+    // Out of iterations : the pieces left are resolved as they are, like subdivision does at maxDepth,
+    // rather than dropped with the crossings they may hold
+    if (!stack.empty())
+    {
+        lastTruncated = true;
+        for (const Task& task : stack)
+        {
+            if (hullsOverlap(task.a, task.b))
+                addSegmentHit(task.a, task.b, hits, firstHit);
+        }
+        stack.clear();
+    }
+}
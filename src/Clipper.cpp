@@ -128,7 +128,6 @@ namespace Clipper
             }
         }
 
-        resultPoly.updateBuffers();
         return resultPoly;
     }
 
@@ -189,7 +188,6 @@ namespace Clipper
         }
 
         clippedPoly.setVertices(buildingVertices);
-        clippedPoly.updateBuffers();
         return clippedPoly;
     }
 
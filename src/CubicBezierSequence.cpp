@@ -1,14 +1,19 @@
 ﻿#include "CubicBezierSequence.h"
 #include "MathUtils.h"
+#include "WorkerPool.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 
 using namespace MathUtils;
 
-CubicBezierSequence::~CubicBezierSequence()
+CubicBezierSequence::CubicBezierSequence(const CubicBezierSequence& other)
+    : curves(other.curves), continuityType(other.continuityType), stepSize(other.stepSize),
+    algorithm(other.algorithm), generationTime(other.generationTime), isClosed(other.isClosed),
+    modelMatrix(other.modelMatrix), hasModelMatrix(other.hasModelMatrix)
 {
-    // Vector handles everything by itself
 }
 
 CubicBezierSequence& CubicBezierSequence::operator=(const CubicBezierSequence& other) {
@@ -26,43 +31,82 @@ CubicBezierSequence& CubicBezierSequence::operator=(const CubicBezierSequence& o
         generationTime = other.generationTime;
         continuityType = other.continuityType;
         isClosed = other.isClosed;
+        modelMatrix = other.modelMatrix;
+        hasModelMatrix = other.hasModelMatrix;
+        dirtyCurves.clear();
+        changedCurves.clear();
     }
     return *this;
 }
 
 void CubicBezierSequence::addCurve(const Bezier& curve)
 {
-    curves.push_back(curve);
+    // Rebuilt from its points so it takes the sequence's step size and algorithm
+    Bezier segment;
+    segment.setControlPoints(curve.getControlPoints());
+    segment.setStepSize(stepSize);
+    segment.setAlgorithm(algorithm);
+    curves.push_back(std::move(segment));
+
+    markDirty(curves.size() - 1);
 }
 
-void CubicBezierSequence::incrementStepSize()
+void CubicBezierSequence::loadControlPoints(const Vertex* first, const Vertex* last, bool closed)
 {
-    for (auto& curve : curves)
+    curves.clear();
+    dirtyCurves.clear();
+    changedCurves.clear();
+    curves.reserve((last - first) / 4);
+    for (const Vertex* point = first; last - point >= 4; point += 4)
     {
-        curve.incrementStepSize();
+        Bezier segment;
+        segment.setControlPoints(std::vector<Vertex>(point, point + 4));
+        curves.push_back(std::move(segment));
     }
-    stepSize = curves[0].getStepSize(); // Replicate change on this
-    calculateGenerationTime();
+    // The points already go back to the start, so there's nothing to enforce
+    isClosed = closed && !curves.empty();
+}
+
+void CubicBezierSequence::incrementStepSize()
+{
+    if (curves.empty() || stepSize >= 1.0f)
+        return;
+
+    stepSize += 0.001f;
+    regenerateCurves();
 }
 
 void CubicBezierSequence::decrementStepSize()
 {
-    for (auto& curve : curves)
-    {
-        curve.decrementStepSize();
-    }
-    stepSize = curves[0].getStepSize();
-    calculateGenerationTime();
+    if (curves.empty() || stepSize <= 0.001f)
+        return;
+
+    stepSize -= 0.001f;
+    regenerateCurves();
 }
 
 void CubicBezierSequence::swapAlgorithm()
 {
-    for (auto& curve : curves)
-    {
-        curve.swapAlgorithm();
-    }
-    algorithm = curves[0].getAlgorithm();
-    calculateGenerationTime();
+    if (curves.empty())
+        return;
+
+    algorithm = algorithm == 0 ? 1 : 0;
+    regenerateCurves();
+}
+
+void CubicBezierSequence::regenerateCurves()
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Each curve only touches its own vectors, so they can all be generated at the same time
+    WorkerPool::instance().parallelFor(curves.size(), [this](size_t i) {
+        curves[i].setStepSize(stepSize);
+        curves[i].setAlgorithm(algorithm);
+        curves[i].generateCurve();
+    });
+
+    auto end = std::chrono::steady_clock::now();
+    generationTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
 }
 
 void CubicBezierSequence::calculateGenerationTime()
@@ -70,183 +114,123 @@ void CubicBezierSequence::calculateGenerationTime()
     generationTime = 0.0f;
     for (const auto& curve : curves)
     {
-        std::cout << "Generation time for curve : " << curve.getGenerationTime() << std::endl;
         generationTime += curve.getGenerationTime();
     }
 }
 
-void CubicBezierSequence::enforceConstraints() {
-    if (curves.size() < 2) return;
+// Squared distance under which we consider a constrained point already in place
+static const float satisfiedEpsilon = 1e-12f;
 
-    // Constants to control curve shape
-    const float percentage = 0.4f;      // Use 40% of previous segment length
-    const float maxDistance = 0.2f;     // Maximum control point distance (in normalized coords)
+static bool samePoint(const Vertex& a, const Vertex& b)
+{
+    return squaredDistance(a, b) < satisfiedEpsilon;
+}
 
-    for (size_t i = 1; i < curves.size(); i++) {
-        Bezier& prevCurve = curves[i - 1];
-        Bezier& nextCurve = curves[i];
+void CubicBezierSequence::markDirty(size_t curveIndex)
+{
+    // Duplicates are removed when flushing (keeping the first one), this just avoids the obvious ones
+    if (!dirtyCurves.empty() && dirtyCurves.back().index == curveIndex)
+        return;
+
+    CurveEdit edit;
+    edit.index = curveIndex;
+    const std::vector<Vertex>& points = curves[curveIndex].getControlPoints();
+    std::copy(points.begin(), points.begin() + 4, edit.before);
+    dirtyCurves.push_back(edit);
+}
 
-        std::vector<Vertex> prevCurveControlPoints = prevCurve.getControlPoints();
-        std::vector<Vertex> nextCurveControlPoints = nextCurve.getControlPoints();
+void CubicBezierSequence::setCurvePoint(size_t curveIndex, int pointIndex, const Vertex& point)
+{
+    if (samePoint(curves[curveIndex].getControlPoints()[pointIndex], point))
+        return;
 
-        // Skip this iteration
-        if (isClosed && i == curves.size() - 1) {
-            continue;
-        }
+    markDirty(curveIndex);
+    curves[curveIndex].setControlPoint(pointIndex, point);
+}
 
-        const Vertex& P1 = prevCurveControlPoints[1];
-        const Vertex& P2 = prevCurveControlPoints[2];
-        const Vertex& P3 = prevCurveControlPoints[3]; // Same as Q0
+bool CubicBezierSequence::enforceJunction(size_t i) {
+    // Constants to control curve shape
+    const float percentage = 0.4f;      // Use 40% of previous segment length
+    const float maxDistance = 0.2f;     // Maximum control point distance (in normalized coords)
 
-        // C0 continuity - curves meet at a point
-        nextCurveControlPoints[0] = P3;
+    // Only compare against the points we write, reading them directly (no vector copies)
+    const std::vector<Vertex>& prevCurveControlPoints = curves[i - 1].getControlPoints();
+    const std::vector<Vertex>& nextCurveControlPoints = curves[i].getControlPoints();
 
-        if (continuityType >= 1) {
-            // Calculate tangent vector
-            Vertex tangent = P3 - P2;
-            float tangentLength = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y);
+    const Vertex P1 = prevCurveControlPoints[1];
+    const Vertex P2 = prevCurveControlPoints[2];
+    const Vertex P3 = prevCurveControlPoints[3]; // Same as Q0
 
-            if (tangentLength > 0.001f) {
-                // Normalize the tangent
-                Vertex tangentDir = tangent * (1.0f / tangentLength);
+    // C0 continuity - curves meet at a point
+    Vertex Q0 = P3;
+    Vertex Q1 = nextCurveControlPoints[1];
+    Vertex Q2 = nextCurveControlPoints[2];
 
-                // Calculate desired length with absolute cap
-                float desiredLength = std::min(tangentLength * percentage, maxDistance);
+    // The last curve of a closed sequence gets its tangents from the first curve (see enforceClosure)
+    bool onlyC0 = isClosed && i == curves.size() - 1;
 
-                // Place Q1 along the tangent with controlled length
-                nextCurveControlPoints[1] = P3 + tangentDir * desiredLength;
+    if (continuityType >= 1 && !onlyC0) {
+        // Calculate tangent vector
+        Vertex tangent = P3 - P2;
+        float tangentLength = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y);
 
-                if (continuityType >= 2) {
-                    // For C2, we need to respect curvature but control magnitude
-                    // Calculate second derivative of first curve at P3
-                    Vertex secondDerivP = P3 - P2 * 2 + P1;
+        if (tangentLength > 0.001f) {
+            // Normalize the tangent
+            Vertex tangentDir = tangent * (1.0f / tangentLength);
 
-                    // Scale it by k1^2 (k1 is tangent ratio)
-                    float k1 = desiredLength / tangentLength;
-                    float k1Squared = k1 * k1;
+            // Calculate desired length with absolute cap
+            float desiredLength = std::min(tangentLength * percentage, maxDistance);
 
-                    // Apply C2 formula: Q2 = 2*Q1 - Q0 + k1^2*(P3-2*P2+P1)
-                    nextCurveControlPoints[2] = nextCurveControlPoints[1] * 2 - nextCurveControlPoints[0]
-                        + secondDerivP * k1Squared;
+            // Place Q1 along the tangent with controlled length
+            Q1 = P3 + tangentDir * desiredLength;
 
-                    // Apply max distance constraint if needed
-                    Vertex Q1Q2 = nextCurveControlPoints[2] - nextCurveControlPoints[1];
-                    float Q1Q2Length = std::sqrt(Q1Q2.x * Q1Q2.x + Q1Q2.y * Q1Q2.y);
+            if (continuityType >= 2) {
+                // For C2, we need to respect curvature but control magnitude
+                // Calculate second derivative of first curve at P3
+                Vertex secondDerivP = P3 - P2 * 2 + P1;
 
-                    if (Q1Q2Length > maxDistance) {
-                        Q1Q2 = Q1Q2 * (maxDistance / Q1Q2Length);
-                        nextCurveControlPoints[2] = nextCurveControlPoints[1] + Q1Q2;
-                    }
-                }
-            }
-        }
+                // Scale it by k1^2 (k1 is tangent ratio)
+                float k1 = desiredLength / tangentLength;
+                float k1Squared = k1 * k1;
 
-        nextCurve.setControlPoints(nextCurveControlPoints);
-        nextCurve.generateCurve();
-        nextCurve.updateBuffers();
-    }
+                // Apply C2 formula: Q2 = 2*Q1 - Q0 + k1^2*(P3-2*P2+P1)
+                Q2 = Q1 * 2 - Q0 + secondDerivP * k1Squared;
+
+                // Apply max distance constraint if needed
+                Vertex Q1Q2 = Q2 - Q1;
+                float Q1Q2Length = std::sqrt(Q1Q2.x * Q1Q2.x + Q1Q2.y * Q1Q2.y);
 
-    if (isClosed) {
-        Bezier& firstCurve = curves[0];
-        Bezier& lastCurve = curves[curves.size() - 1];
-
-        std::vector<Vertex> firstControlPoints = firstCurve.getControlPoints();
-        std::vector<Vertex> lastControlPoints = lastCurve.getControlPoints();
-
-        // Enforce C0 continuity: Make last point match first point
-        lastControlPoints[3] = firstControlPoints[0];
-
-        // Constants to control curve shape - similar to your enforceConstraints method
-        const float percentage = 0.4f;      // Use 40% of previous segment length
-        const float maxDistance = 0.2f;     // Maximum control point distance
-
-        if (continuityType >= 1) {
-            // C1 continuity: Make incoming/outgoing tangents align
-            // Calculate tangent at the beginning of the first curve
-            Vertex tangent = firstControlPoints[1] - firstControlPoints[0];
-            float tangentLength = std::sqrt(tangent.x * tangent.x + tangent.y * tangent.y);
-
-            if (tangentLength > 0.001f) {
-                // Normalize the tangent
-                Vertex tangentDir = tangent * (1.0f / tangentLength);
-
-                // Calculate desired length with absolute cap
-                float desiredLength = std::min(tangentLength * percentage, maxDistance);
-
-                // Place the second-to-last control point to create the same tangent
-                // but in the opposite direction
-                lastControlPoints[2] = lastControlPoints[3] - tangentDir * desiredLength;
-
-                if (continuityType >= 2) {
-                    // C2 continuity: Match curvature at the junction
-                    // Get second derivatives
-                    Vertex secondDerivFirst = firstControlPoints[2] - firstControlPoints[1] * 2.0f + firstControlPoints[0];
-
-                    // Scale the second derivative by the squared ratio of the tangent lengths
-                    float k1 = desiredLength / tangentLength;
-                    float k1Squared = k1 * k1;
-
-                    // Apply C2 formula (derived from matching second derivatives)
-                    // Q1 = junction point (P3 or Q0)
-                    // Q2 = lastControlPoints[2] (already set for C1)
-                    // We need to set Q3 to maintain C2 continuity
-                    lastControlPoints[1] = lastControlPoints[2] * 2.0f - lastControlPoints[3]
-                        + secondDerivFirst * k1Squared;
-
-                    // Apply max distance constraint if needed
-                    Vertex Q2Q1 = lastControlPoints[1] - lastControlPoints[2];
-                    float Q2Q1Length = std::sqrt(Q2Q1.x * Q2Q1.x + Q2Q1.y * Q2Q1.y);
-
-                    if (Q2Q1Length > maxDistance) {
-                        Q2Q1 = Q2Q1 * (maxDistance / Q2Q1Length);
-                        lastControlPoints[1] = lastControlPoints[2] + Q2Q1;
-                    }
+                if (Q1Q2Length > maxDistance) {
+                    Q1Q2 = Q1Q2 * (maxDistance / Q1Q2Length);
+                    Q2 = Q1 + Q1Q2;
                 }
             }
         }
-
-        lastCurve.setControlPoints(lastControlPoints);
-        lastCurve.generateCurve();
-        lastCurve.updateBuffers();
     }
-}
 
-void CubicBezierSequence::setContinuityType(int type)
-{
-    if (type >= 0 && type <= 2)
-        continuityType = type;
-}
-
-bool CubicBezierSequence::isConstrainedPoint(int curveIndex, int pointIndex) const
-{
-    if (curveIndex == 0) {
-        // First curve has no backward constraints
-        return false;
-    }
+    if (samePoint(nextCurveControlPoints[0], Q0) && samePoint(nextCurveControlPoints[1], Q1)
+        && samePoint(nextCurveControlPoints[2], Q2))
+        return false; // Already satisfied
 
-    // For all other curves:
-    if (pointIndex == 0) return true; // Q0 is always constrained (C0)
-    if (pointIndex == 1 && continuityType >= 1) return true; // Q1 constrained in C1, C2
-    if (pointIndex == 2 && continuityType >= 2) return true; // Q2 constrained in C2
-
-    return false;
+    setCurvePoint(i, 0, Q0);
+    setCurvePoint(i, 1, Q1);
+    setCurvePoint(i, 2, Q2);
+    return true;
 }
 
-void CubicBezierSequence::makeClosed() {
-    if (curves.size() < 1) return;
-
-    // Get first and last curves
-    Bezier& firstCurve = curves[0];
-    Bezier& lastCurve = curves[curves.size() - 1];
+bool CubicBezierSequence::enforceClosure() {
+    if (curves.empty()) return false;
 
-    // Get control points
-    std::vector<Vertex> lastControlPoints = lastCurve.getControlPoints();
-    std::vector<Vertex> firstControlPoints = firstCurve.getControlPoints();
+    const std::vector<Vertex>& firstControlPoints = curves.front().getControlPoints();
+    const std::vector<Vertex>& lastControlPoints = curves.back().getControlPoints();
+    size_t lastIndex = curves.size() - 1;
 
     // Enforce C0 continuity: Make last point match first point
-    lastControlPoints[3] = firstControlPoints[0];
+    Vertex P3 = firstControlPoints[0];
+    Vertex P2 = lastControlPoints[2];
+    Vertex P1 = lastControlPoints[1];
 
-    // Constants to control curve shape - similar to your enforceConstraints method
+    // Constants to control curve shape - same as enforceJunction
     const float percentage = 0.4f;      // Use 40% of previous segment length
     const float maxDistance = 0.2f;     // Maximum control point distance
 
@@ -265,7 +249,7 @@ void CubicBezierSequence::makeClosed() {
 
             // Place the second-to-last control point to create the same tangent
             // but in the opposite direction
-            lastControlPoints[2] = lastControlPoints[3] - tangentDir * desiredLength;
+            P2 = P3 - tangentDir * desiredLength;
 
             if (continuityType >= 2) {
                 // C2 continuity: Match curvature at the junction
@@ -280,26 +264,254 @@ void CubicBezierSequence::makeClosed() {
                 // Q1 = junction point (P3 or Q0)
                 // Q2 = lastControlPoints[2] (already set for C1)
                 // We need to set Q3 to maintain C2 continuity
-                lastControlPoints[1] = lastControlPoints[2] * 2.0f - lastControlPoints[3]
-                    + secondDerivFirst * k1Squared;
+                P1 = P2 * 2.0f - P3 + secondDerivFirst * k1Squared;
 
                 // Apply max distance constraint if needed
-                Vertex Q2Q1 = lastControlPoints[1] - lastControlPoints[2];
+                Vertex Q2Q1 = P1 - P2;
                 float Q2Q1Length = std::sqrt(Q2Q1.x * Q2Q1.x + Q2Q1.y * Q2Q1.y);
 
                 if (Q2Q1Length > maxDistance) {
                     Q2Q1 = Q2Q1 * (maxDistance / Q2Q1Length);
-                    lastControlPoints[1] = lastControlPoints[2] + Q2Q1;
+                    P1 = P2 + Q2Q1;
                 }
             }
         }
     }
 
-    // Update the last curve with modified control points
-    lastCurve.setControlPoints(lastControlPoints);
-    lastCurve.generateCurve();
-    lastCurve.updateBuffers();
+    if (samePoint(lastControlPoints[3], P3) && samePoint(lastControlPoints[2], P2)
+        && samePoint(lastControlPoints[1], P1))
+        return false;
+
+    setCurvePoint(lastIndex, 3, P3);
+    setCurvePoint(lastIndex, 2, P2);
+    setCurvePoint(lastIndex, 1, P1);
+    return true;
+}
+
+void CubicBezierSequence::solveGlobalC2()
+{
+    size_t n = curves.size();
+    if (n == 0) return;
+
+    // C0 first, the junction points are the knots the spline goes through
+    for (size_t i = 1; i < n; i++)
+        setCurvePoint(i, 0, curves[i - 1].getControlPoints()[3]);
+    if (isClosed)
+        setCurvePoint(n - 1, 3, curves[0].getControlPoints()[0]);
+
+    std::vector<Vertex> knots(n + 1);
+    for (size_t i = 0; i < n; i++)
+        knots[i] = curves[i].getControlPoints()[0];
+    knots[n] = curves[n - 1].getControlPoints()[3];
+
+    if (n == 1) {
+        // A single open curve with free ends is a straight line, a single closed one has nothing to solve
+        if (!isClosed) {
+            setCurvePoint(0, 1, knots[0] + (knots[1] - knots[0]) * (1.0f / 3.0f));
+            setCurvePoint(0, 2, knots[0] + (knots[1] - knots[0]) * (2.0f / 3.0f));
+        }
+        return;
+    }
+
+    // Unknowns are the P1 of every curve. With P2 = 2 * K(i+1) - P1 of the next curve (C1),
+    // matching second derivatives at each knot gives P1(i-1) + 4 * P1(i) + P1(i+1) = 4 * K(i) + 2 * K(i+1)
+    std::vector<float> lower(n, 1.0f), diagonal(n, 4.0f), upper(n, 1.0f);
+    std::vector<Vertex> rhs(n);
+    for (size_t i = 0; i < n; i++)
+        rhs[i] = knots[i] * 4.0f + knots[i + 1] * 2.0f;
+
+    std::vector<Vertex> firstControls;
+    if (isClosed && n >= 3) {
+        firstControls = solveCyclicTridiagonal(lower, diagonal, upper, rhs);
+    }
+    else if (isClosed) {
+        // With two curves both corners land on the off-diagonal, so it's a plain tridiagonal system
+        upper[0] = 2.0f;
+        lower[1] = 2.0f;
+        firstControls = solveTridiagonal(lower, diagonal, upper, rhs);
+    }
+    else {
+        // Natural spline : no curvature at both ends
+        diagonal[0] = 2.0f;
+        rhs[0] = knots[0] + knots[1] * 2.0f;
+        lower[n - 1] = 2.0f;
+        diagonal[n - 1] = 7.0f;
+        rhs[n - 1] = knots[n - 1] * 8.0f + knots[n];
+        firstControls = solveTridiagonal(lower, diagonal, upper, rhs);
+    }
+
+    if (firstControls.empty()) {
+        std::cerr << "Error: Couldn't solve the C2 spline system" << std::endl;
+        return;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        Vertex secondControl;
+        if (i < n - 1 || isClosed)
+            secondControl = knots[i + 1] * 2.0f - firstControls[(i + 1) % n];
+        else
+            secondControl = (knots[n] + firstControls[n - 1]) * 0.5f;
+
+        setCurvePoint(i, 1, firstControls[i]);
+        setCurvePoint(i, 2, secondControl);
+    }
+}
+
+void CubicBezierSequence::flushDirtyCurves()
+{
+    changedCurves.clear();
+    if (dirtyCurves.empty())
+        return;
+
+    // Stable so the first entry of each curve (the one with its old points) is the one kept
+    auto byIndex = [](const CurveEdit& a, const CurveEdit& b) { return a.index < b.index; };
+    std::stable_sort(dirtyCurves.begin(), dirtyCurves.end(), byIndex);
+    dirtyCurves.erase(std::unique(dirtyCurves.begin(), dirtyCurves.end(),
+        [](const CurveEdit& a, const CurveEdit& b) { return a.index == b.index; }), dirtyCurves.end());
+
+    // CPU side on the worker pool, nothing in there touches OpenGL
+    WorkerPool::instance().parallelFor(dirtyCurves.size(), [this](size_t i) {
+        Bezier& curve = curves[dirtyCurves[i].index];
+        curve.generateConvexHull();
+        curve.generateCurve();
+    });
+
+    // Both keep their capacity for the next drag step
+    std::swap(dirtyCurves, changedCurves);
+    dirtyCurves.clear();
+}
+
+void CubicBezierSequence::enforceConstraints() {
+    if (continuityType == 3) {
+        solveGlobalC2();
+        flushDirtyCurves();
+        return;
+    }
+
+    for (size_t i = 1; i < curves.size(); i++) {
+        enforceJunction(i);
+    }
+
+    if (isClosed)
+        enforceClosure();
+
+    flushDirtyCurves();
+}
+
+void CubicBezierSequence::enforceConstraintsFrom(int editedCurveIndex) {
+    if (curves.empty()) return;
+
+    // Every knot affects the whole spline, no shortcut here (the solve is O(n) anyway)
+    if (continuityType == 3) {
+        enforceConstraints();
+        return;
+    }
+
+    // Junctions before the edited curve can't have moved, and each junction only depends on
+    // the curve before it: once one is already satisfied, everything after it is too
+    for (size_t i = std::max(1, editedCurveIndex + 1); i < curves.size(); i++) {
+        if (!enforceJunction(i))
+            break;
+    }
+
+    if (isClosed)
+        enforceClosure();
+
+    flushDirtyCurves();
+}
+
+const std::vector<CurveEdit>& CubicBezierSequence::moveControlPoint(int curveIndex, int pointIndex, const Vertex& position)
+{
+    changedCurves.clear();
+    if (curveIndex < 0 || curveIndex >= static_cast<int>(curves.size()) || pointIndex < 0 || pointIndex > 3)
+        return changedCurves;
+
+    setCurvePoint(curveIndex, pointIndex, position);
+
+    // Both ends of a closed sequence are the same point
+    // (moving the first point is handled by enforceClosure)
+    if (isClosed && curveIndex == static_cast<int>(curves.size()) - 1 && pointIndex == 3)
+        setCurvePoint(0, 0, position);
+
+    enforceConstraintsFrom(curveIndex);
+    return changedCurves;
+}
+
+void CubicBezierSequence::setCurvesControlPoints(const std::vector<size_t>& curveIndices, const std::vector<Vertex>& points)
+{
+    for (size_t i = 0; i < curveIndices.size() && i * 4 + 4 <= points.size(); i++) {
+        if (curveIndices[i] >= curves.size())
+            continue;
+        for (int point = 0; point < 4; point++)
+            setCurvePoint(curveIndices[i], point, points[i * 4 + point]);
+    }
+    flushDirtyCurves();
+}
+
+void CubicBezierSequence::setControlPoints(const std::vector<Vertex>& points)
+{
+    size_t curveCount = points.size() / 4;
+    if (curves.size() > curveCount) {
+        curves.erase(curves.begin() + curveCount, curves.end());
+        dirtyCurves.erase(std::remove_if(dirtyCurves.begin(), dirtyCurves.end(),
+            [curveCount](const CurveEdit& curve) { return curve.index >= curveCount; }), dirtyCurves.end());
+    }
+
+    // Existing curves only get regenerated if their points moved
+    for (size_t i = 0; i < curves.size(); i++) {
+        for (int point = 0; point < 4; point++)
+            setCurvePoint(i, point, points[i * 4 + point]);
+    }
+
+    while (curves.size() < curveCount) {
+        Bezier segment;
+        segment.setControlPoints(std::vector<Vertex>(points.begin() + curves.size() * 4, points.begin() + curves.size() * 4 + 4));
+        segment.setStepSize(stepSize);
+        segment.setAlgorithm(algorithm);
+        curves.push_back(std::move(segment));
+        markDirty(curves.size() - 1);
+    }
+
+    // Regenerates every dirty curve at once
+    enforceConstraints();
+}
+
+void CubicBezierSequence::setContinuityType(int type)
+{
+    if (type >= 0 && type <= 3)
+        continuityType = type;
+}
+
+bool CubicBezierSequence::isConstrainedPoint(int curveIndex, int pointIndex) const
+{
+    if (continuityType == 3) {
+        // Only the knots can be moved, the solve places everything else
+        if (pointIndex == 1 || pointIndex == 2) return true;
+        return pointIndex == 0 && curveIndex > 0;
+    }
+
+    if (curveIndex == 0) {
+        // First curve has no backward constraints
+        return false;
+    }
+
+    // For all other curves:
+    if (pointIndex == 0) return true; // Q0 is always constrained (C0)
+    if (pointIndex == 1 && continuityType >= 1) return true; // Q1 constrained in C1, C2
+    if (pointIndex == 2 && continuityType >= 2) return true; // Q2 constrained in C2
+
+    return false;
+}
+
+void CubicBezierSequence::makeClosed() {
+    if (curves.size() < 1) return;
+
     isClosed = true;
+    if (continuityType == 3)
+        solveGlobalC2(); // Closing changes the whole system
+    else
+        enforceClosure();
+    flushDirtyCurves();
 }
 
 bool CubicBezierSequence::shouldBeClosed() const {
@@ -320,22 +532,4 @@ bool CubicBezierSequence::shouldBeClosed() const {
     // Threshold for considering points identical
     const float threshold = 0.0001f;
     return squaredDist < threshold;
-}
-
-void CubicBezierSequence::draw(Shader& shader) const
-{
-    for (const auto& curve : curves)
-    {
-        curve.drawControlPoints(shader);
-        curve.drawGeneratedCurve(shader);
-    }
-}
-
-void CubicBezierSequence::drawPreview(Shader& shader) const
-{
-    for (const auto& curve : curves)
-    {
-        curve.drawControlPointsPreview(shader);
-        curve.drawGeneratedCurvePreview(shader);
-    }
 }
\ No newline at end of file
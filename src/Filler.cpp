@@ -3,7 +3,6 @@
 #include <algorithm>
 #include <cmath>
 #include <stack>
-#include <GLFW/glfw3.h>
 #include <functional>
 
 // Initialize static members
@@ -202,6 +201,135 @@ std::vector<Vertex> Filler::fillPolygon(const Polygon& polygon) {
 	return fillPoints;
 }
 
+// Adds the signed area the edge p0 -> p1 covers to the cells of each row it crosses. Summed left to right,
+// a row then gives how much of each cell is inside. area has stride cells per row, starting at row top
+static void accumulateEdge(std::vector<float>& area, int stride, int top, int bottom, Vertex p0, Vertex p1) {
+	if (p0.y == p1.y) {
+		return;
+	}
+
+	float direction = 1.0f;
+	if (p0.y > p1.y) {
+		std::swap(p0, p1);
+		direction = -1.0f;
+	}
+
+	float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+	int yStart = std::max(top, static_cast<int>(std::floor(p0.y)));
+	int yEnd = std::min(bottom, static_cast<int>(std::ceil(p1.y)));
+	// Rounding can't be allowed to step out of the row
+	float lastColumn = static_cast<float>(stride - 2);
+	float x = std::clamp(p0.x + dxdy * (std::max(p0.y, static_cast<float>(yStart)) - p0.y), 0.0f, lastColumn);
+
+	for (int y = yStart; y < yEnd; y++) {
+		float* row = &area[static_cast<size_t>(y - top) * stride];
+		float dy = std::min(static_cast<float>(y + 1), p1.y) - std::max(static_cast<float>(y), p0.y);
+		float xNext = std::clamp(x + dxdy * dy, 0.0f, lastColumn);
+		float d = dy * direction;
+
+		float x0 = std::min(x, xNext);
+		float x1 = std::max(x, xNext);
+		float x0Floor = std::floor(x0);
+		int x0i = static_cast<int>(x0Floor);
+		float x1Ceil = std::ceil(x1);
+		int x1i = static_cast<int>(x1Ceil);
+
+		if (x1i <= x0i + 1) {
+			// Inside one cell : split by where the middle of the segment is
+			float xm = 0.5f * (x + xNext) - x0Floor;
+			row[x0i] += d - d * xm;
+			row[x0i + 1] += d * xm;
+		}
+		else {
+			// Across several cells : the covered area grows linearly between the first and last cell
+			float s = 1.0f / (x1 - x0);
+			float x0f = x0 - x0Floor;
+			float a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+			float x1f = x1 - x1Ceil + 1.0f;
+			float am = 0.5f * s * x1f * x1f;
+			row[x0i] += d * a0;
+			if (x1i == x0i + 2) {
+				row[x0i + 1] += d * (1.0f - a0 - am);
+			}
+			else {
+				float a1 = s * (1.5f - x0f);
+				row[x0i + 1] += d * (a1 - a0);
+				for (int xi = x0i + 2; xi < x1i - 1; xi++) {
+					row[xi] += d * s;
+				}
+				float a2 = a1 + (x1i - x0i - 3) * s;
+				row[x1i - 1] += d * (1.0f - a2 - am);
+			}
+			row[x1i] += d * am;
+		}
+
+		x = xNext;
+	}
+}
+
+std::vector<Vertex> Filler::fillPolygonCoverage(const Polygon& polygon, std::vector<uint8_t>& coverage) {
+	std::vector<Vertex> fillPoints;
+	coverage.clear();
+
+	const auto& vertices = polygon.getVertices();
+	if (vertices.size() < 3) {
+		return fillPoints;
+	}
+
+	// Screen coordinates moved by half a pixel, so cell x is the pixel centered on x (the other fills
+	// put their points on integer coordinates). x is clamped to the grid : what's left of it only
+	// matters through the winding it adds, and clamping keeps that
+	std::vector<Vertex> screenVertices;
+	screenVertices.reserve(vertices.size());
+	float minX = static_cast<float>(screenWidth), maxX = 0.0f;
+	float minY = static_cast<float>(screenHeight), maxY = 0.0f;
+	for (const auto& v : vertices) {
+		Vertex screen = NDCToScreen(v);
+		screen.x = std::clamp(screen.x + 0.5f, 0.0f, static_cast<float>(screenWidth));
+		screen.y += 0.5f;
+		minX = std::min(minX, screen.x);
+		maxX = std::max(maxX, screen.x);
+		minY = std::min(minY, screen.y);
+		maxY = std::max(maxY, screen.y);
+		screenVertices.push_back(screen);
+	}
+
+	int left = std::max(0, static_cast<int>(std::floor(minX)));
+	int right = std::min(screenWidth, static_cast<int>(std::ceil(maxX)));
+	int top = std::max(0, static_cast<int>(std::floor(minY)));
+	int bottom = std::min(screenHeight, static_cast<int>(std::ceil(maxY)));
+	if (left >= right || top >= bottom) {
+		return fillPoints;
+	}
+
+	// Only the bounds, relative to their left side. 2 more cells for what lands right of the last pixel
+	int stride = right - left + 2;
+	std::vector<float> area(static_cast<size_t>(stride) * (bottom - top), 0.0f);
+	for (size_t i = 0; i < screenVertices.size(); i++) {
+		Vertex p0 = screenVertices[i];
+		Vertex p1 = screenVertices[(i + 1) % screenVertices.size()];
+		p0.x -= left;
+		p1.x -= left;
+		accumulateEdge(area, stride, top, bottom, p0, p1);
+	}
+
+	for (int y = top; y < bottom; y++) {
+		const float* row = &area[static_cast<size_t>(y - top) * stride];
+		float accumulated = 0.0f;
+		for (int x = left; x < right; x++) {
+			accumulated += row[x - left];
+			int value = static_cast<int>(std::min(std::fabs(accumulated), 1.0f) * 255.0f + 0.5f);
+			if (value > 0) {
+				fillPoints.push_back(ScreenToNDC(static_cast<float>(x), static_cast<float>(y)));
+				coverage.push_back(static_cast<uint8_t>(value));
+			}
+		}
+	}
+
+	std::cout << "Filled polygon with coverage algorithm, " << fillPoints.size() << " points" << std::endl;
+	return fillPoints;
+}
+
 std::vector<Vertex> Filler::fillPolygonLCA(const Polygon& polygon) {
 	// This is the main LCA (List of Active Edges) algorithm
 	// It's similar to fillPolygon but follows the algorithm described in your course materials
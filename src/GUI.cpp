@@ -5,6 +5,9 @@
 
 #include "Clipper.h"
 #include "Filler.h"
+#include "SceneFile.h"
+#include "SvgImporter.h"
+#include "SoftwareRaster.h"
 
 namespace GUI
 {
@@ -26,6 +29,10 @@ namespace GUI
 
 	float initialScaleMouseX = 0.0f, initialScaleMouseY = 0.0f;
 	float initialShapeWidth = 0.0f, initialShapeHeight = 0.0f;
+
+	// For saving and loading scenes, the JSON export goes next to it
+	char scenePath[256] = "scene.pms";
+	char svgPath[256] = "drawing.svg";
 }
 
 void GUI::drawVertexInfoPanel(PolyBuilder& polybuilder, bool* open)
@@ -101,11 +108,26 @@ void GUI::drawBezierInfoPanel(PolyBuilder& polybuilder, bool* open)
 			ImGui::Text("No Bézier curve.");
 		else
 		{
-			if (polybuilder.getFinishedBeziers().size() > 1 && ImGui::Button("Calculate intersections"))
+			if (ImGui::Button("Calculate intersections"))
 				polybuilder.tryFindingIntersections();
+			ImGui::SameLine();
+			bool parallelIntersections = polybuilder.getParallelIntersections();
+			if (ImGui::Checkbox("Parallel##intersections", &parallelIntersections))
+				polybuilder.setParallelIntersections(parallelIntersections);
+			const char* intersectionMethods[] = { "Subdivision", "Bézier clipping" };
+			int intersectionMethod = polybuilder.getIntersectionMethod();
+			if (ImGui::Combo("Method##intersections", &intersectionMethod, intersectionMethods, IM_ARRAYSIZE(intersectionMethods)))
+				polybuilder.setIntersectionMethod(intersectionMethod);
+			if (polybuilder.getLastIntersectionPairs() > 0)
+				ImGui::Text("%d pairs tested, %lld iterations, in %.7f seconds.", static_cast<int>(polybuilder.getLastIntersectionPairs()),
+					polybuilder.getLastIntersectionIterations(), polybuilder.getLastIntersectionTime());
+			if (polybuilder.getLastIntersectionTruncated() > 0)
+				ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f),
+					"%d test(s) ran out of iterations (tangent curves?), their intersections are approximate.",
+					polybuilder.getLastIntersectionTruncated());
 			if (polybuilder.getFoundIntersectionsText().size() > 0)
 			{
-				for (std::string intersection : polybuilder.getFoundIntersectionsText())
+				for (const std::string& intersection : polybuilder.getFoundIntersectionsText())
 				{
 					ImGui::Text(intersection.c_str());
 				}
@@ -197,6 +219,8 @@ void GUI::drawBezierInfoPanel(PolyBuilder& polybuilder, bool* open)
 				continuityTypeString = "C1";
 			else if (continuityType == 2)
 				continuityTypeString = "C2";
+			else if (continuityType == 3)
+				continuityTypeString = "C2 (global)";
 
 			ImGui::Text("%d : Step Size = %.3f, Continuity Type : %s, Curves : %d, Algorithm : %s %s",
 				static_cast<int>(index), stepSize, continuityTypeString.c_str(), numberOfCurves, algoString.c_str(),
@@ -261,8 +285,10 @@ void GUI::drawFillSettingsPanel(bool* open)
 		ImGuiWindowFlags_AlwaysAutoResize))
 	{
 		// Algorithm selection
-		const char* algorithms[] = { "Simple Scanline", "LCA", "Seed Fill", "Recursive Seed Fill" };
-		static int currentAlgorithm = Filler::getSelectedAlgorithm();
+		const char* algorithms[] = { "Simple Scanline", "LCA", "Seed Fill", "Recursive Seed Fill", "Anti-aliased Coverage" };
+		// Read every frame, loading a scene can change them
+		int currentAlgorithm = Filler::getSelectedAlgorithm();
+		Filler::getFillColor(fillColor.x, fillColor.y, fillColor.z, fillColor.w);
 
 		if (ImGui::Combo("Algorithm", &currentAlgorithm, algorithms, IM_ARRAYSIZE(algorithms)))
 			Filler::setSelectedAlgorithm(currentAlgorithm);
@@ -297,11 +323,25 @@ void GUI::drawBezierSettingsPanel(PolyBuilder& polybuilder, bool* open)
 		ImGuiWindowFlags_NoResize |
 		ImGuiWindowFlags_AlwaysAutoResize))
 	{
-		const char* continuityTypes[] = { "C0", "C1", "C2" };
+		const char* continuityTypes[] = { "C0", "C1", "C2", "C2 (global)" };
 		static int currentContinuityType = polybuilder.getContinuityType();
 
 		if (ImGui::Combo("Continuity Type", &currentContinuityType, continuityTypes, IM_ARRAYSIZE(continuityTypes)))
 			polybuilder.setContinuityType(currentContinuityType);
+
+		ImGui::Separator();
+		ImGui::Text("All curves : Step Size = %.3f", polybuilder.getGlobalStepSize());
+		ImGui::SameLine();
+		if (ImGui::Button("+##global"))
+			polybuilder.incrementGlobalStepSize();
+
+		ImGui::SetItemTooltip("Increment Step Size of every curve");
+		ImGui::SameLine();
+		if (ImGui::Button("-##global"))
+			polybuilder.decrementGlobalStepSize();
+
+		ImGui::SetItemTooltip("Decrement Step Size of every curve");
+		ImGui::Text("Regenerated in %.7f seconds.", polybuilder.getLastRegenerationTime());
 	}
 	ImGui::End();
 }
@@ -316,6 +356,16 @@ void GUI::handleContextMenu(bool* openContextMenu, PolyBuilder& polybuilder)
 
 	if (ImGui::BeginPopup("ContextMenu"))
 	{
+		const UndoJournal& journal = polybuilder.getJournal();
+		std::string undoLabel = journal.canUndo() ? "Undo " + journal.undoName() : "Undo";
+		std::string redoLabel = journal.canRedo() ? "Redo " + journal.redoName() : "Redo";
+		if (ImGui::MenuItem(undoLabel.c_str(), "Ctrl+Z", false, journal.canUndo()))
+			polybuilder.undo();
+		if (ImGui::MenuItem(redoLabel.c_str(), "Ctrl+Y", false, journal.canRedo()))
+			polybuilder.redo();
+
+		ImGui::Separator();
+
 		if (ImGui::MenuItem("Create Polygon"))
 			polybuilder.startPolygon(PolyType::POLYGON);
 
@@ -348,6 +398,7 @@ void GUI::handleContextMenu(bool* openContextMenu, PolyBuilder& polybuilder)
 					if (poly.type == PolyType::POLYGON)
 					{
 						std::vector<Vertex> fillPoints;
+						std::vector<uint8_t> coverage;
 
 						switch (Filler::getSelectedAlgorithm())
 						{
@@ -357,6 +408,9 @@ void GUI::handleContextMenu(bool* openContextMenu, PolyBuilder& polybuilder)
 						case Filler::FILL_LCA:
 							fillPoints = Filler::fillPolygonLCA(poly);
 							break;
+						case Filler::FILL_COVERAGE:
+							fillPoints = Filler::fillPolygonCoverage(poly, coverage);
+							break;
 						case Filler::FILL_SEED:
 						case Filler::FILL_SEED_RECURSIVE:
 							std::cout << "Seed fill requires selecting a polygon and clicking inside it" << std::endl;
@@ -368,7 +422,7 @@ void GUI::handleContextMenu(bool* openContextMenu, PolyBuilder& polybuilder)
 						Filler::getFillColor(r, g, b, a);
 
 						// Store the filled polygon
-						polybuilder.addFilledPolygon(poly, fillPoints, r, g, b, a);
+						polybuilder.addFilledPolygon(poly, fillPoints, r, g, b, a, coverage);
 					}
 				}
 			}
@@ -393,28 +447,57 @@ void GUI::handleContextMenu(bool* openContextMenu, PolyBuilder& polybuilder)
 
 		if (ImGui::MenuItem("Ear Cutting Decomposition"))
 		{
-			std::vector<Polygon> newPolygons;
-			for (const auto& poly : polybuilder.getFinishedPolygons())
+			// Only the cut polygons are replaced (and kept for undo), the others don't move.
+			// From the end, so the triangles added at the end aren't cut again
+			polybuilder.beginEdit("Ear cutting");
+			for (int i = static_cast<int>(polybuilder.getFinishedPolygons().size()) - 1; i >= 0; i--)
 			{
-				if (poly.type == PolyType::POLYGON)
+				if (polybuilder.getFinishedPolygons()[i].type != PolyType::POLYGON)
+					continue;
+
+				// Créez une copie du polygone pour le modifier
+				Polygon polyCopy = polybuilder.getFinishedPolygons()[i];
+				std::vector<Polygon> triangles = Clipper::earCutting(polyCopy);
+				polybuilder.removeFinishedPolygon(i);
+				for (auto& triangle : triangles)
 				{
-					// Créez une copie du polygone pour le modifier
-					Polygon polyCopy = poly;
-					std::vector<Polygon> triangles = Clipper::earCutting(polyCopy);
-					for (auto& triangle : triangles)
-					{
-						triangle.type = PolyType::POLYGON;
-						triangle.updateBuffers();
-						newPolygons.push_back(triangle);
-					}
-				}
-				else
-				{
-					newPolygons.push_back(poly);
+					triangle.type = PolyType::POLYGON;
+					polybuilder.addFinishedPolygon(triangle);
 				}
 			}
-			// Remplace l'ancienne collection de polygones
-			polybuilder.setFinishedPolygons(newPolygons);
+			polybuilder.endEdit();
+		}
+
+		if (ImGui::BeginMenu("Scene"))
+		{
+			ImGui::InputText("File", scenePath, sizeof(scenePath));
+
+			if (ImGui::MenuItem("Save Scene"))
+				SceneFile::save(polybuilder, scenePath);
+
+			if (ImGui::MenuItem("Load Scene"))
+				SceneFile::load(polybuilder, scenePath);
+
+			if (ImGui::MenuItem("Export JSON"))
+				SceneFile::exportJson(polybuilder, std::string(scenePath) + ".json");
+
+			if (ImGui::MenuItem("Export Fill Image"))
+			{
+				// Drawn on the CPU at the fill grid's size, same background as the window
+				SoftwareRaster raster(Filler::getScreenWidth(), Filler::getScreenHeight());
+				raster.clear(0.2f, 0.3f, 0.3f, 1.0f);
+				for (const FilledPolygon& filled : polybuilder.getFilledPolygons())
+					raster.drawFillPoints(filled.fillPoints, Filler::getScreenWidth(), Filler::getScreenHeight(),
+						filled.colorR, filled.colorG, filled.colorB, filled.colorA, filled.coverage);
+				raster.write(std::string(scenePath) + ".png");
+			}
+
+			// Added to the scene rather than replacing it, undone in one go
+			ImGui::InputText("SVG", svgPath, sizeof(svgPath));
+			if (ImGui::MenuItem("Import SVG"))
+				SvgImporter::importFile(polybuilder, svgPath);
+
+			ImGui::EndMenu();
 		}
 
 		ImGui::EndPopup();
@@ -440,6 +523,9 @@ void GUI::performCyrusBeckClipping(PolyBuilder& polybuilder)
 		return;
 	}
 
+	// Removing the old results and adding the new ones is one undo
+	polybuilder.beginEdit("Cyrus-Beck clipping");
+
 	// Clear any previous clipped results of the same type
 	polybuilder.removeAllPolygonsOfType(PolyType::CLIPPED_CYRUS_BECK);
 
@@ -457,11 +543,12 @@ void GUI::performCyrusBeckClipping(PolyBuilder& polybuilder)
 			if (!clipped.getVertices().empty())
 			{
 				clipped.type = PolyType::CLIPPED_CYRUS_BECK;
-				clipped.updateBuffers();
 				polybuilder.addFinishedPolygon(clipped);
 			}
 		}
 	}
+
+	polybuilder.endEdit();
 }
 
 void GUI::performSutherlandHodgmanClipping(PolyBuilder& polybuilder)
@@ -483,6 +570,9 @@ void GUI::performSutherlandHodgmanClipping(PolyBuilder& polybuilder)
 		return;
 	}
 
+	// Removing the old results and adding the new ones is one undo
+	polybuilder.beginEdit("Sutherland-Hodgman clipping");
+
 	// Clear any previous clipped results of the same type
 	polybuilder.removeAllPolygonsOfType(PolyType::CLIPPED_SUTHERLAND_HODGMAN);
 
@@ -498,11 +588,12 @@ void GUI::performSutherlandHodgmanClipping(PolyBuilder& polybuilder)
 			if (!clipped.getVertices().empty())
 			{
 				clipped.type = PolyType::CLIPPED_SUTHERLAND_HODGMAN;
-				clipped.updateBuffers();
 				polybuilder.addFinishedPolygon(clipped);
 			}
 		}
 	}
+
+	polybuilder.endEdit();
 }
 
 void GUI::drawHoverTooltip(GLFWwindow* window, PolyBuilder& polybuilder)
@@ -517,90 +608,33 @@ void GUI::drawHoverTooltip(GLFWwindow* window, PolyBuilder& polybuilder)
 
 	// Check proximity to vertices
 	const float hoverRadius = 0.02f;
-	for (const auto& poly : polybuilder.getFinishedPolygons())
-	{
-		bool foundMatch = false;
-		for (const auto& vert : poly.getVertices())
-		{
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				ImGui::BeginTooltip();
-				ImGui::Text("Position: (%.2f, %.2f)", vert.x, vert.y);
-				ImGui::EndTooltip();
-				foundMatch = true;
-				break; // Only show the first match
-			}
-		}
+	ShapeRef picked;
+	int vertexIndex;
+	if (!polybuilder.pickVertex(ndcX, ndcY, hoverRadius, picked, vertexIndex))
+		return;
 
-		if (foundMatch) break;
-	}
+	Vertex vert = polybuilder.getShapePoint(picked, vertexIndex);
+	ImGui::BeginTooltip();
+	ImGui::Text("Position: (%.2f, %.2f)", vert.x, vert.y);
 
-	for (const auto& bezier : polybuilder.getFinishedBeziers())
+	// Show constraint information
+	if (picked.type == SHAPE_BEZIER_SEQUENCE)
 	{
-		bool foundMatch = false;
-		for (const auto& vert : bezier.getControlPoints())
+		const CubicBezierSequence& bezierSeq = polybuilder.getFinishedBezierSequences()[picked.index];
+		if (bezierSeq.isConstrainedPoint(vertexIndex / 4, vertexIndex % 4))
 		{
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				ImGui::BeginTooltip();
-				ImGui::Text("Position: (%.2f, %.2f)", vert.x, vert.y);
-				ImGui::EndTooltip();
-				foundMatch = true;
-				break; // Only show the first match
-			}
+			ImGui::Text("Constrained by %s continuity",
+				bezierSeq.getContinuityType() == 1 ? "C1" :
+				bezierSeq.getContinuityType() == 2 ? "C2" :
+				bezierSeq.getContinuityType() == 3 ? "global C2" : "C0");
 		}
-
-		if (foundMatch) break;
-	}
-
-	for (const auto& bezierSeq : polybuilder.getFinishedBezierSequences())
-	{
-		bool foundMatch = false;
-		const std::vector<Bezier>& curves = bezierSeq.getCurves();
-
-		for (size_t curveIndex = 0; curveIndex < curves.size(); curveIndex++)
+		else
 		{
-			const auto& curve = curves[curveIndex];
-			const auto& controlPoints = curve.getControlPoints();
-
-			for (size_t pointIndex = 0; pointIndex < controlPoints.size(); pointIndex++)
-			{
-				const auto& vert = controlPoints[pointIndex];
-				float dx = vert.x - ndcX;
-				float dy = vert.y - ndcY;
-
-				if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-				{
-					ImGui::BeginTooltip();
-					ImGui::Text("Position: (%.2f, %.2f)", vert.x, vert.y);
-
-					// Show constraint information
-					if (bezierSeq.isConstrainedPoint(curveIndex, pointIndex))
-					{
-						ImGui::Text("Constrained by %s continuity",
-							bezierSeq.getContinuityType() == 1 ? "C1" :
-							bezierSeq.getContinuityType() == 2 ? "C2" : "C0");
-					}
-					else
-					{
-						ImGui::Text("Freely movable point");
-					}
-
-					ImGui::EndTooltip();
-					foundMatch = true;
-					break;
-				}
-			}
-
-			if (foundMatch) break;
+			ImGui::Text("Freely movable point");
 		}
-
-		if (foundMatch) break;
 	}
+
+	ImGui::EndTooltip();
 }
 
 void GUI::handleMouseMove(GLFWwindow* window, PolyBuilder& polybuilder)
@@ -669,35 +703,7 @@ void GUI::handleShapeDrag(GLFWwindow* window, PolyBuilder& polybuilder)
 	}
 	}
 
-	// Update clipped polygons (based on current active clipping algorithm)
-	// Check if Sutherland-Hodgman clipped polygons exist
-	bool hasShClipped = false;
-	for (const auto& poly : polybuilder.getFinishedPolygons())
-	{
-		if (poly.type == PolyType::CLIPPED_SUTHERLAND_HODGMAN)
-		{
-			hasShClipped = true;
-			break;
-		}
-	}
-
-	// Check if Cyrus-Beck clipped polygons exist
-	bool hasCbClipped = false;
-	for (const auto& poly : polybuilder.getFinishedPolygons())
-	{
-		if (poly.type == PolyType::CLIPPED_CYRUS_BECK)
-		{
-			hasCbClipped = true;
-			break;
-		}
-	}
-
-	// Re-perform the active clipping algorithm(s)
-	if (hasShClipped)
-		performSutherlandHodgmanClipping(polybuilder);
-
-	if (hasCbClipped)
-		performCyrusBeckClipping(polybuilder);
+	// Only the model matrix changed, the clipping is done again with the real vertices in endDrag
 }
 
 void GUI::handleVertexDrag(GLFWwindow* window, PolyBuilder& polybuilder)
@@ -750,149 +756,83 @@ bool GUI::tryStartShapeDrag(GLFWwindow* window, PolyBuilder& polybuilder, int mo
 	float ndcX = (2.0f * xPos) / displayW - 1.0f;
 	float ndcY = 1.0f - (2.0f * yPos) / displayH;
 
-	auto finishedPolys = polybuilder.getFinishedPolygons();
+	// Polygons first, then béziers, then sequences, by bounding box
+	ShapeRef picked;
+	if (!polybuilder.pickShape(ndcX, ndcY, picked))
+		return false;
 
-	// Find a polygon that contains the mouse position
-	for (size_t i = 0; i < finishedPolys.size(); i++)
-	{
-		const auto& poly = finishedPolys[i];
-		// Create bounding box and check if mouse is in there
-		// TODO : Implement a better algorithm like ray tracing or Winding Number
-		const auto& verts = poly.getVertices();
+	isDraggingShape = true;
+	selectedShapeIndex = picked.index;
+	shapeType = picked.type;
+	lastMouseX = ndcX;
+	lastMouseY = ndcY;
 
-		if (verts.size() > 0)
-		{
-			// Create a bounding box
-			float minX = verts[0].x;
-			float maxX = verts[0].x;
-			float minY = verts[0].y;
-			float maxY = verts[0].y;
+	// The whole drag, and the clipping redone after it, is one undo
+	polybuilder.beginEdit(currentTransformationType == TRANSLATE ? "Move shape" : "Transform shape");
+	// Translations too, so the drag only changes the model matrix
+	polybuilder.startTransformingShape(selectedShapeIndex, shapeType);
+	if (currentTransformationType != TRANSLATE)
+	{
+		float minX, minY, maxX, maxY;
+		polybuilder.getShapeBounds(picked, minX, minY, maxX, maxY);
+		initialScaleMouseX = ndcX;
+		initialScaleMouseY = ndcY;
+		initialShapeWidth = maxX - minX;
+		initialShapeHeight = maxY - minY;
+	}
 
-			for (const auto& vert : verts)
-			{
-				minX = std::min(minX, vert.x);
-				maxX = std::max(maxX, vert.x);
-				minY = std::min(minY, vert.y);
-				maxY = std::max(maxY, vert.y);
-			}
+	return true;
+}
 
-			// Check if point is in bounding box
-			if (ndcX >= minX && ndcX <= maxX && ndcY >= minY && ndcY <= maxY)
-			{
-				isDraggingShape = true;
-				selectedShapeIndex = static_cast<int>(i);
-				shapeType = SHAPE_POLYGON;
-				lastMouseX = ndcX;
-				lastMouseY = ndcY;
+void GUI::endDrag(PolyBuilder& polybuilder)
+{
+	bool wasDraggingShape = isDraggingShape;
+	bool wasDraggingVertex = isDraggingVertex;
 
-				if (currentTransformationType != TRANSLATE)
-				{
-					initialScaleMouseX = ndcX;
-					initialScaleMouseY = ndcY;
-					polybuilder.startTransformingShape(selectedShapeIndex, shapeType);
-					initialShapeWidth = maxX - minX;
-					initialShapeHeight = maxY - minY;
-				}
+	isDraggingShape = false;
+	isDraggingVertex = false;
+	selectedShapeIndex = -1;
+	selectedVertexIndex = -1;
+	polybuilder.stopTransformingShape(); // The dragged shape gets its new vertices here
 
-				return true;
-			}
-		}
+	if (!wasDraggingShape)
+	{
+		if (wasDraggingVertex)
+			polybuilder.endEdit();
+		return;
 	}
 
-	auto beziers = polybuilder.getFinishedBeziers();
-
-	for (size_t i = 0; i < beziers.size(); i++)
+	// Update clipped polygons (based on current active clipping algorithm)
+	// Check if Sutherland-Hodgman clipped polygons exist
+	bool hasShClipped = false;
+	for (const auto& poly : polybuilder.getFinishedPolygons())
 	{
-		const auto& bezier = beziers[i];
-		const auto& verts = bezier.getControlPoints();
-
-		if (verts.size() > 0)
+		if (poly.type == PolyType::CLIPPED_SUTHERLAND_HODGMAN)
 		{
-			// Create a bounding box
-			float minX = verts[0].x;
-			float maxX = verts[0].x;
-			float minY = verts[0].y;
-			float maxY = verts[0].y;
-
-			for (const auto& vert : verts)
-			{
-				minX = std::min(minX, vert.x);
-				maxX = std::max(maxX, vert.x);
-				minY = std::min(minY, vert.y);
-				maxY = std::max(maxY, vert.y);
-			}
-
-			// Check if point is in bounding box
-			if (ndcX >= minX && ndcX <= maxX && ndcY >= minY && ndcY <= maxY)
-			{
-				isDraggingShape = true;
-				selectedShapeIndex = static_cast<int>(i);
-				shapeType = SHAPE_BEZIER;
-				lastMouseX = ndcX;
-				lastMouseY = ndcY;
-
-				if (currentTransformationType != TRANSLATE)
-				{
-					initialScaleMouseX = ndcX;
-					initialScaleMouseY = ndcY;
-					polybuilder.startTransformingShape(selectedShapeIndex, shapeType);
-					initialShapeWidth = maxX - minX;
-					initialShapeHeight = maxY - minY;
-				}
-
-				return true;
-			}
+			hasShClipped = true;
+			break;
 		}
 	}
 
-	auto bezierSeqs = polybuilder.getFinishedBezierSequences();
-	for (size_t i = 0; i < bezierSeqs.size(); i++) {
-		// Calculate bounding box for the entire sequence
-		float minX = std::numeric_limits<float>::max();
-		float maxX = std::numeric_limits<float>::min();
-		float minY = std::numeric_limits<float>::max();
-		float maxY = std::numeric_limits<float>::min();
-
-		// Iterate through each curve in the sequence and update bounds
-		for (const auto& curve : bezierSeqs[i].getCurves()) {
-			for (const auto& point : curve.getControlPoints()) {
-				minX = std::min(minX, point.x);
-				maxX = std::max(maxX, point.x);
-				minY = std::min(minY, point.y);
-				maxY = std::max(maxY, point.y);
-			}
-		}
-
-		// Check if point is in bounding box
-		if (ndcX >= minX && ndcX <= maxX && ndcY >= minY && ndcY <= maxY) {
-			isDraggingShape = true;
-			selectedShapeIndex = static_cast<int>(i);
-			shapeType = SHAPE_BEZIER_SEQUENCE;
-			lastMouseX = ndcX;
-			lastMouseY = ndcY;
-
-			if (currentTransformationType != TRANSLATE) {
-				initialScaleMouseX = ndcX;
-				initialScaleMouseY = ndcY;
-				polybuilder.startTransformingShape(selectedShapeIndex, shapeType);
-				initialShapeWidth = maxX - minX;
-				initialShapeHeight = maxY - minY;
-			}
-
-			return true;
+	// Check if Cyrus-Beck clipped polygons exist
+	bool hasCbClipped = false;
+	for (const auto& poly : polybuilder.getFinishedPolygons())
+	{
+		if (poly.type == PolyType::CLIPPED_CYRUS_BECK)
+		{
+			hasCbClipped = true;
+			break;
 		}
 	}
 
-	return false;
-}
+	// Re-perform the active clipping algorithm(s)
+	if (hasShClipped)
+		performSutherlandHodgmanClipping(polybuilder);
 
-void GUI::endDrag(PolyBuilder& polybuilder)
-{
-	isDraggingShape = false;
-	isDraggingVertex = false;
-	selectedShapeIndex = -1;
-	selectedVertexIndex = -1;
-	polybuilder.stopTransformingShape();
+	if (hasCbClipped)
+		performCyrusBeckClipping(polybuilder);
+
+	polybuilder.endEdit();
 }
 
 void GUI::deleteVertex(GLFWwindow* window, PolyBuilder& polybuilder, double xPos, double yPos)
@@ -904,52 +844,16 @@ void GUI::deleteVertex(GLFWwindow* window, PolyBuilder& polybuilder, double xPos
 	float ndcX = (2.0f * xPos) / displayW - 1.0f;
 	float ndcY = 1.0f - (2.0f * yPos) / displayH;
 
-	auto finishedPolys = polybuilder.getFinishedPolygons();
-
 	// Check proximity to vertices
 	const float hoverRadius = 0.02f;
 
-	for (size_t i = 0; i < finishedPolys.size(); i++)
-	{
-		Polygon poly = finishedPolys[i];
-		auto vertices = poly.getVertices();
-
-
-		for (size_t j = 0; j < vertices.size(); j++)
-		{
-			Vertex vert = vertices[j];
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				std::cout << "Deleting vertex" << std::endl;
-				shapeType = SHAPE_POLYGON;
-				polybuilder.deleteVertex(i, j, shapeType);
-				return;
-			}
-		}
-	}
-
-	auto finishedBeziers = polybuilder.getFinishedBeziers();
-
-	for (size_t i = 0; i < finishedBeziers.size(); i++)
+	ShapeRef picked;
+	int vertexIndex;
+	if (polybuilder.pickVertex(ndcX, ndcY, hoverRadius, picked, vertexIndex))
 	{
-		Bezier bezier = finishedBeziers[i];
-		auto controlPoints = bezier.getControlPoints();
-
-		for (size_t j = 0; j < controlPoints.size(); j++)
-		{
-			Vertex vert = controlPoints[j];
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				std::cout << "Deleting vertex" << std::endl;
-				shapeType = SHAPE_BEZIER;
-				polybuilder.deleteVertex(i, j, shapeType);
-				return;
-			}
-		}
+		std::cout << "Deleting vertex" << std::endl;
+		shapeType = picked.type;
+		polybuilder.deleteVertex(picked.index, vertexIndex, shapeType);
 	}
 }
 
@@ -962,125 +866,30 @@ bool GUI::tryStartVertexDrag(GLFWwindow* window, PolyBuilder& polybuilder, doubl
 	float ndcX = (2.0f * xPos) / displayW - 1.0f;
 	float ndcY = 1.0f - (2.0f * yPos) / displayH;
 
-	auto finishedPolys = polybuilder.getFinishedPolygons();	
-
 	// Check proximity to vertices
 	const float hoverRadius = 0.02f;
-	bool foundMatch = false;
-
-	for (size_t i = 0; i < finishedPolys.size(); i++)
-	{
-		Polygon poly = finishedPolys[i];
-		auto vertices = poly.getVertices();
-		
-
-		for (size_t j = 0; j < vertices.size(); j++)
-		{
-			Vertex vert = vertices[j];
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				selectedShapeIndex = i;
-				selectedVertexIndex = j;
-				foundMatch = true;
-				shapeType = SHAPE_POLYGON;
-				isDraggingVertex = true;
-				lastMouseX = ndcX;
-				lastMouseY = ndcY;
-				break;
-			}
-		}
-
-		if (foundMatch) break;
-	}
-
-	if (foundMatch)
-		return true;
-
-	auto finishedBeziers = polybuilder.getFinishedBeziers();
-
-	for (size_t i = 0; i < finishedBeziers.size(); i++)
-	{
-		Bezier bezier = finishedBeziers[i];
-		auto controlPoints = bezier.getControlPoints();
 
-		for (size_t j = 0; j < controlPoints.size(); j++)
-		{
-			Vertex vert = controlPoints[j];
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				selectedShapeIndex = i;
-				selectedVertexIndex = j;
-				foundMatch = true;
-				shapeType = SHAPE_BEZIER;
-				isDraggingVertex = true;
-				lastMouseX = ndcX;
-				lastMouseY = ndcY;
-				break;
-			}
-		}
-
-		if (foundMatch) break;
-	}
+	ShapeRef picked;
+	int vertexIndex;
+	if (!polybuilder.pickVertex(ndcX, ndcY, hoverRadius, picked, vertexIndex))
+		return false;
 
-	if (foundMatch)
-		return true;
-
-	auto finishedSequences = polybuilder.getFinishedBezierSequences();
+	selectedShapeIndex = picked.index;
+	selectedVertexIndex = vertexIndex; // For sequences, curve index * 4 + point index in the curve
+	shapeType = picked.type;
+	isDraggingVertex = true;
+	polybuilder.beginEdit("Move vertex");
+	lastMouseX = ndcX;
+	lastMouseY = ndcY;
 
-	for (size_t i = 0; i < finishedSequences.size(); i++)
+	// Optional: Highlight whether this point is constrained
+	if (shapeType == SHAPE_BEZIER_SEQUENCE &&
+		polybuilder.getFinishedBezierSequences()[picked.index].isConstrainedPoint(vertexIndex / 4, vertexIndex % 4))
 	{
-		CubicBezierSequence& sequence = finishedSequences[i];
-		const std::vector<Bezier>& curves = sequence.getCurves();
-
-		// Loop through each curve in the sequence
-		for (size_t curveIndex = 0; curveIndex < curves.size(); curveIndex++)
-		{
-			const Bezier& curve = curves[curveIndex];
-			std::vector<Vertex> controlPoints = curve.getControlPoints();
-
-			// Check each control point
-			for (size_t pointIndex = 0; pointIndex < controlPoints.size(); pointIndex++)
-			{
-				Vertex vert = controlPoints[pointIndex];
-				float dx = vert.x - ndcX;
-				float dy = vert.y - ndcY;
-
-				if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-				{
-					// Found a match in a Bézier sequence
-					// Calculate the global vertex index in the sequence
-					selectedShapeIndex = i;
-					selectedVertexIndex = curveIndex * 4 + pointIndex; // 4 points per cubic curve
-					foundMatch = true;
-					shapeType = SHAPE_BEZIER_SEQUENCE;
-					isDraggingVertex = true;
-					lastMouseX = ndcX;
-					lastMouseY = ndcY;
-
-					// Optional: Highlight whether this point is constrained
-					if (sequence.isConstrainedPoint(curveIndex, pointIndex))
-					{
-						std::cout << "Note: Selected point is constrained by continuity" << std::endl;
-					}
-
-					break;
-				}
-			}
-
-			if (foundMatch) break;
-		}
-
-		if (foundMatch) break;
+		std::cout << "Note: Selected point is constrained by continuity" << std::endl;
 	}
-	
-	if (foundMatch)
-		return true;
 
-	return false;
+	return true;
 }
 
 void GUI::handleFillClick(GLFWwindow* window, PolyBuilder& polyBuilder, double xPos, double yPos)
@@ -1144,9 +953,12 @@ void GUI::handleNonSeedFill(PolyBuilder& polyBuilder)
 
 	Polygon& selectedPolygon = polyBuilder.getPolygonAt(selectedPolygonIndex);
 	std::vector<Vertex> fillPoints;
+	std::vector<uint8_t> coverage;
 
 	if (Filler::getSelectedAlgorithm() == Filler::FILL_SCANLINE)
 		fillPoints = Filler::fillPolygon(selectedPolygon);
+	else if (Filler::getSelectedAlgorithm() == Filler::FILL_COVERAGE)
+		fillPoints = Filler::fillPolygonCoverage(selectedPolygon, coverage);
 	else
 		fillPoints = Filler::fillPolygonLCA(selectedPolygon);
 
@@ -1155,7 +967,7 @@ void GUI::handleNonSeedFill(PolyBuilder& polyBuilder)
 	Filler::getFillColor(r, g, b, a);
 
 	// Store the filled polygon
-	polyBuilder.addFilledPolygon(selectedPolygon, fillPoints, r, g, b, a);
+	polyBuilder.addFilledPolygon(selectedPolygon, fillPoints, r, g, b, a, coverage);
 
 	// Reset state
 	selectedPolygonIndex = -1;
@@ -1306,23 +1118,8 @@ void GUI::tryDuplicateVertex(GLFWwindow* window, PolyBuilder& polybuilder)
 	// Check proximity to vertices
 	const float hoverRadius = 0.02f;
 
-	auto finishedBeziers = polybuilder.getFinishedBeziers();
-
-	for (size_t i = 0; i < finishedBeziers.size(); i++)
-	{
-		Bezier bezier = finishedBeziers[i];
-		auto controlPoints = bezier.getControlPoints();
-
-		for (size_t j = 0; j < controlPoints.size(); j++)
-		{
-			Vertex vert = controlPoints[j];
-			float dx = vert.x - ndcX;
-			float dy = vert.y - ndcY;
-			if (dx * dx + dy * dy < hoverRadius * hoverRadius)
-			{
-				polybuilder.duplicateControlPoint(static_cast<int>(i), static_cast<int>(j));
-				break;
-			}
-		}
-	}
+	ShapeRef picked;
+	int vertexIndex;
+	if (polybuilder.pickVertex(ndcX, ndcY, hoverRadius, picked, vertexIndex, PolyBuilder::typeBit(SHAPE_BEZIER)))
+		polybuilder.duplicateControlPoint(picked.index, vertexIndex);
 }
@@ -1,7 +1,16 @@
 ﻿#include "MathUtils.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MATHUTILS_SSE2
+#endif
+
 namespace MathUtils
 {
     long long combinations(int n, int k)
@@ -118,4 +127,263 @@ namespace MathUtils
 
         return false;
     }
-}
\ No newline at end of file
+
+    int monotoneChainHull(Vertex* points, int count, Vertex* hull)
+    {
+        if (count < 3)
+        {
+            std::copy(points, points + count, hull);
+            return count;
+        }
+
+        std::sort(points, points + count, [](const Vertex& a, const Vertex& b) {
+            return a.x < b.x || (a.x == b.x && a.y < b.y);
+        });
+
+        int k = 0;
+
+        // Lower hull, left to right. Anything that doesn't make a left turn gets popped (collinear too)
+        for (int i = 0; i < count; i++)
+        {
+            while (k >= 2 && cross2D(hull[k - 1] - hull[k - 2], points[i] - hull[k - 2]) <= 0)
+                k--;
+            hull[k++] = points[i];
+        }
+
+        // Upper hull, right to left, without popping into the lower one
+        for (int i = count - 2, lowerSize = k + 1; i >= 0; i--)
+        {
+            while (k >= lowerSize && cross2D(hull[k - 1] - hull[k - 2], points[i] - hull[k - 2]) <= 0)
+                k--;
+            hull[k++] = points[i];
+        }
+
+        // The last point is the first one again
+        return k - 1;
+    }
+
+    std::vector<Vertex> monotoneChainHull(const std::vector<Vertex>& points)
+    {
+        std::vector<Vertex> sortedPoints = points;
+        std::vector<Vertex> hull(2 * points.size());
+        hull.resize(monotoneChainHull(sortedPoints.data(), static_cast<int>(sortedPoints.size()), hull.data()));
+        return hull;
+    }
+
+    void insertIntoConvexHull(std::vector<Vertex>& hull, const Vertex& point)
+    {
+        int h = static_cast<int>(hull.size());
+
+        // Not a real polygon yet, just rebuild it
+        if (h < 3)
+        {
+            std::vector<Vertex> points = hull;
+            points.push_back(point);
+            hull = monotoneChainHull(points);
+            return;
+        }
+
+        // Edge i goes from hull[i] to hull[i + 1]. The hull is counter clockwise,
+        // so the point sees the edges it is on the right of
+        auto edgeCross = [&](int i) {
+            const Vertex& a = hull[i];
+            const Vertex& b = hull[(i + 1) % h];
+            return cross2D(b - a, point - a);
+        };
+
+        // Find where the visible edges start
+        int first = -1;
+        for (int i = 0; i < h; i++)
+        {
+            if (edgeCross(i) < 0 && edgeCross((i + h - 1) % h) > 0)
+            {
+                first = i;
+                break;
+            }
+        }
+
+        if (first == -1)
+        {
+            bool outside = false;
+            for (int i = 0; i < h; i++)
+                outside = outside || edgeCross(i) < 0;
+
+            // Inside or on the boundary, nothing changes
+            if (!outside)
+                return;
+
+            // Only happens with collinear edges around the visible ones
+            std::vector<Vertex> points = hull;
+            points.push_back(point);
+            hull = monotoneChainHull(points);
+            return;
+        }
+
+        // Visible edges go from first to last - 1, the vertices between them get replaced by the point
+        int last = first;
+        while (edgeCross(last) <= 0)
+            last = (last + 1) % h;
+
+        std::vector<Vertex> newHull;
+        newHull.reserve(h + 1);
+        for (int i = last; i != first; i = (i + 1) % h)
+            newHull.push_back(hull[i]);
+        newHull.push_back(hull[first]);
+        newHull.push_back(point);
+        hull.swap(newHull);
+    }
+
+    std::vector<Vertex> solveTridiagonal(const std::vector<float>& lower, const std::vector<float>& diagonal,
+        const std::vector<float>& upper, const std::vector<Vertex>& rhs)
+    {
+        size_t n = diagonal.size();
+        if (n == 0 || lower.size() != n || upper.size() != n || rhs.size() != n)
+            return {};
+
+        // Forward sweep, the solution vector doubles as storage for the modified right hand side
+        std::vector<float> modifiedUpper(n, 0.0f);
+        std::vector<Vertex> solution(n);
+
+        float denominator = diagonal[0];
+        if (std::abs(denominator) < 1e-12f)
+            return {};
+        modifiedUpper[0] = upper[0] / denominator;
+        solution[0] = rhs[0] * (1.0f / denominator);
+
+        for (size_t i = 1; i < n; i++)
+        {
+            denominator = diagonal[i] - lower[i] * modifiedUpper[i - 1];
+            if (std::abs(denominator) < 1e-12f)
+                return {};
+            modifiedUpper[i] = i < n - 1 ? upper[i] / denominator : 0.0f;
+            solution[i] = (rhs[i] - solution[i - 1] * lower[i]) * (1.0f / denominator);
+        }
+
+        // Back substitution
+        for (size_t i = n - 1; i-- > 0;)
+            solution[i] = solution[i] - solution[i + 1] * modifiedUpper[i];
+
+        return solution;
+    }
+
+    std::vector<Vertex> solveCyclicTridiagonal(const std::vector<float>& lower, const std::vector<float>& diagonal,
+        const std::vector<float>& upper, const std::vector<Vertex>& rhs)
+    {
+        size_t n = diagonal.size();
+        if (n < 3 || lower.size() != n || upper.size() != n || rhs.size() != n)
+            return {};
+
+        float topRight = lower[0];
+        float bottomLeft = upper[n - 1];
+
+        // The corners are written as u * v^T with u = (gamma, 0, ..., bottomLeft) and v = (1, 0, ..., topRight / gamma),
+        // what's left once they're taken out of the diagonal is a plain tridiagonal matrix
+        float gamma = -diagonal[0];
+        std::vector<float> modifiedDiagonal = diagonal;
+        modifiedDiagonal[0] -= gamma;
+        modifiedDiagonal[n - 1] -= bottomLeft * topRight / gamma;
+
+        std::vector<Vertex> solution = solveTridiagonal(lower, modifiedDiagonal, upper, rhs);
+
+        // Only x is used for this one
+        std::vector<Vertex> u(n, Vertex(0.0f, 0.0f));
+        u[0].x = gamma;
+        u[n - 1].x = bottomLeft;
+        std::vector<Vertex> z = solveTridiagonal(lower, modifiedDiagonal, upper, u);
+
+        if (solution.empty() || z.empty())
+            return {};
+
+        float denominator = 1.0f + z[0].x + topRight * z[n - 1].x / gamma;
+        if (std::abs(denominator) < 1e-12f)
+            return {};
+        Vertex factor = (solution[0] + solution[n - 1] * (topRight / gamma)) * (1.0f / denominator);
+
+        for (size_t i = 0; i < n; i++)
+            solution[i] = solution[i] - factor * z[i].x;
+
+        return solution;
+    }
+
+    void transformVertices(const Affine2x3& transform, const Vertex* in, Vertex* out, size_t count)
+    {
+        // Vertices are x y x y ... so with the columns interleaved the same way, one multiply-add
+        // handles x and y of several vertices : out = x * (a c a c) + y * (b d b d) + (tx ty tx ty)
+        size_t i = 0;
+
+#if defined(__AVX__)
+        const __m256 firstColumn = _mm256_setr_ps(transform.a, transform.c, transform.a, transform.c,
+            transform.a, transform.c, transform.a, transform.c);
+        const __m256 secondColumn = _mm256_setr_ps(transform.b, transform.d, transform.b, transform.d,
+            transform.b, transform.d, transform.b, transform.d);
+        const __m256 translation = _mm256_setr_ps(transform.tx, transform.ty, transform.tx, transform.ty,
+            transform.tx, transform.ty, transform.tx, transform.ty);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256 points = _mm256_loadu_ps(&in[i].x);
+            __m256 xs = _mm256_moveldup_ps(points); // x0 x0 x1 x1 ...
+            __m256 ys = _mm256_movehdup_ps(points); // y0 y0 y1 y1 ...
+            __m256 result = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(xs, firstColumn), _mm256_mul_ps(ys, secondColumn)), translation);
+            _mm256_storeu_ps(&out[i].x, result);
+        }
+#endif
+
+#if defined(MATHUTILS_SSE2)
+        const __m128 firstColumn4 = _mm_setr_ps(transform.a, transform.c, transform.a, transform.c);
+        const __m128 secondColumn4 = _mm_setr_ps(transform.b, transform.d, transform.b, transform.d);
+        const __m128 translation4 = _mm_setr_ps(transform.tx, transform.ty, transform.tx, transform.ty);
+        for (; i + 2 <= count; i += 2)
+        {
+            __m128 points = _mm_loadu_ps(&in[i].x);
+            __m128 xs = _mm_shuffle_ps(points, points, _MM_SHUFFLE(2, 2, 0, 0));
+            __m128 ys = _mm_shuffle_ps(points, points, _MM_SHUFFLE(3, 3, 1, 1));
+            __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, firstColumn4), _mm_mul_ps(ys, secondColumn4)), translation4);
+            _mm_storeu_ps(&out[i].x, result);
+        }
+#endif
+
+        for (; i < count; i++)
+            out[i] = transform.apply(in[i]);
+    }
+
+    void transformVertices(const Matrix3x3& matrix, const Vertex* in, Vertex* out, size_t count)
+    {
+        transformVertices(Affine2x3(matrix), in, out, count);
+    }
+
+    void transformPoints(const Affine2x3& transform, float* xs, float* ys, size_t count)
+    {
+        size_t i = 0;
+
+#if defined(__AVX__)
+        const __m256 a8 = _mm256_set1_ps(transform.a), b8 = _mm256_set1_ps(transform.b), tx8 = _mm256_set1_ps(transform.tx);
+        const __m256 c8 = _mm256_set1_ps(transform.c), d8 = _mm256_set1_ps(transform.d), ty8 = _mm256_set1_ps(transform.ty);
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_loadu_ps(ys + i);
+            _mm256_storeu_ps(xs + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(a8, x), _mm256_mul_ps(b8, y)), tx8));
+            _mm256_storeu_ps(ys + i, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(c8, x), _mm256_mul_ps(d8, y)), ty8));
+        }
+#endif
+
+#if defined(MATHUTILS_SSE2)
+        const __m128 a4 = _mm_set1_ps(transform.a), b4 = _mm_set1_ps(transform.b), tx4 = _mm_set1_ps(transform.tx);
+        const __m128 c4 = _mm_set1_ps(transform.c), d4 = _mm_set1_ps(transform.d), ty4 = _mm_set1_ps(transform.ty);
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_loadu_ps(ys + i);
+            _mm_storeu_ps(xs + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(a4, x), _mm_mul_ps(b4, y)), tx4));
+            _mm_storeu_ps(ys + i, _mm_add_ps(_mm_add_ps(_mm_mul_ps(c4, x), _mm_mul_ps(d4, y)), ty4));
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            Vertex point = transform.apply({ xs[i], ys[i] });
+            xs[i] = point.x;
+            ys[i] = point.y;
+        }
+    }
+}
@@ -1,11 +1,16 @@
 #include "PolyBuilder.h"
 #include "MathUtils.h"
+#include "WorkerPool.h"
 
 #include <glad/glad.h>
 #include "GLFW/glfw3.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <functional>
+#include <chrono>
 
 using namespace MathUtils;
 
@@ -26,67 +31,163 @@ void PolyBuilder::startBezierCurve()
 void PolyBuilder::removeFinishedBezier(size_t index)
 {
 	if (index < finishedBeziers.size())
-		finishedBeziers.erase(finishedBeziers.begin() + index);
+		removeShape({ SHAPE_BEZIER, static_cast<int>(index) });
 }
 
 void PolyBuilder::swapBezierAlgorithm(size_t index)
 {
 	if (index < finishedBeziers.size())
+	{
 		finishedBeziers[index].swapAlgorithm();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::incrementBezierStepSize(size_t index)
 {
 	if (index < finishedBeziers.size())
+	{
 		finishedBeziers[index].incrementStepSize();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::decrementBezierStepSize(size_t index)
 {
 	if (index < finishedBeziers.size())
+	{
 		finishedBeziers[index].decrementStepSize();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::toggleHullDisplay(size_t index)
 {
 	if (index < finishedBeziers.size())
+	{
 		finishedBeziers[index].toggleConvexHullDisplay();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER, static_cast<int>(index) });
+	}
+}
+
+void PolyBuilder::incrementGlobalStepSize()
+{
+	if (globalStepSize >= 1.0f)
+		return;
+
+	globalStepSize += 0.001f;
+	regenerateAllCurves();
+}
+
+void PolyBuilder::decrementGlobalStepSize()
+{
+	if (globalStepSize <= 0.001f)
+		return;
+
+	globalStepSize -= 0.001f;
+	regenerateAllCurves();
+}
+
+void PolyBuilder::regenerateAllCurves()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// Flatten every curve of the scene into one list, so the pool balances the work
+	// over all of them instead of going sequence by sequence
+	std::vector<Bezier*> curves;
+	for (auto& bezier : finishedBeziers)
+	{
+		bezier.setStepSize(globalStepSize);
+		curves.push_back(&bezier);
+	}
+	for (auto& sequence : finishedSequences)
+	{
+		sequence.setStepSize(globalStepSize);
+		for (auto& curve : sequence.getCurves())
+		{
+			curve.setStepSize(globalStepSize);
+			curve.setAlgorithm(sequence.getAlgorithm());
+			curves.push_back(&curve);
+		}
+	}
+
+	WorkerPool::instance().parallelFor(curves.size(), [&curves](size_t i) {
+		curves[i]->generateCurve();
+	});
+
+	for (int i = 0; i < static_cast<int>(finishedBeziers.size()); i++)
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER, i });
+
+	for (int i = 0; i < static_cast<int>(finishedSequences.size()); i++)
+	{
+		finishedSequences[i].calculateGenerationTime();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER_SEQUENCE, i });
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	lastRegenerationTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
 }
 
 void PolyBuilder::swapSequenceAlgorithm(size_t index)
 {
 	if (index < finishedSequences.size())
+	{
 		finishedSequences[index].swapAlgorithm();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER_SEQUENCE, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::incrementSequenceStepSize(size_t index)
 {
 	if (index < finishedSequences.size())
+	{
 		finishedSequences[index].incrementStepSize();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER_SEQUENCE, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::decrementSequenceStepSize(size_t index)
 {
 	if (index < finishedSequences.size())
+	{
 		finishedSequences[index].decrementStepSize();
+		noteSceneChange(SceneChange::UPDATED, { SHAPE_BEZIER_SEQUENCE, static_cast<int>(index) });
+	}
 }
 
 void PolyBuilder::removeFinishedSequence(size_t index)
 {
 	if (index < finishedSequences.size())
-		finishedSequences.erase(finishedSequences.begin() + index);
+		removeShape({ SHAPE_BEZIER_SEQUENCE, static_cast<int>(index) });
 }
 
 void PolyBuilder::curveToPolygon(size_t index)
 {
+	intersectionHits.clear();
+	findSelfIntersections(finishedSequences[index], intersectionHits);
+	if (!intersectionHits.empty())
+		std::cout << "Warning : sequence " << index << " crosses itself " << intersectionHits.size()
+			<< " time(s), the polygon won't be simple and filling it may look wrong" << std::endl;
+
 	Polygon curvePoly = createPolygonFromBezierSequence(finishedSequences[index]);
 	addFinishedPolygon(curvePoly);
 }
 
 void PolyBuilder::duplicateControlPoint(int shapeIndex, int vertexIndex)
 {
-	if (shapeIndex < finishedBeziers.size())
-		finishedBeziers[shapeIndex].duplicateControlPoint(vertexIndex);
+	if (shapeIndex < 0 || shapeIndex >= finishedBeziers.size())
+		return;
+	ShapeRef shape = { SHAPE_BEZIER, shapeIndex };
+	JournalCommand command;
+	command.kind = JournalCommand::SET_POINTS;
+	command.shape = shape;
+	gatherShapePoints(shape, command.before);
+
+	finishedBeziers[shapeIndex].duplicateControlPoint(vertexIndex);
+	noteSceneChange(SceneChange::UPDATED, shape);
+
+	gatherShapePoints(shape, command.after);
+	journal.record(std::move(command));
 }
 
 /* Why translation can be done with one matrix while others cannot:
@@ -123,587 +224,789 @@ void PolyBuilder::translate(int shapeIndex, ShapeType shapeType, float deltaX, f
 	intersections.clear();
 	Matrix3x3 translationMatrix = createTranslationMatrix(deltaX, deltaY);
 
-	// Special handling for Bzier sequences since they contain multiple collections of vertices
-	if (shapeType == SHAPE_BEZIER_SEQUENCE) {
-		if (shapeIndex >= 0 && shapeIndex < finishedSequences.size()) {
-			// Create a completely fresh copy
-			CubicBezierSequence originalSequence = finishedSequences[shapeIndex];
-
-			// Work on the copy, transform all points
-			std::vector<Bezier>& curves = originalSequence.getCurves();
-			for (auto& curve : curves) {
-				std::vector<Vertex> points = curve.getControlPoints();
-				for (auto& point : points) {
-					Vertex transformedPoint = multiplyMatrixVertex(translationMatrix, point);
-					point.x = transformedPoint.x;
-					point.y = transformedPoint.y;
-				}
-				curve.setControlPoints(points);
-				curve.generateCurve();
-			}
-
-			// Apply constraints and update buffers
-			originalSequence.enforceConstraints();
-			for (auto& curve : curves) {
-				curve.updateBuffers();
-			}
-
-			// Replace the original with our transformed copy
-			finishedSequences[shapeIndex] = originalSequence;
-		}
+	// During a drag only the model matrix moves, the vertices get it when the drag ends
+	if (isCurrentlyTransformingShape && shapeIndex == transformShapeIndex && shapeType == transformShapeType)
+	{
+		setShapeModelMatrix(translationMatrix * transformMatrix);
 		return;
 	}
 
-	// Standard handling for the other shape types
-	std::vector<Vertex> vertices;
+	transformShape({ shapeType, shapeIndex }, Affine2x3(translationMatrix));
+}
 
-	if (shapeType == SHAPE_POLYGON) {
-		if (shapeIndex >= 0 && shapeIndex < finishedPolygons.size()) {
-			Polygon& poly = finishedPolygons[shapeIndex];
-			vertices = poly.getVertices();
-		}
+void PolyBuilder::transformShape(ShapeRef shape, const Affine2x3& transform)
+{
+	if (!isValidShape(shape) || transform.isIdentity())
+		return;
+
+	JournalCommand command;
+	command.shape = shape;
+	// Something flattened can't be brought back with the inverse, the points are kept instead
+	if (std::fabs(transform.determinant()) < 1e-6f)
+	{
+		command.kind = JournalCommand::SET_POINTS;
+		gatherShapePoints(shape, command.before);
+		applyAffineToShape(shape, transform);
+		gatherShapePoints(shape, command.after);
 	}
-	else if (shapeType == SHAPE_BEZIER) {
-		if (shapeIndex >= 0 && shapeIndex < finishedBeziers.size()) {
-			Bezier& bezier = finishedBeziers[shapeIndex];
-			vertices = bezier.getControlPoints();
-		}
+	else
+	{
+		command.kind = JournalCommand::APPLY_MATRIX;
+		command.matrix = transform;
+		applyAffineToShape(shape, transform);
 	}
+	journal.record(std::move(command));
+}
 
-	// Transform the vertices
-	for (Vertex& vertex : vertices) {
-		Vertex transformedPoint = multiplyMatrixVertex(translationMatrix, vertex);
-		vertex.x = transformedPoint.x;
-		vertex.y = transformedPoint.y;
-	}
+void PolyBuilder::applyAffineToShape(ShapeRef shape, const Affine2x3& transform)
+{
+	if (!isValidShape(shape))
+		return;
 
-	// Update the shape
-	if (shapeType == SHAPE_POLYGON) {
-		if (shapeIndex >= 0 && shapeIndex < finishedPolygons.size()) {
-			Polygon& poly = finishedPolygons[shapeIndex];
-			poly.setVertices(vertices);
-			poly.updateBuffers();
-		}
-	}
-	else if (shapeType == SHAPE_BEZIER) {
-		if (shapeIndex >= 0 && shapeIndex < finishedBeziers.size()) {
-			Bezier& bezier = finishedBeziers[shapeIndex];
-			bezier.setControlPoints(vertices);
-			bezier.generateCurve();
-			bezier.updateBuffers();
-		}
-	}
+	// The shape gets its points back transformed and regenerates its curves
+	std::vector<Vertex> points;
+	gatherShapePoints(shape, points);
+	transformVertices(transform, points.data(), points.data(), points.size());
+	setShapePoints(shape, points);
 }
 
-void PolyBuilder::translateVertex(int shapeIndex, int vertexIndex, ShapeType shapeType, float deltaX, float deltaY)
+void PolyBuilder::gatherShapePoints(ShapeRef shape, std::vector<Vertex>& points) const
 {
-	foundIntersectionsText.clear();
-	intersections.clear();
-	Matrix3x3 translationMatrix = createTranslationMatrix(deltaX, deltaY);
+	points.clear();
+	visitShapePoints(shape, [&points](const Vertex* run, size_t count, int) {
+		points.insert(points.end(), run, run + count);
+	});
+}
 
-	if (shapeType == SHAPE_BEZIER_SEQUENCE)
+size_t PolyBuilder::getShapeCount(ShapeType type) const
+{
+	switch (type)
 	{
-		if (shapeIndex < 0 || shapeIndex >= finishedSequences.size())
+	case SHAPE_POLYGON: return finishedPolygons.size();
+	case SHAPE_BEZIER: return finishedBeziers.size();
+	default: return finishedSequences.size();
+	}
+}
+
+bool PolyBuilder::isValidShape(ShapeRef shape) const
+{
+	return shape.index >= 0 && shape.index < static_cast<int>(getShapeCount(shape.type));
+}
+
+size_t PolyBuilder::getShapePointCount(ShapeRef shape) const
+{
+	size_t total = 0;
+	visitShapePoints(shape, [&total](const Vertex*, size_t count, int) { total += count; });
+	return total;
+}
+
+Vertex PolyBuilder::getShapePoint(ShapeRef shape, int vertexIndex) const
+{
+	Vertex point;
+	visitShapePoints(shape, [&](const Vertex* run, size_t count, int first) {
+		if (vertexIndex >= first && vertexIndex < first + static_cast<int>(count))
+			point = run[vertexIndex - first];
+	});
+	return point;
+}
+
+bool PolyBuilder::getShapeBounds(ShapeRef shape, float& minX, float& minY, float& maxX, float& maxY) const
+{
+	bool any = false;
+	visitShapePoints(shape, [&](const Vertex* run, size_t count, int) {
+		for (size_t i = 0; i < count; i++)
 		{
-			std::cerr << "Error: Invalid sequence index " << shapeIndex << std::endl;
-			return;
+			if (!any)
+			{
+				minX = maxX = run[i].x;
+				minY = maxY = run[i].y;
+				any = true;
+				continue;
+			}
+			minX = std::min(minX, run[i].x);
+			minY = std::min(minY, run[i].y);
+			maxX = std::max(maxX, run[i].x);
+			maxY = std::max(maxY, run[i].y);
 		}
-		// Create a complete copy of the sequence to work with
-		CubicBezierSequence transformedSequence = finishedSequences[shapeIndex];
-		// Determine which curve and which point within that curve
-		int curveIndex = vertexIndex / 4;  // Integer division to get curve index
-		int pointIndexInCurve = vertexIndex % 4;  // Remainder gives point index within curve
-		// Check if this point is constrained
-		if (transformedSequence.isConstrainedPoint(curveIndex, pointIndexInCurve))
+	});
+	return any;
+}
+
+Vertex PolyBuilder::getShapeCenter(ShapeRef shape) const
+{
+	float sumX = 0.0f, sumY = 0.0f;
+	size_t total = 0;
+	visitShapePoints(shape, [&](const Vertex* run, size_t count, int) {
+		for (size_t i = 0; i < count; i++)
 		{
-			std::cout << "Cannot move constrained point in curve " << curveIndex
-				<< " at position " << pointIndexInCurve << std::endl;
-			return;
+			sumX += run[i].x;
+			sumY += run[i].y;
 		}
+		total += count;
+	});
+	if (total == 0)
+		return { 0.0f, 0.0f };
+	return { sumX / total, sumY / total };
+}
 
-		// Get the curve that contains our point from our copy
-		std::vector<Bezier>& curves = transformedSequence.getCurves();
-		if (curveIndex >= 0 && curveIndex < curves.size())
+const Matrix3x3* PolyBuilder::getShapeModelMatrix(ShapeRef shape) const
+{
+	switch (shape.type)
+	{
+	case SHAPE_POLYGON: return finishedPolygons[shape.index].getModelMatrix();
+	case SHAPE_BEZIER: return finishedBeziers[shape.index].getModelMatrix();
+	default: return finishedSequences[shape.index].getModelMatrix();
+	}
+}
+
+bool PolyBuilder::pickShape(float x, float y, ShapeRef& shape, int typeMask) const
+{
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+	{
+		if (!(typeMask & typeBit(static_cast<ShapeType>(type))))
+			continue;
+
+		int count = static_cast<int>(getShapeCount(static_cast<ShapeType>(type)));
+		for (int i = 0; i < count; i++)
 		{
-			Bezier& curve = curves[curveIndex];
-			std::vector<Vertex> controlPoints = curve.getControlPoints();
-			if (pointIndexInCurve >= 0 && pointIndexInCurve < controlPoints.size())
+			ShapeRef candidate = { static_cast<ShapeType>(type), i };
+			float minX, minY, maxX, maxY;
+			if (getShapeBounds(candidate, minX, minY, maxX, maxY) && x >= minX && x <= maxX && y >= minY && y <= maxY)
 			{
-				// Apply translation to the specific point
-				Vertex& point = controlPoints[pointIndexInCurve];
-				Vertex transformedPoint = multiplyMatrixVertex(translationMatrix, point);
-				point.x = transformedPoint.x;
-				point.y = transformedPoint.y;
+				shape = candidate;
+				return true;
+			}
+		}
+	}
+	return false;
+}
 
-				// Update the curve with the modified control points
-				curve.setControlPoints(controlPoints);
+bool PolyBuilder::pickVertex(float x, float y, float radius, ShapeRef& shape, int& vertexIndex, int typeMask) const
+{
+	float radiusSquared = radius * radius;
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+	{
+		if (!(typeMask & typeBit(static_cast<ShapeType>(type))))
+			continue;
 
-				// Handle closed sequence synchronization
-				if (transformedSequence.getIsClosed())
+		int count = static_cast<int>(getShapeCount(static_cast<ShapeType>(type)));
+		for (int i = 0; i < count; i++)
+		{
+			ShapeRef candidate = { static_cast<ShapeType>(type), i };
+			int found = -1;
+			visitShapePoints(candidate, [&](const Vertex* run, size_t runCount, int first) {
+				for (size_t j = 0; j < runCount && found < 0; j++)
 				{
-					if (pointIndexInCurve == 3 && curveIndex < curves.size() - 1)
-					{
-						// Update the first point of the next curve to match
-						std::vector<Vertex> nextPoints = curves[curveIndex + 1].getControlPoints();
-						nextPoints[0] = point; // Direct assignment to ensure exact match
-						curves[curveIndex + 1].setControlPoints(nextPoints);
-						curves[curveIndex + 1].generateCurve();
-						curves[curveIndex + 1].updateBuffers();
-					}
-
-					// If we're moving the first point of the first curve
-					if (curveIndex == 0 && pointIndexInCurve == 0)
-					{
-						// Update the end point of the last curve to match
-						int lastCurveIndex = curves.size() - 1;
-						std::vector<Vertex> lastPoints = curves[lastCurveIndex].getControlPoints();
-						lastPoints[3] = point; // Direct assignment to ensure exact match
-						curves[lastCurveIndex].setControlPoints(lastPoints);
-						curves[lastCurveIndex].generateCurve();
-						curves[lastCurveIndex].updateBuffers();
-					}
-					// If we're moving the last point of the last curve
-					else if (curveIndex == curves.size() - 1 && pointIndexInCurve == 3)
-					{
-						// Update the first point of the first curve to match
-						std::vector<Vertex> firstPoints = curves[0].getControlPoints();
-						firstPoints[0] = point; // Direct assignment to ensure exact match
-						curves[0].setControlPoints(firstPoints);
-						curves[0].generateCurve();
-						curves[0].updateBuffers();
-					}
+					float dx = run[j].x - x;
+					float dy = run[j].y - y;
+					if (dx * dx + dy * dy < radiusSquared)
+						found = first + static_cast<int>(j);
 				}
-
-				curve.generateCurve();
-				curve.updateBuffers();
-
-				// Enforce continuity constraints across the sequence
-				transformedSequence.enforceConstraints();
-
-				// Now that all modifications are done on the copy, replace the original
-				finishedSequences[shapeIndex] = transformedSequence;
+			});
+			if (found >= 0)
+			{
+				shape = candidate;
+				vertexIndex = found;
+				return true;
 			}
 		}
-		return;
 	}
+	return false;
+}
 
-	std::vector<Vertex> vertices;
-	switch (shapeType)
+void PolyBuilder::setShapePoints(ShapeRef shape, const std::vector<Vertex>& points)
+{
+	switch (shape.type)
 	{
 	case SHAPE_POLYGON:
 	{
-		Polygon& poly = finishedPolygons[shapeIndex];
-		vertices = poly.getVertices();
+		Polygon& poly = finishedPolygons[shape.index];
+		poly.setVertices(points);
 		break;
 	}
 	case SHAPE_BEZIER:
 	{
-		Bezier& bezier = finishedBeziers[shapeIndex];
-		vertices = bezier.getControlPoints();
+		Bezier& bezier = finishedBeziers[shape.index];
+		bezier.setControlPoints(points);
+		bezier.generateCurve();
+		break;
+	}
+	case SHAPE_BEZIER_SEQUENCE:
+	{
+		// Can add or remove curves (undoing a point deletion), then applies the constraints
+		finishedSequences[shape.index].setControlPoints(points);
 		break;
 	}
 	}
 
-	Vertex& vertex = vertices[vertexIndex];
+	noteSceneChange(SceneChange::UPDATED, shape);
+}
 
-	Vertex transformedPoint = multiplyMatrixVertex(translationMatrix, vertex);
-	vertex.x = transformedPoint.x;
-	vertex.y = transformedPoint.y;
+void PolyBuilder::noteCurvesChanged(ShapeRef shape, const std::vector<size_t>& curveIndices)
+{
+	for (size_t i = 0; i < curveIndices.size();)
+	{
+		size_t end = i + 1;
+		while (end < curveIndices.size() && curveIndices[end] == curveIndices[end - 1] + 1)
+			end++;
+
+		SceneChange change = { SceneChange::UPDATED, shape };
+		change.firstCurve = static_cast<int>(curveIndices[i]);
+		change.curveCount = static_cast<int>(end - i);
+		sceneChanges.push_back(change);
+		i = end;
+	}
+}
 
-	switch (shapeType)
+ShapeObject PolyBuilder::takeShape(ShapeRef shape)
+{
+	// Moved out, the journal keeps it for undo
+	ShapeObject object;
+	switch (shape.type)
 	{
 	case SHAPE_POLYGON:
-	{
-		Polygon& poly = finishedPolygons[shapeIndex];
-		poly.setVertices(vertices);
-		poly.updateBuffers();
+		object = std::move(finishedPolygons[shape.index]);
+		finishedPolygons.erase(finishedPolygons.begin() + shape.index);
 		break;
-	}
 	case SHAPE_BEZIER:
-	{
-		Bezier& bezier = finishedBeziers[shapeIndex];
-		bezier.setControlPoints(vertices);
-		bezier.generateCurve();
-		bezier.updateBuffers();
+		object = std::move(finishedBeziers[shape.index]);
+		finishedBeziers.erase(finishedBeziers.begin() + shape.index);
+		break;
+	case SHAPE_BEZIER_SEQUENCE:
+		object = std::move(finishedSequences[shape.index]);
+		finishedSequences.erase(finishedSequences.begin() + shape.index);
 		break;
 	}
-	}
+	noteSceneChange(SceneChange::REMOVED, shape);
+	return object;
 }
 
-void PolyBuilder::startTransformingShape(int shapeIndex, ShapeType shapeType)
+void PolyBuilder::putShape(ShapeRef shape, ShapeObject&& object)
 {
-	if (shapeType == SHAPE_BEZIER_SEQUENCE)
+	switch (shape.type)
 	{
-		if (shapeIndex >= 0 && shapeIndex < finishedSequences.size())
-		{
-			// Store each curve's points separately
-			for (const auto& curve : finishedSequences[shapeIndex].getCurves()) {
-				sequenceTransformData.originalCurvePoints.push_back(
-					curve.getControlPoints()
-				);
-			}
-
-			isCurrentlyTransformingShape = true;
-		}
-	}
-	else
-	{
-		if (shapeType == SHAPE_POLYGON)
-		{
-			if (shapeIndex >= 0 && shapeIndex < finishedPolygons.size())
-			{
-				transformOriginalVertices = finishedPolygons[shapeIndex].getVertices();
-				isCurrentlyTransformingShape = true;
-			}
-		}
-		else if (shapeType == SHAPE_BEZIER)
-		{
-			if (shapeIndex >= 0 && shapeIndex < finishedBeziers.size())
-			{
-				transformOriginalVertices = finishedBeziers[shapeIndex].getControlPoints();
-				isCurrentlyTransformingShape = true;
-				foundIntersectionsText.clear();
-				intersections.clear();
-			}
-		}
+	case SHAPE_POLYGON:
+		finishedPolygons.insert(finishedPolygons.begin() + shape.index, std::get<Polygon>(std::move(object)));
+		break;
+	case SHAPE_BEZIER:
+		finishedBeziers.insert(finishedBeziers.begin() + shape.index, std::get<Bezier>(std::move(object)));
+		break;
+	case SHAPE_BEZIER_SEQUENCE:
+		finishedSequences.insert(finishedSequences.begin() + shape.index, std::get<CubicBezierSequence>(std::move(object)));
+		break;
 	}
+	object = std::monostate();
+
+	noteSceneChange(SceneChange::INSERTED, shape);
 }
 
-void PolyBuilder::stopTransformingShape()
+void PolyBuilder::removeShape(ShapeRef shape)
 {
-	isCurrentlyTransformingShape = false;
-	transformOriginalVertices.clear();
-	sequenceTransformData.originalCurvePoints.clear();
+	JournalCommand command;
+	command.kind = JournalCommand::REMOVE_SHAPE;
+	command.shape = shape;
+	command.storedShape = takeShape(shape);
+	journal.record(std::move(command));
 }
 
-void PolyBuilder::applyScaleFromOriginal(int shapeIndex, ShapeType shapeType, float totalScaleFactorX, float totalScaleFactorY)
+void PolyBuilder::addShape(ShapeRef shape)
 {
-	if (!isCurrentlyTransformingShape)
-		return; // Not in a scaling operation or no original vertices
+	noteSceneChange(SceneChange::INSERTED, shape);
 
-	if (shapeType == SHAPE_BEZIER_SEQUENCE)
-	{
-		if (sequenceTransformData.originalCurvePoints.empty() ||
-			shapeIndex < 0 || shapeIndex >= finishedSequences.size())
-			return;
-
-		// Create a completely fresh copy of the original sequence
-		CubicBezierSequence transformedSequence = finishedSequences[shapeIndex];
+	JournalCommand command;
+	command.kind = JournalCommand::ADD_SHAPE;
+	command.shape = shape;
+	journal.record(std::move(command));
+}
 
-		// Get a reference to the curves in our copied sequence
-		std::vector<Bezier>& curves = transformedSequence.getCurves();
+void PolyBuilder::setModelMatrixOf(ShapeRef shape, const Matrix3x3* matrix)
+{
+	// The renderer reads the matrix from the shape every frame, it only needs to know when
+	// the shape starts or stops having one (a drag step just changes the values)
+	bool hadMatrix = getShapeModelMatrix(shape) != nullptr;
+	if (hadMatrix != (matrix != nullptr))
+		noteSceneChange(SceneChange::MODEL_MATRIX, shape);
 
-		// Flatten all points to calculate center
-		std::vector<Vertex> allPoints;
-		for (const auto& curvePoints : sequenceTransformData.originalCurvePoints) {
-			allPoints.insert(allPoints.end(), curvePoints.begin(), curvePoints.end());
-		}
+	switch (shape.type)
+	{
+	case SHAPE_POLYGON:
+		if (matrix) finishedPolygons[shape.index].setModelMatrix(*matrix);
+		else finishedPolygons[shape.index].resetModelMatrix();
+		break;
+	case SHAPE_BEZIER:
+		if (matrix) finishedBeziers[shape.index].setModelMatrix(*matrix);
+		else finishedBeziers[shape.index].resetModelMatrix();
+		break;
+	case SHAPE_BEZIER_SEQUENCE:
+		if (matrix) finishedSequences[shape.index].setModelMatrix(*matrix);
+		else finishedSequences[shape.index].resetModelMatrix();
+		break;
+	}
+}
 
-		Vertex center = calculateCenter(allPoints);
+void PolyBuilder::translateVertex(int shapeIndex, int vertexIndex, ShapeType shapeType, float deltaX, float deltaY)
+{
+	foundIntersectionsText.clear();
+	intersections.clear();
+	Matrix3x3 translationMatrix = createTranslationMatrix(deltaX, deltaY);
 
-		// Create transformation matrices
-		Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-		Matrix3x3 scalingMatrix = createScalingMatrix(totalScaleFactorX, totalScaleFactorY);
-		Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-		Matrix3x3 finalMatrix = translateBack * scalingMatrix * translateToOrigin;
+	ShapeRef shape = { shapeType, shapeIndex };
+	if (!isValidShape(shape))
+	{
+		std::cerr << "Error: Invalid shape index " << shapeIndex << std::endl;
+		return;
+	}
 
-		// Transform and update each curve
-		for (size_t i = 0; i < sequenceTransformData.originalCurvePoints.size() && i < curves.size(); i++) {
-			std::vector<Vertex> transformedPoints = sequenceTransformData.originalCurvePoints[i];
+	if (shapeType == SHAPE_BEZIER_SEQUENCE)
+	{
+		// Work on the sequence in place rather than copying every curve
+		CubicBezierSequence& sequence = finishedSequences[shapeIndex];
+		// Determine which curve and which point within that curve
+		int curveIndex = vertexIndex / 4;  // Integer division to get curve index
+		int pointIndexInCurve = vertexIndex % 4;  // Remainder gives point index within curve
+		// Check if this point is constrained
+		if (sequence.isConstrainedPoint(curveIndex, pointIndexInCurve))
+		{
+			std::cout << "Cannot move constrained point in curve " << curveIndex
+				<< " at position " << pointIndexInCurve << std::endl;
+			return;
+		}
 
-			// Transform the points
-			for (Vertex& point : transformedPoints) {
-				point = multiplyMatrixVertex(finalMatrix, point);
+		const std::vector<Bezier>& curves = sequence.getCurves();
+		if (curveIndex >= 0 && curveIndex < curves.size())
+		{
+			const std::vector<Vertex>& controlPoints = curves[curveIndex].getControlPoints();
+			if (pointIndexInCurve >= 0 && pointIndexInCurve < controlPoints.size())
+			{
+				Vertex transformedPoint = multiplyMatrixVertex(translationMatrix, controlPoints[pointIndexInCurve]);
+
+				// Handles closed sequence synchronization, and only propagates the constraints
+				// as far as they actually change something
+				const std::vector<CurveEdit>& changed = sequence.moveControlPoint(curveIndex, pointIndexInCurve, transformedPoint);
+				if (changed.empty())
+					return;
+
+				// The constraints can move other points too, only the curves they reached go in the journal
+				JournalCommand command;
+				command.kind = JournalCommand::SET_CURVES;
+				command.shape = shape;
+				command.curveIndices.reserve(changed.size());
+				command.before.reserve(changed.size() * 4);
+				command.after.reserve(changed.size() * 4);
+				for (const CurveEdit& edit : changed)
+				{
+					const std::vector<Vertex>& points = curves[edit.index].getControlPoints();
+					command.curveIndices.push_back(edit.index);
+					command.before.insert(command.before.end(), edit.before, edit.before + 4);
+					command.after.insert(command.after.end(), points.begin(), points.begin() + 4);
+				}
+				noteCurvesChanged(shape, command.curveIndices);
+				journal.record(std::move(command));
 			}
-
-			// Update the curve in our copy
-			curves[i].setControlPoints(transformedPoints);
-			curves[i].generateCurve();
 		}
+		return;
+	}
 
-		// Re-enforce constraints on our copy
-		transformedSequence.enforceConstraints();
+	std::vector<Vertex> points;
+	gatherShapePoints(shape, points);
+	if (vertexIndex < 0 || vertexIndex >= points.size())
+		return;
 
-		// Update buffers in our copy
-		for (auto& curve : curves) {
-			curve.updateBuffers();
-		}
+	JournalCommand command;
+	command.kind = JournalCommand::MOVE_VERTEX;
+	command.shape = shape;
+	command.vertexIndex = vertexIndex;
+	command.from = points[vertexIndex];
+	command.to = multiplyMatrixVertex(translationMatrix, points[vertexIndex]);
 
-		// Replace the original with our transformed copy
-		finishedSequences[shapeIndex] = transformedSequence;
+	points[vertexIndex] = command.to;
+	setShapePoints(shape, points);
+	journal.record(std::move(command));
+}
 
+void PolyBuilder::startTransformingShape(int shapeIndex, ShapeType shapeType)
+{
+	ShapeRef shape = { shapeType, shapeIndex };
+	if (!isValidShape(shape) || getShapePointCount(shape) == 0)
 		return;
+
+	if (shapeType == SHAPE_BEZIER)
+	{
+		foundIntersectionsText.clear();
+		intersections.clear();
 	}
 
-	if (transformOriginalVertices.empty())
+	// The center of the shape before the drag, scale, rotation and shear are done around it
+	transformCenter = getShapeCenter(shape);
+	transformShapeIndex = shapeIndex;
+	transformShapeType = shapeType;
+	transformMatrix = Matrix3x3();
+	isCurrentlyTransformingShape = true;
+}
+
+void PolyBuilder::stopTransformingShape()
+{
+	if (!isCurrentlyTransformingShape)
 		return;
+	isCurrentlyTransformingShape = false;
 
-	std::vector<Vertex> newVertices = transformOriginalVertices; // Work on a copy of the original
+	// Until now only the shader applied it, now the vertices really move (once)
+	setModelMatrixOf({ transformShapeType, transformShapeIndex }, nullptr);
+	transformShape({ transformShapeType, transformShapeIndex }, Affine2x3(transformMatrix));
 
-	Vertex center = calculateCenter(transformOriginalVertices); // Center of the *original* shape
+	transformShapeIndex = -1;
+	transformMatrix = Matrix3x3();
+}
 
-	Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-	Matrix3x3 scalingMatrix = createScalingMatrix(totalScaleFactorX, totalScaleFactorY);
-	Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-	Matrix3x3 finalMatrix = translateBack * scalingMatrix * translateToOrigin;
+void PolyBuilder::setShapeModelMatrix(const Matrix3x3& matrix)
+{
+	transformMatrix = matrix;
+	setModelMatrixOf({ transformShapeType, transformShapeIndex }, &transformMatrix);
+}
 
-	for (Vertex& vertex : newVertices)
-	{
-		// Apply the total transformation to each original vertex
-		Vertex transformedPoint = multiplyMatrixVertex(finalMatrix, vertex);
-		vertex.x = transformedPoint.x;
-		vertex.y = transformedPoint.y;
-	}
+// The three below just build the matrix around the original center, from the total amount since the
+// drag started (so nothing compounds). The "about" builders give translate back * transformation *
+// translate to origin directly. Nothing is rewritten or uploaded until stopTransformingShape()
+void PolyBuilder::applyScaleFromOriginal(int shapeIndex, ShapeType shapeType, float totalScaleFactorX, float totalScaleFactorY)
+{
+	if (!isCurrentlyTransformingShape || shapeIndex != transformShapeIndex || shapeType != transformShapeType)
+		return; // Not in a scaling operation
 
-	switch (shapeType)
-	{
-	case SHAPE_POLYGON:
-	{
-		if (shapeIndex >= 0 && shapeIndex < finishedPolygons.size())
-		{
-			Polygon& poly = finishedPolygons[shapeIndex];
-			poly.setVertices(newVertices);
-			poly.updateBuffers();
-		}
-		break;
-	}
-	case SHAPE_BEZIER:
-	{
-		if (shapeIndex >= 0 && shapeIndex < finishedBeziers.size())
-		{
-			Bezier& bezier = finishedBeziers[shapeIndex];
-			bezier.setControlPoints(newVertices);
-			bezier.generateCurve();
-			bezier.updateBuffers();
-		}
-		break;
-	}
-	}
+	setShapeModelMatrix(Affine2x3::scalingAbout(totalScaleFactorX, totalScaleFactorY, transformCenter).toMatrix());
 }
 
 void PolyBuilder::applyRotationFromOriginal(int shapeIndex, ShapeType shapeType, float totalRotationAngle)
 {
-	if (!isCurrentlyTransformingShape)
-		return; // Not in a scaling operation or no original vertices
+	if (!isCurrentlyTransformingShape || shapeIndex != transformShapeIndex || shapeType != transformShapeType)
+		return; // Not in a rotation operation
 
-	if (shapeType == SHAPE_BEZIER_SEQUENCE)
-	{
-		if (sequenceTransformData.originalCurvePoints.empty() ||
-			shapeIndex < 0 || shapeIndex >= finishedSequences.size())
-			return;
+	setShapeModelMatrix(Affine2x3::rotationAbout(totalRotationAngle, transformCenter).toMatrix());
+}
 
-		// Create a completely fresh copy
-		CubicBezierSequence transformedSequence = finishedSequences[shapeIndex];
+void PolyBuilder::applyShearFromOriginal(int shapeIndex, ShapeType shapeType, float totalShearX, float totalShearY)
+{
+	if (!isCurrentlyTransformingShape || shapeIndex != transformShapeIndex || shapeType != transformShapeType)
+		return; // Not in a shearing operation
 
-		// Get a reference to the curves in our copied sequence
-		std::vector<Bezier>& curves = transformedSequence.getCurves();
+	setShapeModelMatrix(Affine2x3::shearingAbout(totalShearX, totalShearY, transformCenter).toMatrix());
+}
 
-		// Flatten all points to calculate center
-		std::vector<Vertex> allPoints;
-		for (const auto& curvePoints : sequenceTransformData.originalCurvePoints) {
-			allPoints.insert(allPoints.end(), curvePoints.begin(), curvePoints.end());
-		}
+bool PolyBuilder::isSegmentJunctionHit(const CubicBezierSequence& sequence, int curveA, int curveB, float t1, float t2)
+{
+	// Smooth sequences are tangent at their junctions, clipping only gets within about 1e-3 of those
+	const float junctionTolerance = 1e-2f;
+	auto near = [junctionTolerance](float t, float end) { return std::abs(t - end) < junctionTolerance; };
+
+	// End of one curve on the start of the next, in either order
+	if (curveB == curveA + 1 && near(t1, 1.0f) && near(t2, 0.0f))
+		return true;
+	if (curveA == curveB + 1 && near(t1, 0.0f) && near(t2, 1.0f))
+		return true;
+
+	// First and last segments meet too when the sequence is closed
+	if (!sequence.getIsClosed())
+		return false;
+	int lastCurve = sequence.getNumberOfCurves() - 1;
+	if (curveA == lastCurve && curveB == 0 && near(t1, 1.0f) && near(t2, 0.0f))
+		return true;
+	return curveA == 0 && curveB == lastCurve && near(t1, 0.0f) && near(t2, 1.0f);
+}
 
-		Vertex center = calculateCenter(allPoints);
+std::string PolyBuilder::intersectionCandidateName(const IntersectionCandidate& candidate) const
+{
+	if (candidate.curveIndex < 0)
+		return u8"Bzier " + std::to_string(candidate.shapeIndex);
 
-		// Create transformation matrices
-		Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-		Matrix3x3 rotationMatrix = createRotationMatrix(totalRotationAngle);
-		Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-		Matrix3x3 finalMatrix = translateBack * rotationMatrix * translateToOrigin;
+	return "Sequence " + std::to_string(candidate.shapeIndex) + " segment " + std::to_string(candidate.curveIndex);
+}
 
-		// Transform and update each curve
-		for (size_t i = 0; i < sequenceTransformData.originalCurvePoints.size() && i < curves.size(); i++) {
-			std::vector<Vertex> transformedPoints = sequenceTransformData.originalCurvePoints[i];
+void PolyBuilder::findSelfIntersections(const Bezier& curve, std::vector<BezierHit>& hits)
+{
+	selfIntersector.setMethod(intersectionMethod);
+	if (!selfIntersector.selfIntersect(curve.getControlPoints(), hits))
+		std::cout << "Too many control points to look for self intersections (max " << CurveSpan::maxPoints << ")" << std::endl;
+	else if (selfIntersector.wasLastTruncated())
+		lastIntersectionTruncated++;
+}
 
-			// Transform the points
-			for (Vertex& point : transformedPoints) {
-				point = multiplyMatrixVertex(finalMatrix, point);
-			}
+// Drops the hits from first on that are on top of an earlier one. Sorted on x, so each hit
+// is only compared with the few close to it instead of every hit found so far
+static void removeDuplicateHits(std::vector<BezierHit>& hits, size_t first)
+{
+	const float epsilon = 1e-3f; // Closer than this, two hits are the same point
+
+	size_t count = hits.size() - first;
+	std::vector<size_t> order(count), rank(count);
+	for (size_t i = 0; i < count; i++)
+		order[i] = first + i;
+	std::sort(order.begin(), order.end(), [&hits](size_t a, size_t b) { return hits[a].point.x < hits[b].point.x; });
+	for (size_t i = 0; i < count; i++)
+		rank[order[i] - first] = i;
+
+	// In the order they were found, each one is dropped if it's on a hit kept before it,
+	// same result as appending them one by one
+	std::vector<unsigned char> duplicate(hits.size(), 0);
+	auto onKeptHit = [&](size_t hit, size_t other) {
+		return other < hit && !duplicate[other] && squaredDistance(hits[hit].point, hits[other].point) < epsilon * epsilon;
+	};
+	for (size_t hit = first; hit < hits.size(); hit++)
+	{
+		size_t position = rank[hit - first];
+		for (size_t j = position + 1; j < count && hits[order[j]].point.x - hits[hit].point.x < epsilon && !duplicate[hit]; j++)
+			duplicate[hit] = onKeptHit(hit, order[j]);
+		for (size_t j = position; j-- > 0 && hits[hit].point.x - hits[order[j]].point.x < epsilon && !duplicate[hit];)
+			duplicate[hit] = onKeptHit(hit, order[j]);
+	}
 
-			// Update the curve in our copy
-			curves[i].setControlPoints(transformedPoints);
-			curves[i].generateCurve();
-		}
+	size_t kept = first;
+	for (size_t i = first; i < hits.size(); i++)
+		if (!duplicate[i])
+			hits[kept++] = hits[i];
+	hits.resize(kept);
+}
 
-		// Re-enforce constraints on our copy
-		transformedSequence.enforceConstraints();
+void PolyBuilder::findSelfIntersections(const CubicBezierSequence& sequence, std::vector<BezierHit>& hits)
+{
+	const std::vector<Bezier>& curves = sequence.getCurves();
+	int curveCount = static_cast<int>(curves.size());
+	size_t firstHit = hits.size();
+
+	selfIntersector.setMethod(intersectionMethod);
+
+	// Curves crossing each other, only the ones whose boxes overlap (same sweep as tryFindingIntersections)
+	selfIntersectionCandidates.clear();
+	IntersectionCandidate candidate;
+	for (int i = 0; i < curveCount; i++)
+		if (makeIntersectionCandidate(curves[i], 0, i, candidate))
+			selfIntersectionCandidates.push_back(candidate);
+	findOverlappingPairs(selfIntersectionCandidates, selfIntersectionPairs);
+
+	// Back to curve indices, in curve order : when hits are on top of each other, the one kept
+	// is the same as when every pair was tested
+	for (auto& pair : selfIntersectionPairs)
+	{
+		size_t i = selfIntersectionCandidates[pair.first].curveIndex;
+		size_t j = selfIntersectionCandidates[pair.second].curveIndex;
+		pair = { std::min(i, j), std::max(i, j) };
+	}
+	std::sort(selfIntersectionPairs.begin(), selfIntersectionPairs.end());
 
-		// Update buffers in our copy
-		for (auto& curve : curves) {
-			curve.updateBuffers();
+	size_t nextPair = 0;
+	for (int i = 0; i < curveCount; i++)
+	{
+		// Loops inside a single curve
+		selfIntersectionScratch.clear();
+		selfIntersector.selfIntersect(curves[i].getControlPoints(), selfIntersectionScratch);
+		if (selfIntersector.wasLastTruncated())
+			lastIntersectionTruncated++;
+		for (BezierHit hit : selfIntersectionScratch)
+		{
+			hit.t1 += i;
+			hit.t2 += i;
+			hits.push_back(hit);
 		}
 
-		// Replace the original with our transformed copy
-		finishedSequences[shapeIndex] = transformedSequence;
-
-		return;
+		// Against the curves after it
+		for (; nextPair < selfIntersectionPairs.size() && selfIntersectionPairs[nextPair].first == static_cast<size_t>(i); nextPair++)
+			intersectSequenceCurves(sequence, i, static_cast<int>(selfIntersectionPairs[nextPair].second), hits);
 	}
 
-	if (transformOriginalVertices.empty())
-		return;
-
-	std::vector<Vertex> newVertices = transformOriginalVertices; // Work on a copy of the original
+	// A crossing right on a junction gets found from both curves around it
+	removeDuplicateHits(hits, firstHit);
+}
 
-	Vertex center = calculateCenter(transformOriginalVertices); // Center of the *original* shape
+void PolyBuilder::intersectSequenceCurves(const CubicBezierSequence& sequence, int i, int j, std::vector<BezierHit>& hits)
+{
+	const std::vector<Bezier>& curves = sequence.getCurves();
 
-	Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-	Matrix3x3 rotationMatrix = createRotationMatrix(totalRotationAngle);
-	Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-	Matrix3x3 finalMatrix = translateBack * rotationMatrix * translateToOrigin;
+	selfIntersectionScratch.clear();
+	selfIntersector.intersect(curves[i].getControlPoints(), curves[j].getControlPoints(), selfIntersectionScratch);
+	if (selfIntersector.wasLastTruncated())
+		lastIntersectionTruncated++;
 
-	for (Vertex& vertex : newVertices)
+	for (BezierHit hit : selfIntersectionScratch)
 	{
-		Vertex transformedPoint = multiplyMatrixVertex(finalMatrix, vertex);
-		vertex.x = transformedPoint.x;
-		vertex.y = transformedPoint.y;
-	}
+		if (isSegmentJunctionHit(sequence, i, j, hit.t1, hit.t2))
+			continue;
 
-	switch (shapeType)
-	{
-	case SHAPE_POLYGON:
-	{
-		Polygon& poly = finishedPolygons[shapeIndex];
-		poly.setVertices(newVertices);
-		poly.updateBuffers();
-		break;
+		hit.t1 += i;
+		hit.t2 += j;
+		hits.push_back(hit);
 	}
-	case SHAPE_BEZIER:
+}
+
+bool PolyBuilder::makeIntersectionCandidate(const Bezier& curve, int shapeIndex, int curveIndex, IntersectionCandidate& candidate)
+{
+	const std::vector<Vertex>& points = curve.getControlPoints();
+	if (points.size() < 2)
+		return false;
+
+	candidate = { &curve, shapeIndex, curveIndex, points[0].x, points[0].y, points[0].x, points[0].y };
+	for (const Vertex& point : points)
 	{
-		Bezier& bezier = finishedBeziers[shapeIndex];
-		bezier.setControlPoints(newVertices);
-		bezier.generateCurve();
-		bezier.updateBuffers();
-		break;
-	}
+		candidate.minX = std::min(candidate.minX, point.x);
+		candidate.minY = std::min(candidate.minY, point.y);
+		candidate.maxX = std::max(candidate.maxX, point.x);
+		candidate.maxY = std::max(candidate.maxY, point.y);
 	}
+	return true;
 }
 
-void PolyBuilder::applyShearFromOriginal(int shapeIndex, ShapeType shapeType, float totalShearX, float totalShearY)
+void PolyBuilder::findOverlappingPairs(std::vector<IntersectionCandidate>& candidates, std::vector<std::pair<size_t, size_t>>& pairs)
 {
-	if (!isCurrentlyTransformingShape)
-		return; // Not in a scaling operation
+	// Only the boxes still open on x at the current one can overlap it, then y gets checked
+	std::sort(candidates.begin(), candidates.end(),
+		[](const IntersectionCandidate& a, const IntersectionCandidate& b) { return a.minX < b.minX; });
 
-	if (shapeType == SHAPE_BEZIER_SEQUENCE)
+	pairs.clear();
+	std::vector<size_t> active;
+	for (size_t i = 0; i < candidates.size(); i++)
 	{
-		if (sequenceTransformData.originalCurvePoints.empty() ||
-			shapeIndex < 0 || shapeIndex >= finishedSequences.size())
-			return;
+		const IntersectionCandidate& current = candidates[i];
 
-		// Create a completely fresh copy
-		CubicBezierSequence transformedSequence = finishedSequences[shapeIndex];
+		active.erase(std::remove_if(active.begin(), active.end(),
+			[&](size_t index) { return candidates[index].maxX < current.minX; }), active.end());
 
-		// Get a reference to the curves in our copied sequence
-		std::vector<Bezier>& curves = transformedSequence.getCurves();
+		for (size_t index : active)
+		{
+			const IntersectionCandidate& other = candidates[index];
+			if (other.maxY < current.minY || current.maxY < other.minY)
+				continue;
 
-		// Flatten all points to calculate center
-		std::vector<Vertex> allPoints;
-		for (const auto& curvePoints : sequenceTransformData.originalCurvePoints) {
-			allPoints.insert(allPoints.end(), curvePoints.begin(), curvePoints.end());
+			pairs.push_back({ index, i });
 		}
 
-		Vertex center = calculateCenter(allPoints);
-
-		// Create transformation matrices
-		Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-		Matrix3x3 shearingMatrix = createShearingMatrix(totalShearX, totalShearY);
-		Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-		Matrix3x3 finalMatrix = translateBack * shearingMatrix * translateToOrigin;
+		active.push_back(i);
+	}
+}
 
-		// Transform and update each curve
-		for (size_t i = 0; i < sequenceTransformData.originalCurvePoints.size() && i < curves.size(); i++) {
-			std::vector<Vertex> transformedPoints = sequenceTransformData.originalCurvePoints[i];
+void PolyBuilder::tryFindingIntersections()
+{
+	auto start = std::chrono::steady_clock::now();
 
-			// Transform the points
-			for (Vertex& point : transformedPoints) {
-				point = multiplyMatrixVertex(finalMatrix, point);
-			}
+	intersections.clear();
+	foundIntersectionsText.clear();
+	lastIntersectionTruncated = 0;
+
+	// Gather every curve with its bounding box
+	intersectionCandidates.clear();
+	auto addCandidate = [this](const Bezier& curve, int shapeIndex, int curveIndex) {
+		IntersectionCandidate candidate;
+		if (makeIntersectionCandidate(curve, shapeIndex, curveIndex, candidate))
+			intersectionCandidates.push_back(candidate);
+	};
+
+	for (int i = 0; i < finishedBeziers.size(); i++)
+		addCandidate(finishedBeziers[i], i, -1);
+	for (int i = 0; i < finishedSequences.size(); i++)
+	{
+		const std::vector<Bezier>& curves = finishedSequences[i].getCurves();
+		for (int j = 0; j < curves.size(); j++)
+			addCandidate(curves[j], i, j);
+	}
 
-			// Update the curve in our copy
-			curves[i].setControlPoints(transformedPoints);
-			curves[i].generateCurve();
-		}
+	findOverlappingPairs(intersectionCandidates, intersectionPairs);
 
-		// Re-enforce constraints on our copy
-		transformedSequence.enforceConstraints();
+	// Narrow phase, each pair writes in its own hit list so they can run at the same time
+	if (intersectionPairHits.size() < intersectionPairs.size())
+		intersectionPairHits.resize(intersectionPairs.size());
+	intersectionPairIterations.assign(intersectionPairs.size(), 0);
+	intersectionPairTruncated.assign(intersectionPairs.size(), 0);
 
-		// Update buffers in our copy
-		for (auto& curve : curves) {
-			curve.updateBuffers();
-		}
+	auto testPair = [this](size_t pairIndex) {
+		// One per thread, each keeps its own subdivision stack
+		static thread_local BezierIntersector intersector(0.005f, 10);
 
-		// Replace the original with our transformed copy
-		finishedSequences[shapeIndex] = transformedSequence;
+		const IntersectionCandidate& candidateA = intersectionCandidates[intersectionPairs[pairIndex].first];
+		const IntersectionCandidate& candidateB = intersectionCandidates[intersectionPairs[pairIndex].second];
+		const Bezier& curveA = *candidateA.curve;
+		const Bezier& curveB = *candidateB.curve;
+		std::vector<BezierHit>& hits = intersectionPairHits[pairIndex];
+		hits.clear();
 
-		return;
-	}
-
-	if (transformOriginalVertices.empty())
-		return;
+		intersector.setMethod(intersectionMethod);
+		if (intersector.intersect(curveA.getControlPoints(), curveB.getControlPoints(), hits))
+		{
+			intersectionPairIterations[pairIndex] = intersector.getLastIterations();
+			intersectionPairTruncated[pairIndex] = intersector.wasLastTruncated();
 
-	std::vector<Vertex> newVertices = transformOriginalVertices; // Work on a copy of the original
+			// Segments of the same sequence, only their shared end point is dropped
+			if (candidateA.curveIndex >= 0 && candidateB.curveIndex >= 0 && candidateA.shapeIndex == candidateB.shapeIndex)
+			{
+				const CubicBezierSequence& sequence = finishedSequences[candidateA.shapeIndex];
+				hits.erase(std::remove_if(hits.begin(), hits.end(), [&](const BezierHit& hit) {
+					return isSegmentJunctionHit(sequence, candidateA.curveIndex, candidateB.curveIndex, hit.t1, hit.t2);
+				}), hits.end());
+			}
+		}
+		else
+		{
+			// Too many control points for the intersector, the recursive version handles any degree
+			for (const Vertex& point : findBezierIntersections(curveA, curveB, 0.005f, 10))
+				hits.push_back({ point, -1.0f, -1.0f });
+		}
+	};
 
-	Vertex center = calculateCenter(transformOriginalVertices); // Center of the *original* shape
+	if (parallelIntersections)
+		WorkerPool::instance().parallelFor(intersectionPairs.size(), testPair);
+	else
+		for (size_t i = 0; i < intersectionPairs.size(); i++)
+			testPair(i);
+
+	auto end = std::chrono::steady_clock::now();
+	lastIntersectionTime = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+	lastIntersectionPairs = intersectionPairs.size();
+	lastIntersectionIterations = 0;
+	for (int iterations : intersectionPairIterations)
+		lastIntersectionIterations += iterations;
+	for (unsigned char truncated : intersectionPairTruncated)
+		lastIntersectionTruncated += truncated;
+
+	// Markers are GL objects, so they get filled here on the main thread
+	for (size_t i = 0; i < intersectionPairs.size(); i++)
+	{
+		const std::vector<BezierHit>& hits = intersectionPairHits[i];
+		if (hits.empty())
+			continue;
 
-	Matrix3x3 translateToOrigin = createTranslationMatrix(-center.x, -center.y);
-	Matrix3x3 shearingMatrix = createShearingMatrix(totalShearX, totalShearY);
-	Matrix3x3 translateBack = createTranslationMatrix(center.x, center.y);
-	Matrix3x3 finalMatrix = translateBack * shearingMatrix * translateToOrigin;
+		for (const auto& hit : hits)
+			intersections.addPoint(hit.point);
 
-	for (Vertex& vertex : newVertices)
-	{
-		Vertex transformedPoint = multiplyMatrixVertex(finalMatrix, vertex);
-		vertex.x = transformedPoint.x;
-		vertex.y = transformedPoint.y;
+		foundIntersectionsText.push_back(u8"Intersection found on "
+			+ intersectionCandidateName(intersectionCandidates[intersectionPairs[i].first]) + " and "
+			+ intersectionCandidateName(intersectionCandidates[intersectionPairs[i].second]));
 	}
 
-	switch (shapeType)
+	// Curves crossing themselves (these break polygons made from sequences)
+	for (int i = 0; i < finishedBeziers.size(); i++)
 	{
-	case SHAPE_POLYGON:
-	{
-		Polygon& poly = finishedPolygons[shapeIndex];
-		poly.setVertices(newVertices);
-		poly.updateBuffers();
-		break;
+		intersectionHits.clear();
+		findSelfIntersections(finishedBeziers[i], intersectionHits);
+		if (intersectionHits.empty())
+			continue;
+
+		for (const auto& hit : intersectionHits)
+			intersections.addPoint(hit.point);
+		foundIntersectionsText.push_back(u8"Self intersection found on Bzier " + std::to_string(i));
 	}
-	case SHAPE_BEZIER:
-	{
-		Bezier& bezier = finishedBeziers[shapeIndex];
-		bezier.setControlPoints(newVertices);
-		bezier.generateCurve();
-		bezier.updateBuffers();
-		break;
-	}
-	}
-}
 
-void PolyBuilder::tryFindingIntersections()
-{
-	if (finishedBeziers.size() < 2)
-		return;
-
-	for (int i = 0; i < finishedBeziers.size() - 1; i++)
+	// Segments of a sequence crossing each other already came out of the pair pass, only the loops
+	// inside each segment are left (the whole sequence version would report those pairs a second time)
+	for (int i = 0; i < finishedSequences.size(); i++)
 	{
-		std::vector<Vertex> hullA = finishedBeziers[i].getConvexHull();
-		std::vector<Vertex> hullB = finishedBeziers[i + 1].getConvexHull();
-
-		bool result = testHullIntersection(hullA, hullB);
-
-		if (result)
-		{
-			std::vector<Vertex> foundIntersections = findBezierIntersections(finishedBeziers[i], finishedBeziers[i + 1], 0.005f, 10);
-			if (!foundIntersections.empty())
-			{
-				for (const auto& intersection : foundIntersections)
-					intersections.addPoint(intersection);
-
-				foundIntersectionsText.push_back(u8"Intersection found on Bzier " + std::to_string(i) + " and " + std::to_string(i + 1));
-			}
-		}
+		intersectionHits.clear();
+		for (const Bezier& curve : finishedSequences[i].getCurves())
+			findSelfIntersections(curve, intersectionHits);
+		if (intersectionHits.empty())
+			continue;
+
+		for (const auto& hit : intersectionHits)
+			intersections.addPoint(hit.point);
+		foundIntersectionsText.push_back("Self intersection found on Sequence " + std::to_string(i));
 	}
 }
 
-bool PolyBuilder::testHullIntersection(const std::vector<Vertex> shapeA, const std::vector<Vertex> shapeB)
+bool PolyBuilder::testHullIntersection(const std::vector<Vertex>& shapeA, const std::vector<Vertex>& shapeB)
 {
 	// Make list of all normal vectors
 	// Those are our potential separating axes
@@ -786,10 +1089,10 @@ void PolyBuilder::appendVertex(double xPos, double yPos)
 
 	if (bezierMode)
 	{
+		// No upload here, the preview goes through the PreviewStream
 		tempBezier.addControlPoint(normalizedX, normalizedY);
 		if (tempBezier.getControlPoints().size() > 2)
 			tempBezier.generateCurve();
-		tempBezier.updateBuffers();
 	}
 	else if (cubicSequenceMode)
 	{
@@ -798,7 +1101,6 @@ void PolyBuilder::appendVertex(double xPos, double yPos)
 	else
 	{
 		tempPolygon.addVertex(normalizedX, normalizedY);
-		tempPolygon.updateBuffers();
 	}
 }
 
@@ -829,17 +1131,17 @@ void PolyBuilder::finishPolygon()
 	switch (polyType)
 	{
 	case (POLYGON):
-		polygon = tempPolygon;
+		polygon = std::move(tempPolygon);
 		polygon.type = POLYGON;
-		polygon.updateBuffers();
-		finishedPolygons.push_back(polygon);
+		finishedPolygons.push_back(std::move(polygon));
+		addShape({ SHAPE_POLYGON, static_cast<int>(finishedPolygons.size()) - 1 });
 		break;
 
 	case (WINDOW):
-		window = tempPolygon;
+		window = std::move(tempPolygon);
 		window.type = WINDOW;
-		window.updateBuffers();
-		finishedPolygons.push_back(window);
+		finishedPolygons.push_back(std::move(window));
+		addShape({ SHAPE_POLYGON, static_cast<int>(finishedPolygons.size()) - 1 });
 		break;
 	}
 
@@ -854,11 +1156,11 @@ void PolyBuilder::finishBezier()
 	if (!buildingShape)
 		return;
 
-	bezier = tempBezier;
+	bezier = std::move(tempBezier);
 	bezier.generateConvexHull();
 	bezier.generateCurve();
-	bezier.updateBuffers();
-	finishedBeziers.push_back(bezier);
+	finishedBeziers.push_back(std::move(bezier));
+	addShape({ SHAPE_BEZIER, static_cast<int>(finishedBeziers.size()) - 1 });
 	buildingShape = false;
 	toggleBezierMode();
 	tempBezier = Bezier();
@@ -884,14 +1186,12 @@ void PolyBuilder::appendToCubicSequence(float x, float y) {
 	tempBezier.addControlPoint(x, y);
 	if (tempBezier.getControlPoints().size() > 2)
 		tempBezier.generateCurve();
-	tempBezier.updateBuffers();
 
 	// If we now have 4 points, we have a complete cubic curve
 	if (tempBezier.getControlPoints().size() == 4) {
-		tempBezier.generateCurve();
-		tempBezier.updateBuffers();
 		currentSequence.addCurve(tempBezier);
-		currentSequence.enforceConstraints(); // Apply continuity constraints
+		// Apply continuity constraints, only the new junction can be unsatisfied
+		currentSequence.enforceConstraintsFrom(currentSequence.getNumberOfCurves() - 2);
 
 		// Reset for the next curve
 		tempBezier = Bezier();
@@ -912,7 +1212,8 @@ void PolyBuilder::finishCubicSequence() {
 			std::cout << "New sequence is closed !" << std::endl;
 		}
 		currentSequence.calculateGenerationTime();
-		finishedSequences.push_back(currentSequence);
+		finishedSequences.push_back(std::move(currentSequence));
+		addShape({ SHAPE_BEZIER_SEQUENCE, static_cast<int>(finishedSequences.size()) - 1 });
 	}
 
 	// Reset state
@@ -921,20 +1222,6 @@ void PolyBuilder::finishCubicSequence() {
 	buildingShape = false;
 }
 
-// For transformations that should take place on the center, like scaling or shearing
-Vertex PolyBuilder::calculateCenter(const std::vector<Vertex>& vertices)
-{
-	if (vertices.empty()) return { 0.0f, 0.0f };
-	float sumX = 0.0f;
-	float sumY = 0.0f;
-	for (const auto& vert : vertices)
-	{
-		sumX += vert.x;
-		sumY += vert.y;
-	}
-	return { sumX / vertices.size(), sumY / vertices.size() };
-}
-
 void PolyBuilder::cancel()
 {
 	buildingShape = false;
@@ -942,91 +1229,97 @@ void PolyBuilder::cancel()
 	tempBezier = Bezier();
 }
 
-void PolyBuilder::deleteVertex(int shapeIndex, int vertexIndex, ShapeType shapeType)
+// A cubic can't lose a single point, so deleting one from a sequence takes a whole curve out.
+// A junction merges the two curves meeting there (first half of one, second half of the other),
+// a handle removes its curve and the next one starts where it started, and an open end just
+// drops its curve. points is 4 per curve
+static void removeSequencePoint(std::vector<Vertex>& points, bool closed, int vertexIndex)
 {
-	std::vector<Vertex> vertices;
+	int curveCount = static_cast<int>(points.size() / 4);
+	int curve = vertexIndex / 4;
+	int point = vertexIndex % 4;
+	auto at = [&points](int curveIndex, int pointIndex) -> Vertex& { return points[curveIndex * 4 + pointIndex]; };
 
-	switch (shapeType)
-	{
-	case SHAPE_POLYGON:
+	// The end of a curve is the start of the next one (the first one when closed)
+	if (point == 3 && (closed || curve < curveCount - 1))
 	{
-		if (shapeIndex < 0 || shapeIndex >= finishedPolygons.size())
-		{
-			std::cerr << "Error: Invalid polygon index " << shapeIndex << std::endl;
-			return;
-		}
-
-		Polygon& poly = finishedPolygons[shapeIndex];
-		vertices = poly.getVertices();
-
-		// Check vertex index validity
-		if (vertexIndex < 0 || vertexIndex >= vertices.size())
-		{
-			std::cerr << "Error: Invalid vertex index " << vertexIndex << " for polygon " << shapeIndex << std::endl;
-			return;
-		}
+		curve = (curve + 1) % curveCount;
+		point = 0;
+	}
 
-		vertices.erase(vertices.begin() + vertexIndex);
+	if (point == 0 && (closed || curve > 0) && curveCount > 1)
+	{
+		int previous = (curve + curveCount - 1) % curveCount;
+		at(previous, 2) = at(curve, 2);
+		at(previous, 3) = at(curve, 3);
+		points.erase(points.begin() + curve * 4, points.begin() + curve * 4 + 4);
+		return;
+	}
 
-		if (vertices.size() < 3)
-		{
-			std::cout << "Polygon " << shapeIndex << " has less than 3 vertices after deletion. Removing polygon." << std::endl;
-			finishedPolygons.erase(finishedPolygons.begin() + shapeIndex);
-			return; // Polygon removed
-		}
+	bool openEnd = !closed && (point == 0 || point == 3);
+	Vertex start = at(curve, 0);
+	points.erase(points.begin() + curve * 4, points.begin() + curve * 4 + 4);
+	int left = curveCount - 1;
+	if (!openEnd && left > 0 && (closed || curve < left))
+		at(curve % left, 0) = start;
+}
 
-		poly.setVertices(vertices);
-		poly.updateBuffers();
-		break;
-	}
-	case SHAPE_BEZIER:
+void PolyBuilder::deleteVertex(int shapeIndex, int vertexIndex, ShapeType shapeType)
+{
+	const char* shapeName = shapeType == SHAPE_POLYGON ? "polygon" : shapeType == SHAPE_BEZIER ? "Bezier" : "sequence";
+	ShapeRef shape = { shapeType, shapeIndex };
+	if (!isValidShape(shape))
 	{
-		// Check index validity for the Bezier list
-		if (shapeIndex < 0 || shapeIndex >= finishedBeziers.size())
-		{
-			std::cerr << "Error: Invalid Bezier index " << shapeIndex << std::endl;
-			return;
-		}
-		Bezier& bezier = finishedBeziers[shapeIndex];
-		vertices = bezier.getControlPoints();
+		std::cerr << "Error: Invalid " << shapeName << " index " << shapeIndex << std::endl;
+		return;
+	}
 
-		// Check vertex index validity
-		if (vertexIndex < 0 || vertexIndex >= vertices.size())
-		{
-			std::cerr << "Error: Invalid control point index " << vertexIndex << " for Bezier " << shapeIndex << std::endl;
-			return;
-		}
+	std::vector<Vertex> points;
+	gatherShapePoints(shape, points);
 
-		vertices.erase(vertices.begin() + vertexIndex);
+	// Check vertex index validity
+	if (vertexIndex < 0 || vertexIndex >= points.size())
+	{
+		std::cerr << "Error: Invalid vertex index " << vertexIndex << " for " << shapeName << " " << shapeIndex << std::endl;
+		return;
+	}
 
-		if (vertices.size() < 2)
-		{
-			std::cout << "Bezier " << shapeIndex << " has less than 2 control points after deletion. Removing Bezier." << std::endl;
-			finishedBeziers.erase(finishedBeziers.begin() + shapeIndex);
-			return; // Bezier removed
-		}
+	JournalCommand command;
+	command.kind = JournalCommand::SET_POINTS;
+	command.shape = shape;
+	command.before = points;
+	if (shapeType == SHAPE_BEZIER_SEQUENCE)
+		removeSequencePoint(points, finishedSequences[shapeIndex].getIsClosed(), vertexIndex);
+	else
+		points.erase(points.begin() + vertexIndex);
 
-		bezier.setControlPoints(vertices);
-		bezier.generateCurve();
-		bezier.updateBuffers();
-		break;
-	}
-	case SHAPE_BEZIER_SEQUENCE:
+	// A polygon needs 3 vertices, a Bezier 2 control points, a sequence one curve
+	size_t minimumPoints = shapeType == SHAPE_POLYGON ? 3 : shapeType == SHAPE_BEZIER ? 2 : 4;
+	if (points.size() < minimumPoints)
 	{
-		// TODO : this case
-		break;
-	}
+		std::cout << shapeName << " " << shapeIndex << " has less than " << minimumPoints
+			<< " points after deletion. Removing it." << std::endl;
+		removeShape(shape);
+		return;
 	}
+
+	setShapePoints(shape, points);
+	// The constraints can move the sequence's other points, so they're read back as they ended up
+	gatherShapePoints(shape, command.after);
+	journal.record(std::move(command));
 }
 
 // Add a filled polygon to our storage
 void PolyBuilder::addFilledPolygon(const Polygon& poly,
 	const std::vector<Vertex>& fillPoints,
-	float r, float g, float b, float a)
+	float r, float g, float b, float a,
+	const std::vector<uint8_t>& coverage)
 {
 	FilledPolygon filled;
 	filled.polygon = poly;
 	filled.fillPoints = fillPoints;
+	if (coverage.size() == fillPoints.size())
+		filled.coverage = coverage;
 	filled.colorR = r;
 	filled.colorG = g;
 	filled.colorB = b;
@@ -1039,15 +1332,26 @@ void PolyBuilder::addFilledPolygon(const Polygon& poly,
 	// Upload fill points to GPU
 	glBindVertexArray(filled.vao);
 	glBindBuffer(GL_ARRAY_BUFFER, filled.vbo);
+	// Coverage bytes go after the points in the same buffer
+	size_t pointsSize = fillPoints.size() * sizeof(Vertex);
 	glBufferData(GL_ARRAY_BUFFER,
-		fillPoints.size() * sizeof(Vertex),
-		fillPoints.data(),
+		pointsSize + filled.coverage.size(),
+		nullptr,
 		GL_STATIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, pointsSize, fillPoints.data());
 
 	// Set up vertex attributes
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 	glEnableVertexAttribArray(0);
 
+	// Without coverage the attribute stays disabled, and the renderer's constant 1 is used
+	if (!filled.coverage.empty())
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, pointsSize, filled.coverage.size(), filled.coverage.data());
+		glVertexAttribPointer(1, 1, GL_UNSIGNED_BYTE, GL_TRUE, 1, (void*)pointsSize);
+		glEnableVertexAttribArray(1);
+	}
+
 	// Add to our collection
 	filledPolygons.push_back(filled);
 }
@@ -1067,6 +1371,21 @@ void PolyBuilder::clearFilledPolygons()
 	filledPolygons.clear();
 }
 
+void PolyBuilder::releaseGL()
+{
+	intersections.releaseGL();
+	// The fills keep their points, only the handles go
+	for (auto& filled : filledPolygons)
+	{
+		if (filled.vao != 0)
+		{
+			glDeleteVertexArrays(1, &filled.vao);
+			glDeleteBuffers(1, &filled.vbo);
+			filled.vao = filled.vbo = 0;
+		}
+	}
+}
+
 const std::vector<Polygon>& PolyBuilder::getFinishedPolygons() const
 {
 	return finishedPolygons;
@@ -1074,7 +1393,15 @@ const std::vector<Polygon>& PolyBuilder::getFinishedPolygons() const
 
 void PolyBuilder::setFinishedPolygons(std::vector<Polygon> newFinishedPolygons)
 {
-	finishedPolygons = newFinishedPolygons;
+	journal.beginStep("Replace polygons");
+	for (int i = static_cast<int>(finishedPolygons.size()) - 1; i >= 0; i--)
+		removeShape({ SHAPE_POLYGON, i });
+	for (auto& polygon : newFinishedPolygons)
+	{
+		finishedPolygons.push_back(std::move(polygon));
+		addShape({ SHAPE_POLYGON, static_cast<int>(finishedPolygons.size()) - 1 });
+	}
+	journal.endStep();
 }
 
 const std::vector<FilledPolygon>& PolyBuilder::getFilledPolygons() const
@@ -1085,23 +1412,69 @@ const std::vector<FilledPolygon>& PolyBuilder::getFilledPolygons() const
 void PolyBuilder::addFinishedPolygon(const Polygon& polygon)
 {
 	finishedPolygons.push_back(polygon);
+	addShape({ SHAPE_POLYGON, static_cast<int>(finishedPolygons.size()) - 1 });
+}
+
+void PolyBuilder::addFinishedPolygon(Polygon&& polygon)
+{
+	finishedPolygons.push_back(std::move(polygon));
+	addShape({ SHAPE_POLYGON, static_cast<int>(finishedPolygons.size()) - 1 });
+}
+
+void PolyBuilder::addFinishedBezier(Bezier&& bezier)
+{
+	finishedBeziers.push_back(std::move(bezier));
+	addShape({ SHAPE_BEZIER, static_cast<int>(finishedBeziers.size()) - 1 });
+}
+
+void PolyBuilder::addFinishedSequence(CubicBezierSequence&& sequence)
+{
+	finishedSequences.push_back(std::move(sequence));
+	addShape({ SHAPE_BEZIER_SEQUENCE, static_cast<int>(finishedSequences.size()) - 1 });
+}
+
+void PolyBuilder::clearScene()
+{
+	cancel();
+	isCurrentlyTransformingShape = false;
+	transformShapeIndex = -1;
+	transformMatrix = Matrix3x3();
+
+	finishedPolygons.clear();
+	finishedBeziers.clear();
+	finishedSequences.clear();
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+		noteSceneChange(SceneChange::CLEARED, { static_cast<ShapeType>(type), 0 });
+	clearFilledPolygons();
+
+	journal.clear();
+	foundIntersectionsText.clear();
+	intersections.clear();
+}
+
+void PolyBuilder::reserveShapes(size_t polygons, size_t beziers, size_t sequences)
+{
+	finishedPolygons.reserve(polygons);
+	finishedBeziers.reserve(beziers);
+	finishedSequences.reserve(sequences);
 }
 
 void PolyBuilder::removeFinishedPolygon(int index)
 {
 	if (index >= 0 && index < finishedPolygons.size())
-		finishedPolygons.erase(finishedPolygons.begin() + index);
+		removeShape({ SHAPE_POLYGON, index });
 }
 
 void PolyBuilder::removeAllPolygonsOfType(PolyType type)
 {
-	auto it = finishedPolygons.begin();
-	while (it != finishedPolygons.end()) {
-		if (it->type == type)
-			it = finishedPolygons.erase(it);
-		else
-			++it;
+	// From the end, so the indices of the ones left to check don't move
+	journal.beginStep("Remove polygons");
+	for (int i = static_cast<int>(finishedPolygons.size()) - 1; i >= 0; i--)
+	{
+		if (finishedPolygons[i].type == type)
+			removeShape({ SHAPE_POLYGON, i });
 	}
+	journal.endStep();
 }
 
 Polygon& PolyBuilder::getPolygonAt(size_t index)
@@ -1131,14 +1504,13 @@ std::vector<Vertex> PolyBuilder::findBezierIntersections(const Bezier& curve1, c
 		[&](const Bezier& c1, const Bezier& c2, int depth) {
 
 		// Generate convex hulls for both curves
-		Bezier c1Copy = c1;
-		Bezier c2Copy = c2;
-		c1Copy.generateConvexHull();
-		c2Copy.generateConvexHull();
+		// (straight from the control points, copying the curves just for that was most of the cost here)
+		std::vector<Vertex> hull1 = monotoneChainHull(c1.getControlPoints());
+		std::vector<Vertex> hull2 = monotoneChainHull(c2.getControlPoints());
 
 		// Check if convex hulls intersect
 		// This would use your SAT implementation
-		bool hullsIntersect = testHullIntersection(c1Copy.getConvexHull(), c2Copy.getConvexHull());
+		bool hullsIntersect = testHullIntersection(hull1, hull2);
 
 		if (!hullsIntersect) {
 			// No intersection, early exit
@@ -1217,6 +1589,100 @@ Polygon PolyBuilder::createPolygonFromBezierSequence(const CubicBezierSequence&
 		poly.reverseOrientation();
 
 	poly.type = PolyType::BEZIER_CURVE;
-	poly.updateBuffers();
 	return poly;
-}
\ No newline at end of file
+}
+
+void PolyBuilder::revertCommand(JournalCommand& command)
+{
+	switch (command.kind)
+	{
+	case JournalCommand::MOVE_VERTEX:
+	{
+		std::vector<Vertex> points;
+		gatherShapePoints(command.shape, points);
+		points[command.vertexIndex] = command.from;
+		setShapePoints(command.shape, points);
+		break;
+	}
+	case JournalCommand::APPLY_MATRIX:
+		applyAffineToShape(command.shape, command.matrix.inverse());
+		break;
+	case JournalCommand::SET_POINTS:
+		setShapePoints(command.shape, command.before);
+		break;
+	case JournalCommand::SET_CURVES:
+		finishedSequences[command.shape.index].setCurvesControlPoints(command.curveIndices, command.before);
+		noteCurvesChanged(command.shape, command.curveIndices);
+		break;
+	case JournalCommand::ADD_SHAPE:
+		command.storedShape = takeShape(command.shape);
+		break;
+	case JournalCommand::REMOVE_SHAPE:
+		putShape(command.shape, std::move(command.storedShape));
+		break;
+	}
+}
+
+void PolyBuilder::replayCommand(JournalCommand& command)
+{
+	switch (command.kind)
+	{
+	case JournalCommand::MOVE_VERTEX:
+	{
+		std::vector<Vertex> points;
+		gatherShapePoints(command.shape, points);
+		points[command.vertexIndex] = command.to;
+		setShapePoints(command.shape, points);
+		break;
+	}
+	case JournalCommand::APPLY_MATRIX:
+		applyAffineToShape(command.shape, command.matrix);
+		break;
+	case JournalCommand::SET_POINTS:
+		setShapePoints(command.shape, command.after);
+		break;
+	case JournalCommand::SET_CURVES:
+		finishedSequences[command.shape.index].setCurvesControlPoints(command.curveIndices, command.after);
+		noteCurvesChanged(command.shape, command.curveIndices);
+		break;
+	case JournalCommand::ADD_SHAPE:
+		putShape(command.shape, std::move(command.storedShape));
+		break;
+	case JournalCommand::REMOVE_SHAPE:
+		command.storedShape = takeShape(command.shape);
+		break;
+	}
+}
+
+bool PolyBuilder::undo()
+{
+	// Not while something is being built or dragged, the journal's indices wouldn't match anymore
+	if (buildingShape || isCurrentlyTransformingShape || journal.isStepOpen() || !journal.canUndo())
+		return false;
+
+	JournalStep step = journal.takeUndo();
+	for (auto command = step.commands.rbegin(); command != step.commands.rend(); ++command)
+		revertCommand(*command);
+	std::cout << "Undo : " << step.name << std::endl;
+	journal.pushRedo(std::move(step));
+
+	foundIntersectionsText.clear();
+	intersections.clear();
+	return true;
+}
+
+bool PolyBuilder::redo()
+{
+	if (buildingShape || isCurrentlyTransformingShape || journal.isStepOpen() || !journal.canRedo())
+		return false;
+
+	JournalStep step = journal.takeRedo();
+	for (auto& command : step.commands)
+		replayCommand(command);
+	std::cout << "Redo : " << step.name << std::endl;
+	journal.pushUndoAfterRedo(std::move(step));
+
+	foundIntersectionsText.clear();
+	intersections.clear();
+	return true;
+}
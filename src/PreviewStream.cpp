@@ -0,0 +1,134 @@
+#include "PreviewStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+void PreviewStream::add(GLenum mode, const std::vector<Vertex>& points, float r, float g, float b, float a)
+{
+	if (points.empty())
+		return;
+
+	commands.push_back({ mode, queuedPoints.size(), points.size(), r, g, b, a });
+	queuedPoints.insert(queuedPoints.end(), points.begin(), points.end());
+}
+
+void PreviewStream::addPolygon(const Polygon& polygon)
+{
+	add(GL_LINE_LOOP, polygon.getVertices(), 1.0f, 0.0f, 1.0f, 0.5f);
+	add(GL_POINTS, polygon.getVertices(), 1.0f, 1.0f, 1.0f, 0.5f);
+}
+
+void PreviewStream::addBezier(const Bezier& bezier)
+{
+	add(GL_LINE_STRIP, bezier.getControlPoints(), 1.0f, 1.0f, 0.0f, 0.5f);
+	add(GL_POINTS, bezier.getControlPoints(), 1.0f, 1.0f, 1.0f, 1.0f);
+	if (bezier.getControlPoints().size() > 2)
+		add(GL_LINE_STRIP, bezier.getGeneratedCurve(), 0.0f, 1.0f, 1.0f, 1.0f);
+}
+
+void PreviewStream::addSequence(const CubicBezierSequence& sequence)
+{
+	const auto& curves = sequence.getCurves();
+	if (curves.empty())
+		return;
+
+	// Each curve starts where the previous one ends, so the control polygon and the curve
+	// are both a single strip (the repeated junction points just make empty segments)
+	std::vector<Vertex> controlPoints, generatedPoints;
+	controlPoints.reserve(curves.size() * 4);
+	for (const auto& curve : curves)
+	{
+		controlPoints.insert(controlPoints.end(), curve.getControlPoints().begin(), curve.getControlPoints().end());
+		generatedPoints.insert(generatedPoints.end(), curve.getGeneratedCurve().begin(), curve.getGeneratedCurve().end());
+	}
+
+	add(GL_LINE_STRIP, controlPoints, 1.0f, 1.0f, 0.0f, 0.5f);
+	add(GL_POINTS, controlPoints, 1.0f, 1.0f, 1.0f, 1.0f);
+	add(GL_LINE_STRIP, generatedPoints, 0.0f, 1.0f, 1.0f, 1.0f);
+}
+
+void PreviewStream::deleteFences()
+{
+	for (GLsync& fence : fences)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+}
+
+void PreviewStream::reserve(size_t count)
+{
+	if (!vao.isCreated())
+	{
+		vao.create();
+		vbo.create();
+
+		glBindVertexArray(vao.get());
+		glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	if (count <= sectionSize)
+		return;
+
+	// New storage (orphaning the old one, the driver frees it when the GPU is done with it),
+	// so the old fences don't protect anything anymore
+	sectionSize = std::max<size_t>(1024, std::max(count, sectionSize * 2));
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+	glBufferData(GL_ARRAY_BUFFER, sectionSize * sectionCount * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+	deleteFences();
+	currentSection = 0;
+}
+
+void PreviewStream::flush(Shader& shader)
+{
+	if (commands.empty())
+		return;
+
+	reserve(queuedPoints.size());
+
+	// Only waits if the GPU is still drawing the frame from sectionCount frames ago
+	GLsync& fence = fences[currentSection];
+	if (fence)
+	{
+		glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1 second, in nanoseconds
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	size_t sectionStart = currentSection * sectionSize;
+	size_t byteCount = queuedPoints.size() * sizeof(Vertex);
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+	void* destination = glMapBufferRange(GL_ARRAY_BUFFER, sectionStart * sizeof(Vertex), byteCount,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+	if (destination)
+	{
+		std::memcpy(destination, queuedPoints.data(), byteCount);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+	}
+	else // Mapping failed, still get the points there
+		glBufferSubData(GL_ARRAY_BUFFER, sectionStart * sizeof(Vertex), byteCount, queuedPoints.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	shader.use();
+	int colorLocation = shader.getUniformLocation("uColor");
+	glBindVertexArray(vao.get());
+	for (const DrawCommand& command : commands)
+	{
+		shader.setColor(colorLocation, command.r, command.g, command.b, command.a);
+		glDrawArrays(command.mode, static_cast<GLint>(sectionStart + command.first), static_cast<GLsizei>(command.count));
+	}
+	glBindVertexArray(0);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	currentSection = (currentSection + 1) % sectionCount;
+
+	queuedPoints.clear();
+	commands.clear();
+}
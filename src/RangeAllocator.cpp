@@ -0,0 +1,70 @@
+#include "RangeAllocator.h"
+
+#include <algorithm>
+
+size_t RangeAllocator::allocate(size_t count)
+{
+    if (count == 0)
+        return 0;
+
+    for (size_t i = 0; i < freeBlocks.size(); i++)
+    {
+        Block& block = freeBlocks[i];
+        if (block.count < count)
+            continue;
+
+        size_t offset = block.offset;
+        block.offset += count;
+        block.count -= count;
+        if (block.count == 0)
+            freeBlocks.erase(freeBlocks.begin() + i);
+        return offset;
+    }
+
+    // Nothing fits. release() never leaves a free block at the end, so the new range starts at the end
+    size_t offset = end;
+    end += count;
+    return offset;
+}
+
+void RangeAllocator::release(size_t offset, size_t count)
+{
+    if (count == 0)
+        return;
+
+    auto next = std::lower_bound(freeBlocks.begin(), freeBlocks.end(), offset,
+        [](const Block& block, size_t value) { return block.offset < value; });
+    auto inserted = freeBlocks.insert(next, { offset, count });
+
+    // Merge with the following block, then with the previous one
+    auto after = inserted + 1;
+    if (after != freeBlocks.end() && inserted->offset + inserted->count == after->offset)
+    {
+        inserted->count += after->count;
+        freeBlocks.erase(after);
+    }
+    if (inserted != freeBlocks.begin())
+    {
+        auto before = inserted - 1;
+        if (before->offset + before->count == inserted->offset)
+        {
+            before->count += inserted->count;
+            inserted = freeBlocks.erase(inserted) - 1;
+        }
+    }
+
+    // Free space at the end is just given back
+    if (inserted->offset + inserted->count == end)
+    {
+        end = inserted->offset;
+        freeBlocks.erase(inserted);
+    }
+}
+
+size_t RangeAllocator::freeCount() const
+{
+    size_t count = 0;
+    for (const Block& block : freeBlocks)
+        count += block.count;
+    return count;
+}
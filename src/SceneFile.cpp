@@ -0,0 +1,424 @@
+#include "SceneFile.h"
+#include "PolyBuilder.h"
+#include "Filler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Read only view of a whole file. The OS pages it in as the loader reads it
+    class MappedFile
+    {
+    private:
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+#if defined(_WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int descriptor = -1;
+#endif
+
+    public:
+        MappedFile() {};
+        ~MappedFile() { close(); };
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const std::string& path)
+        {
+#if defined(_WIN32)
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return false;
+
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+                return false;
+            size = static_cast<size_t>(fileSize.QuadPart);
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (!mapping)
+                return false;
+            data = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            return data != nullptr;
+#else
+            descriptor = ::open(path.c_str(), O_RDONLY);
+            if (descriptor < 0)
+                return false;
+
+            struct stat fileStatus;
+            if (fstat(descriptor, &fileStatus) != 0 || fileStatus.st_size == 0)
+                return false;
+            size = static_cast<size_t>(fileStatus.st_size);
+
+            void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (mapped == MAP_FAILED)
+                return false;
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = static_cast<const unsigned char*>(mapped);
+            return true;
+#endif
+        }
+
+        void close()
+        {
+#if defined(_WIN32)
+            if (data)
+                UnmapViewOfFile(data);
+            if (mapping)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+            mapping = nullptr;
+            file = INVALID_HANDLE_VALUE;
+#else
+            if (data)
+                munmap(const_cast<unsigned char*>(data), size);
+            if (descriptor >= 0)
+                ::close(descriptor);
+            descriptor = -1;
+#endif
+            data = nullptr;
+            size = 0;
+        }
+
+        const unsigned char* getData() const { return data; };
+        size_t getSize() const { return size; };
+    };
+
+    // Records with firstVertex filled in, in the order the vertices will be written
+    void buildShapeTable(const PolyBuilder& polybuilder, std::vector<SceneFile::SceneShapeRecord>& records, uint64_t& vertexCount)
+    {
+        vertexCount = 0;
+        auto addRecord = [&](uint32_t kind, uint64_t count) -> SceneFile::SceneShapeRecord&
+        {
+            SceneFile::SceneShapeRecord record = {};
+            record.kind = kind;
+            record.firstVertex = vertexCount;
+            record.vertexCount = count;
+            vertexCount += count;
+            records.push_back(record);
+            return records.back();
+        };
+
+        for (const Polygon& polygon : polybuilder.getFinishedPolygons())
+        {
+            SceneFile::SceneShapeRecord& record = addRecord(SceneFile::SCENE_POLYGON, polygon.getVertices().size());
+            record.polyType = polygon.type;
+        }
+
+        for (const Bezier& bezier : polybuilder.getFinishedBeziers())
+        {
+            SceneFile::SceneShapeRecord& record = addRecord(SceneFile::SCENE_BEZIER, bezier.getControlPoints().size());
+            record.algorithm = bezier.getAlgorithm();
+            record.stepSize = bezier.getStepSize();
+            record.flags = bezier.getShowConvexHull() ? static_cast<uint32_t>(SceneFile::SCENE_FLAG_SHOW_HULL) : static_cast<uint32_t>(0);
+        }
+
+        for (const CubicBezierSequence& sequence : polybuilder.getFinishedBezierSequences())
+        {
+            SceneFile::SceneShapeRecord& record = addRecord(SceneFile::SCENE_SEQUENCE, sequence.getCurves().size() * 4);
+            record.continuityType = sequence.getContinuityType();
+            record.algorithm = sequence.getAlgorithm();
+            record.stepSize = sequence.getStepSize();
+            record.flags = sequence.getIsClosed() ? static_cast<uint32_t>(SceneFile::SCENE_FLAG_CLOSED) : static_cast<uint32_t>(0);
+        }
+
+        for (const FilledPolygon& filled : polybuilder.getFilledPolygons())
+        {
+            bool hasCoverage = !filled.coverage.empty();
+            SceneFile::SceneShapeRecord& record = addRecord(SceneFile::SCENE_FILLED_POLYGON,
+                filled.polygon.getVertices().size() + filled.fillPoints.size() +
+                (hasCoverage ? SceneFile::coverageSlots(filled.fillPoints.size()) : 0));
+            record.vertexCount = filled.polygon.getVertices().size();
+            record.fillCount = filled.fillPoints.size();
+            record.flags = hasCoverage ? static_cast<uint32_t>(SceneFile::SCENE_FLAG_COVERAGE) : static_cast<uint32_t>(0);
+            record.polyType = filled.polygon.type;
+            record.color[0] = filled.colorR;
+            record.color[1] = filled.colorG;
+            record.color[2] = filled.colorB;
+            record.color[3] = filled.colorA;
+        }
+    }
+
+    void writeVertices(std::ofstream& out, const std::vector<Vertex>& vertices)
+    {
+        if (!vertices.empty())
+            out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(Vertex));
+    }
+
+    // Zero padded to whole vertices, see SceneFile::coverageSlots
+    void writeCoverage(std::ofstream& out, const std::vector<uint8_t>& coverage)
+    {
+        if (coverage.empty())
+            return;
+        out.write(reinterpret_cast<const char*>(coverage.data()), coverage.size());
+        const char padding[sizeof(Vertex)] = {};
+        out.write(padding, SceneFile::coverageSlots(coverage.size()) * sizeof(Vertex) - coverage.size());
+    }
+
+    void writeJsonPoints(std::ofstream& out, const std::vector<Vertex>& points)
+    {
+        out << "[";
+        for (size_t i = 0; i < points.size(); i++)
+            out << (i ? ", " : "") << "[" << points[i].x << ", " << points[i].y << "]";
+        out << "]";
+    }
+
+    const char* polyTypeName(PolyType type)
+    {
+        switch (type)
+        {
+        case POLYGON: return "POLYGON";
+        case WINDOW: return "WINDOW";
+        case CLIPPED_CYRUS_BECK: return "CLIPPED_CYRUS_BECK";
+        case CLIPPED_SUTHERLAND_HODGMAN: return "CLIPPED_SUTHERLAND_HODGMAN";
+        case BEZIER_CURVE: return "BEZIER_CURVE";
+        case CONVEX_HULL: return "CONVEX_HULL";
+        }
+        return "UNKNOWN";
+    }
+}
+
+namespace SceneFile
+{
+    bool save(const PolyBuilder& polybuilder, const std::string& path)
+    {
+        std::vector<SceneShapeRecord> records;
+        uint64_t vertexCount = 0;
+        buildShapeTable(polybuilder, records, vertexCount);
+
+        SceneFileHeader header = {};
+        std::memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+        header.version = currentVersion;
+        header.byteOrder = byteOrderMark;
+        header.shapeCount = static_cast<uint32_t>(records.size());
+        header.shapeTableOffset = sizeof(SceneFileHeader);
+        header.vertexOffset = header.shapeTableOffset + records.size() * sizeof(SceneShapeRecord);
+        header.vertexCount = vertexCount;
+        header.fillAlgorithm = Filler::getSelectedAlgorithm();
+        Filler::getFillColor(header.fillColor[0], header.fillColor[1], header.fillColor[2], header.fillColor[3]);
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Error: Can't write scene file " << path << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!records.empty())
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(SceneShapeRecord));
+
+        // Straight from the shapes, in the same order as the table
+        for (const Polygon& polygon : polybuilder.getFinishedPolygons())
+            writeVertices(out, polygon.getVertices());
+        for (const Bezier& bezier : polybuilder.getFinishedBeziers())
+            writeVertices(out, bezier.getControlPoints());
+        for (const CubicBezierSequence& sequence : polybuilder.getFinishedBezierSequences())
+            for (const Bezier& curve : sequence.getCurves())
+                writeVertices(out, curve.getControlPoints());
+        for (const FilledPolygon& filled : polybuilder.getFilledPolygons())
+        {
+            writeVertices(out, filled.polygon.getVertices());
+            writeVertices(out, filled.fillPoints);
+            writeCoverage(out, filled.coverage);
+        }
+
+        if (!out)
+        {
+            std::cerr << "Error: Writing scene file " << path << " failed" << std::endl;
+            return false;
+        }
+
+        std::cout << "Saved " << records.size() << " shapes (" << vertexCount << " vertices) to " << path << std::endl;
+        return true;
+    }
+
+    bool load(PolyBuilder& polybuilder, const std::string& path)
+    {
+        MappedFile file;
+        if (!file.open(path))
+        {
+            std::cerr << "Error: Can't open scene file " << path << std::endl;
+            return false;
+        }
+
+        // Everything is checked before the current scene is touched
+        const unsigned char* data = file.getData();
+        if (!validate(data, file.getSize(), path))
+            return false;
+
+        SceneFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+
+        // The mapping is page aligned and the offsets are checked, so both blocks can be used in place
+        const SceneShapeRecord* records = reinterpret_cast<const SceneShapeRecord*>(data + header.shapeTableOffset);
+        const Vertex* vertices = reinterpret_cast<const Vertex*>(data + header.vertexOffset);
+
+        size_t counts[4] = {};
+        for (uint32_t i = 0; i < header.shapeCount; i++)
+            counts[records[i].kind]++;
+
+        polybuilder.clearScene();
+        polybuilder.reserveShapes(counts[SCENE_POLYGON], counts[SCENE_BEZIER], counts[SCENE_SEQUENCE]);
+        Filler::setSelectedAlgorithm(header.fillAlgorithm);
+        Filler::setFillColor(header.fillColor[0], header.fillColor[1], header.fillColor[2], header.fillColor[3]);
+
+        for (uint32_t i = 0; i < header.shapeCount; i++)
+        {
+            const SceneShapeRecord& record = records[i];
+            const Vertex* first = vertices + record.firstVertex;
+            const Vertex* last = first + record.vertexCount;
+
+            switch (record.kind)
+            {
+            case SCENE_POLYGON:
+            {
+                Polygon polygon;
+                polygon.type = static_cast<PolyType>(record.polyType);
+                polygon.setVertices(std::vector<Vertex>(first, last));
+                polybuilder.addFinishedPolygon(std::move(polygon));
+                break;
+            }
+            case SCENE_BEZIER:
+            {
+                Bezier bezier;
+                bezier.setControlPoints(std::vector<Vertex>(first, last));
+                bezier.setStepSize(clampStepSize(record.stepSize));
+                bezier.setAlgorithm(record.algorithm);
+                if (record.flags & SCENE_FLAG_SHOW_HULL)
+                    bezier.toggleConvexHullDisplay();
+                bezier.generateCurve();
+                polybuilder.addFinishedBezier(std::move(bezier));
+                break;
+            }
+            case SCENE_SEQUENCE:
+            {
+                CubicBezierSequence sequence(record.continuityType, clampStepSize(record.stepSize), record.algorithm);
+                // The saved points already satisfy the constraints, so they're taken as they are
+                // and every curve is generated once, on the worker pool
+                sequence.loadControlPoints(first, last, (record.flags & SCENE_FLAG_CLOSED) != 0);
+                sequence.regenerateCurves();
+                polybuilder.addFinishedSequence(std::move(sequence));
+                break;
+            }
+            case SCENE_FILLED_POLYGON:
+            {
+                Polygon polygon;
+                polygon.type = static_cast<PolyType>(record.polyType);
+                polygon.setVertices(std::vector<Vertex>(first, last));
+                std::vector<uint8_t> coverage;
+                if (record.flags & SCENE_FLAG_COVERAGE)
+                {
+                    const uint8_t* coverageBytes = reinterpret_cast<const uint8_t*>(last + record.fillCount);
+                    coverage.assign(coverageBytes, coverageBytes + record.fillCount);
+                }
+                polybuilder.addFilledPolygon(polygon, std::vector<Vertex>(last, last + record.fillCount),
+                    record.color[0], record.color[1], record.color[2], record.color[3], coverage);
+                break;
+            }
+            }
+        }
+
+        // Loading isn't something to undo shape by shape
+        polybuilder.clearHistory();
+
+        std::cout << "Loaded " << header.shapeCount << " shapes (" << header.vertexCount << " vertices) from " << path << std::endl;
+        return true;
+    }
+
+    bool exportJson(const PolyBuilder& polybuilder, const std::string& path)
+    {
+        std::ofstream out(path, std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Error: Can't write " << path << std::endl;
+            return false;
+        }
+
+        float r, g, b, a;
+        Filler::getFillColor(r, g, b, a);
+        out << "{\n  \"version\": " << currentVersion << ",\n";
+        out << "  \"fill\": { \"algorithm\": " << Filler::getSelectedAlgorithm()
+            << ", \"color\": [" << r << ", " << g << ", " << b << ", " << a << "] },\n";
+
+        out << "  \"polygons\": [";
+        const auto& polygons = polybuilder.getFinishedPolygons();
+        for (size_t i = 0; i < polygons.size(); i++)
+        {
+            out << (i ? ",\n" : "\n") << "    { \"type\": \"" << polyTypeName(polygons[i].type) << "\", \"vertices\": ";
+            writeJsonPoints(out, polygons[i].getVertices());
+            out << " }";
+        }
+        out << "\n  ],\n";
+
+        out << "  \"beziers\": [";
+        const auto& beziers = polybuilder.getFinishedBeziers();
+        for (size_t i = 0; i < beziers.size(); i++)
+        {
+            out << (i ? ",\n" : "\n") << "    { \"algorithm\": " << beziers[i].getAlgorithm()
+                << ", \"stepSize\": " << beziers[i].getStepSize()
+                << ", \"showHull\": " << (beziers[i].getShowConvexHull() ? "true" : "false")
+                << ", \"controlPoints\": ";
+            writeJsonPoints(out, beziers[i].getControlPoints());
+            out << " }";
+        }
+        out << "\n  ],\n";
+
+        out << "  \"sequences\": [";
+        const auto& sequences = polybuilder.getFinishedBezierSequences();
+        for (size_t i = 0; i < sequences.size(); i++)
+        {
+            out << (i ? ",\n" : "\n") << "    { \"continuity\": " << sequences[i].getContinuityType()
+                << ", \"closed\": " << (sequences[i].getIsClosed() ? "true" : "false")
+                << ", \"algorithm\": " << sequences[i].getAlgorithm()
+                << ", \"stepSize\": " << sequences[i].getStepSize() << ", \"curves\": [";
+            const auto& curves = sequences[i].getCurves();
+            for (size_t c = 0; c < curves.size(); c++)
+            {
+                out << (c ? ", " : "");
+                writeJsonPoints(out, curves[c].getControlPoints());
+            }
+            out << "] }";
+        }
+        out << "\n  ],\n";
+
+        out << "  \"fills\": [";
+        const auto& fills = polybuilder.getFilledPolygons();
+        for (size_t i = 0; i < fills.size(); i++)
+        {
+            out << (i ? ",\n" : "\n") << "    { \"color\": [" << fills[i].colorR << ", " << fills[i].colorG << ", "
+                << fills[i].colorB << ", " << fills[i].colorA << "], \"fillPointCount\": " << fills[i].fillPoints.size()
+                << ", \"antialiased\": " << (fills[i].coverage.empty() ? "false" : "true") << ", \"vertices\": ";
+            writeJsonPoints(out, fills[i].polygon.getVertices());
+            out << " }";
+        }
+        out << "\n  ]\n}\n";
+
+        if (!out)
+        {
+            std::cerr << "Error: Writing " << path << " failed" << std::endl;
+            return false;
+        }
+        std::cout << "Exported the scene to " << path << std::endl;
+        return true;
+    }
+}
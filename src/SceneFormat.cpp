@@ -0,0 +1,146 @@
+#include "SceneFile.h"
+#include "CommonTypes.h"
+#include "Filler.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace SceneFile
+{
+    bool validate(const unsigned char* data, size_t size, const std::string& path)
+    {
+        if (size < sizeof(SceneFileHeader))
+        {
+            std::cerr << "Error: " << path << " is too small to be a scene file" << std::endl;
+            return false;
+        }
+
+        SceneFileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, sceneMagic, sizeof(sceneMagic)) != 0 || header.byteOrder != byteOrderMark)
+        {
+            std::cerr << "Error: " << path << " is not a scene file (or comes from a big endian machine)" << std::endl;
+            return false;
+        }
+        if (header.version != currentVersion)
+        {
+            std::cerr << "Error: " << path << " is version " << header.version << ", only version "
+                << currentVersion << " can be read" << std::endl;
+            return false;
+        }
+
+        // Divisions rather than multiplications, so huge counts can't overflow past the checks
+        if (header.shapeTableOffset > size || header.vertexOffset > size ||
+            (size - header.shapeTableOffset) / sizeof(SceneShapeRecord) < header.shapeCount ||
+            (size - header.vertexOffset) / sizeof(Vertex) < header.vertexCount ||
+            header.shapeTableOffset % alignof(SceneShapeRecord) != 0 || header.vertexOffset % alignof(Vertex) != 0)
+        {
+            std::cerr << "Error: " << path << " is truncated or corrupted" << std::endl;
+            return false;
+        }
+
+        if (header.fillAlgorithm < Filler::FILL_SCANLINE || header.fillAlgorithm > Filler::FILL_COVERAGE)
+        {
+            std::cerr << "Error: " << path << " has an unknown fill algorithm (" << header.fillAlgorithm << ")" << std::endl;
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.shapeCount; i++)
+        {
+            SceneShapeRecord record;
+            std::memcpy(&record, data + header.shapeTableOffset + i * sizeof(SceneShapeRecord), sizeof(record));
+            uint64_t total = recordSize(record);
+            if (record.kind > SCENE_FILLED_POLYGON || total < record.vertexCount || record.fillCount > total ||
+                record.firstVertex > header.vertexCount || header.vertexCount - record.firstVertex < total ||
+                (record.kind == SCENE_SEQUENCE && record.vertexCount % 4 != 0))
+            {
+                std::cerr << "Error: Shape " << i << " of " << path << " is corrupted" << std::endl;
+                return false;
+            }
+
+            // Only the fields the kind uses, the others are zero when we write them but nobody reads them
+            bool isPolygon = record.kind == SCENE_POLYGON || record.kind == SCENE_FILLED_POLYGON;
+            bool isCurve = record.kind == SCENE_BEZIER || record.kind == SCENE_SEQUENCE;
+            if ((isPolygon && record.polyType > CONVEX_HULL) ||
+                (isCurve && (record.algorithm < 0 || record.algorithm > 1)) ||
+                (record.kind == SCENE_SEQUENCE && (record.continuityType < 0 || record.continuityType > 3)))
+            {
+                std::cerr << "Error: Shape " << i << " of " << path << " has an unknown type or algorithm" << std::endl;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool read(const std::string& path, SceneContents& contents)
+    {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            std::cerr << "Error: Can't open scene file " << path << std::endl;
+            return false;
+        }
+
+        std::vector<unsigned char> data(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())))
+        {
+            std::cerr << "Error: Reading scene file " << path << " failed" << std::endl;
+            return false;
+        }
+
+        if (!validate(data.data(), data.size(), path))
+            return false;
+
+        SceneFileHeader header;
+        std::memcpy(&header, data.data(), sizeof(header));
+        contents.fillAlgorithm = header.fillAlgorithm;
+        std::memcpy(contents.fillColor, header.fillColor, sizeof(contents.fillColor));
+
+        contents.shapes.resize(header.shapeCount);
+        contents.vertices.resize(header.vertexCount);
+        if (header.shapeCount > 0)
+            std::memcpy(contents.shapes.data(), data.data() + header.shapeTableOffset, header.shapeCount * sizeof(SceneShapeRecord));
+        for (SceneShapeRecord& record : contents.shapes)
+            record.stepSize = clampStepSize(record.stepSize);
+        if (header.vertexCount > 0)
+            std::memcpy(contents.vertices.data(), data.data() + header.vertexOffset, header.vertexCount * sizeof(Vertex));
+        return true;
+    }
+
+    bool write(const SceneContents& contents, const std::string& path)
+    {
+        SceneFileHeader header = {};
+        std::memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+        header.version = currentVersion;
+        header.byteOrder = byteOrderMark;
+        header.shapeCount = static_cast<uint32_t>(contents.shapes.size());
+        header.shapeTableOffset = sizeof(SceneFileHeader);
+        header.vertexOffset = header.shapeTableOffset + contents.shapes.size() * sizeof(SceneShapeRecord);
+        header.vertexCount = contents.vertices.size();
+        header.fillAlgorithm = contents.fillAlgorithm;
+        std::memcpy(header.fillColor, contents.fillColor, sizeof(header.fillColor));
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            std::cerr << "Error: Can't write scene file " << path << std::endl;
+            return false;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!contents.shapes.empty())
+            out.write(reinterpret_cast<const char*>(contents.shapes.data()), contents.shapes.size() * sizeof(SceneShapeRecord));
+        if (!contents.vertices.empty())
+            out.write(reinterpret_cast<const char*>(contents.vertices.data()), contents.vertices.size() * sizeof(Vertex));
+
+        if (!out)
+        {
+            std::cerr << "Error: Writing scene file " << path << " failed" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,437 @@
+#include "SceneRenderer.h"
+#include "PolyBuilder.h"
+
+#include <algorithm>
+#include <iostream>
+#include <tuple>
+
+void SceneRenderer::applyChanges(PolyBuilder& polybuilder)
+{
+	for (const SceneChange& change : polybuilder.getSceneChanges())
+	{
+		std::vector<Slot>& typeSlots = slots[change.shape.type];
+		int index = change.shape.index;
+		switch (change.kind)
+		{
+		case SceneChange::INSERTED:
+			if (index >= 0 && index <= static_cast<int>(typeSlots.size()))
+				typeSlots.emplace(typeSlots.begin() + index);
+			batchesDirty = true;
+			break;
+		case SceneChange::UPDATED:
+			if (index >= 0 && index < static_cast<int>(typeSlots.size()))
+			{
+				Slot& slot = typeSlots[index];
+				if (change.curveCount <= 0 || change.shape.type != SHAPE_BEZIER_SEQUENCE)
+					slot.dirty = true;
+				else if (!slot.dirty) // Otherwise those curves go up with the rest anyway
+					slot.dirtyCurves.push_back({ static_cast<size_t>(change.firstCurve), static_cast<size_t>(change.curveCount) });
+			}
+			break;
+		case SceneChange::REMOVED:
+			if (index >= 0 && index < static_cast<int>(typeSlots.size()))
+			{
+				ranges.release(typeSlots[index].offset, typeSlots[index].capacity);
+				typeSlots.erase(typeSlots.begin() + index);
+			}
+			batchesDirty = true;
+			break;
+		case SceneChange::CLEARED:
+			for (const Slot& slot : typeSlots)
+				ranges.release(slot.offset, slot.capacity);
+			typeSlots.clear();
+			batchesDirty = true;
+			break;
+		case SceneChange::MODEL_MATRIX:
+			batchesDirty = true;
+			break;
+		}
+	}
+	polybuilder.clearSceneChanges();
+
+	// Shouldn't happen, but a change that wasn't reported would leave the slots out of step
+	// with the shapes, so that type is just uploaded again from scratch
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+	{
+		size_t shapeCount = polybuilder.getShapeCount(static_cast<ShapeType>(type));
+		if (slots[type].size() == shapeCount)
+			continue;
+
+		std::cerr << "SceneRenderer : shapes of type " << type << " changed without being reported, re-uploading them" << std::endl;
+		for (const Slot& slot : slots[type])
+			ranges.release(slot.offset, slot.capacity);
+		slots[type].assign(shapeCount, Slot());
+		batchesDirty = true;
+	}
+}
+
+void SceneRenderer::measure(const PolyBuilder& polybuilder, ShapeRef shape, Slot& slot)
+{
+	slot.parts[0] = slot.parts[1] = slot.parts[2] = 0;
+	slot.showHull = false;
+	switch (shape.type)
+	{
+	case SHAPE_POLYGON:
+		slot.parts[0] = polybuilder.getFinishedPolygons()[shape.index].getVertices().size();
+		break;
+	case SHAPE_BEZIER:
+	{
+		const Bezier& bezier = polybuilder.getFinishedBeziers()[shape.index];
+		slot.parts[0] = bezier.getControlPoints().size();
+		slot.parts[1] = bezier.getGeneratedCurve().size();
+		slot.parts[2] = bezier.getConvexHull().size();
+		slot.showHull = bezier.getShowConvexHull();
+		break;
+	}
+	case SHAPE_BEZIER_SEQUENCE:
+		slot.curveStarts.clear();
+		for (const Bezier& curve : polybuilder.getFinishedBezierSequences()[shape.index].getCurves())
+		{
+			slot.curveStarts.push_back(slot.parts[1]);
+			slot.parts[0] += curve.getControlPoints().size();
+			slot.parts[1] += curve.getGeneratedCurve().size();
+		}
+		slot.curveStarts.push_back(slot.parts[1]);
+		break;
+	}
+}
+
+bool SceneRenderer::curvesKeptTheirSize(const PolyBuilder& polybuilder, ShapeRef shape, const Slot& slot)
+{
+	// Control points are 4 per curve, so only the generated points can have moved the layout
+	const std::vector<Bezier>& curves = polybuilder.getFinishedBezierSequences()[shape.index].getCurves();
+	if (slot.curveStarts.size() != curves.size() + 1 || slot.parts[0] != curves.size() * 4)
+		return false;
+
+	for (const auto& run : slot.dirtyCurves)
+	{
+		if (run.first + run.second > curves.size())
+			return false;
+		for (size_t i = run.first; i < run.first + run.second; i++)
+		{
+			if (curves[i].getControlPoints().size() != 4 ||
+				curves[i].getGeneratedCurve().size() != slot.curveStarts[i + 1] - slot.curveStarts[i])
+				return false;
+		}
+	}
+	return true;
+}
+
+void SceneRenderer::uploadCurves(const PolyBuilder& polybuilder, ShapeRef shape, Slot& slot)
+{
+	// Overlapping or touching runs go up together
+	std::vector<std::pair<size_t, size_t>>& runs = slot.dirtyCurves;
+	std::sort(runs.begin(), runs.end());
+	size_t merged = 0;
+	for (size_t i = 1; i < runs.size(); i++)
+	{
+		size_t end = runs[merged].first + runs[merged].second;
+		if (runs[i].first <= end)
+			runs[merged].second = std::max(end, runs[i].first + runs[i].second) - runs[merged].first;
+		else
+			runs[++merged] = runs[i];
+	}
+	runs.resize(merged + 1);
+
+	const std::vector<Bezier>& curves = polybuilder.getFinishedBezierSequences()[shape.index].getCurves();
+	for (const auto& run : runs)
+	{
+		size_t end = run.first + run.second;
+
+		uploadScratch.clear();
+		for (size_t i = run.first; i < end; i++)
+			uploadScratch.insert(uploadScratch.end(), curves[i].getControlPoints().begin(), curves[i].getControlPoints().end());
+		glBufferSubData(GL_ARRAY_BUFFER, (slot.offset + run.first * 4) * sizeof(Vertex), uploadScratch.size() * sizeof(Vertex), uploadScratch.data());
+
+		uploadScratch.clear();
+		for (size_t i = run.first; i < end; i++)
+			uploadScratch.insert(uploadScratch.end(), curves[i].getGeneratedCurve().begin(), curves[i].getGeneratedCurve().end());
+		if (!uploadScratch.empty())
+			glBufferSubData(GL_ARRAY_BUFFER, (slot.offset + slot.parts[0] + slot.curveStarts[run.first]) * sizeof(Vertex),
+				uploadScratch.size() * sizeof(Vertex), uploadScratch.data());
+	}
+	runs.clear();
+}
+
+void SceneRenderer::pack(const PolyBuilder& polybuilder, ShapeRef shape, std::vector<Vertex>& points)
+{
+	points.clear();
+	switch (shape.type)
+	{
+	case SHAPE_POLYGON:
+	{
+		const auto& vertices = polybuilder.getFinishedPolygons()[shape.index].getVertices();
+		points.insert(points.end(), vertices.begin(), vertices.end());
+		break;
+	}
+	case SHAPE_BEZIER:
+	{
+		const Bezier& bezier = polybuilder.getFinishedBeziers()[shape.index];
+		points.insert(points.end(), bezier.getControlPoints().begin(), bezier.getControlPoints().end());
+		points.insert(points.end(), bezier.getGeneratedCurve().begin(), bezier.getGeneratedCurve().end());
+		points.insert(points.end(), bezier.getConvexHull().begin(), bezier.getConvexHull().end());
+		break;
+	}
+	case SHAPE_BEZIER_SEQUENCE:
+	{
+		// Every curve's control points make one strip, and the generated curves another
+		// (the repeated junction points just make empty segments)
+		const auto& curves = polybuilder.getFinishedBezierSequences()[shape.index].getCurves();
+		for (const Bezier& curve : curves)
+			points.insert(points.end(), curve.getControlPoints().begin(), curve.getControlPoints().end());
+		for (const Bezier& curve : curves)
+			points.insert(points.end(), curve.getGeneratedCurve().begin(), curve.getGeneratedCurve().end());
+		break;
+	}
+	}
+}
+
+void SceneRenderer::upload(const PolyBuilder& polybuilder)
+{
+	if (!vao.isCreated())
+	{
+		vao.create();
+		vbo.create();
+
+		// The VAO keeps pointing to the VBO even when its storage gets reallocated
+		glBindVertexArray(vao.get());
+		glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	// Dirty shapes first get a range big enough for their points. The layout of the others doesn't move
+	bool anyDirty = false;
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+	{
+		for (size_t i = 0; i < slots[type].size(); i++)
+		{
+			Slot& slot = slots[type][i];
+			ShapeRef shape = { static_cast<ShapeType>(type), static_cast<int>(i) };
+			if (!slot.dirty && !slot.dirtyCurves.empty())
+			{
+				anyDirty = true;
+				if (!curvesKeptTheirSize(polybuilder, shape, slot))
+					slot.dirty = true;
+			}
+			if (!slot.dirty)
+				continue;
+			anyDirty = true;
+
+			Slot measured = slot;
+			measure(polybuilder, shape, measured);
+			if (!std::equal(measured.parts, measured.parts + 3, slot.parts) || measured.showHull != slot.showHull)
+				batchesDirty = true;
+
+			size_t total = measured.parts[0] + measured.parts[1] + measured.parts[2];
+			if (total > slot.capacity)
+			{
+				ranges.release(slot.offset, slot.capacity);
+				measured.offset = ranges.allocate(total);
+				measured.capacity = total;
+				batchesDirty = true;
+			}
+			slot = measured;
+		}
+	}
+	if (!anyDirty)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+	if (ranges.size() > bufferCapacity)
+	{
+		// New storage loses what the old one had, so every shape goes up again (doubling keeps that rare)
+		bufferCapacity = std::max<size_t>(4096, std::max(ranges.size(), bufferCapacity * 2));
+		glBufferData(GL_ARRAY_BUFFER, bufferCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+		for (auto& typeSlots : slots)
+			for (Slot& slot : typeSlots)
+				slot.dirty = true;
+	}
+
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+	{
+		for (size_t i = 0; i < slots[type].size(); i++)
+		{
+			Slot& slot = slots[type][i];
+			ShapeRef shape = { static_cast<ShapeType>(type), static_cast<int>(i) };
+			if (!slot.dirty)
+			{
+				if (!slot.dirtyCurves.empty())
+					uploadCurves(polybuilder, shape, slot);
+				continue;
+			}
+			slot.dirty = false;
+			slot.dirtyCurves.clear();
+
+			pack(polybuilder, shape, uploadScratch);
+			if (!uploadScratch.empty())
+				glBufferSubData(GL_ARRAY_BUFFER, slot.offset * sizeof(Vertex), uploadScratch.size() * sizeof(Vertex), uploadScratch.data());
+		}
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void SceneRenderer::addItem(int layer, const Matrix3x3* model, ShapeRef shape, GLenum mode, size_t first, size_t count, float r, float g, float b, float a)
+{
+	if (count == 0)
+		return;
+
+	items.push_back({ layer, model != nullptr, shape, mode, r, g, b, a, static_cast<GLint>(first), static_cast<GLsizei>(count) });
+}
+
+void SceneRenderer::addItems(const PolyBuilder& polybuilder, ShapeRef shape, const Slot& slot)
+{
+	const Matrix3x3* model = polybuilder.getShapeModelMatrix(shape);
+	size_t control = slot.offset;
+	size_t curve = control + slot.parts[0];
+	size_t hull = curve + slot.parts[1];
+
+	switch (shape.type)
+	{
+	case SHAPE_POLYGON:
+		switch (polybuilder.getFinishedPolygons()[shape.index].type)
+		{
+		case PolyType::POLYGON:
+			addItem(LAYER_OUTLINES, model, shape, GL_LINE_LOOP, control, slot.parts[0], 1.0f, 0.0f, 0.0f, 1.0f); // Red for regular polygons
+			break;
+		case PolyType::WINDOW:
+			addItem(LAYER_OUTLINES, model, shape, GL_LINE_LOOP, control, slot.parts[0], 0.0f, 1.0f, 0.0f, 1.0f); // Green for window polygons
+			break;
+		case PolyType::BEZIER_CURVE:
+			addItem(LAYER_OUTLINES, model, shape, GL_LINE_LOOP, control, slot.parts[0], 0.0f, 1.0f, 1.0f, 1.0f);
+			break;
+		case PolyType::CLIPPED_CYRUS_BECK:
+			addItem(LAYER_CLIPPED, model, shape, GL_LINE_LOOP, control, slot.parts[0], 0.0f, 0.0f, 1.0f, 0.7f); // Blue with 70% opacity
+			break;
+		case PolyType::CLIPPED_SUTHERLAND_HODGMAN:
+			addItem(LAYER_CLIPPED, model, shape, GL_LINE_LOOP, control, slot.parts[0], 0.8f, 0.0f, 0.8f, 0.7f); // Purple with 70% opacity
+			break;
+		default:
+			break;
+		}
+		break;
+	case SHAPE_BEZIER:
+	case SHAPE_BEZIER_SEQUENCE:
+	{
+		int layer = shape.type == SHAPE_BEZIER ? LAYER_BEZIERS : LAYER_SEQUENCES;
+		addItem(layer, model, shape, GL_LINE_STRIP, control, slot.parts[0], 1.0f, 0.0f, 0.5f, 1.0f);
+		addItem(layer, model, shape, GL_POINTS, control, slot.parts[0], 1.0f, 1.0f, 1.0f, 1.0f);
+		addItem(layer, model, shape, GL_LINE_STRIP, curve, slot.parts[1], 0.0f, 0.0f, 1.0f, 1.0f);
+		if (slot.showHull)
+		{
+			addItem(LAYER_HULLS, model, shape, GL_LINE_LOOP, hull, slot.parts[2], 0.0f, 1.0f, 0.5f, 0.25f);
+			addItem(LAYER_HULLS, model, shape, GL_POINTS, hull, slot.parts[2], 1.0f, 1.0f, 1.0f, 0.25f);
+		}
+		break;
+	}
+	}
+}
+
+void SceneRenderer::rebuildBatches(const PolyBuilder& polybuilder)
+{
+	items.clear();
+	for (int type = 0; type < SHAPE_TYPE_COUNT; type++)
+		for (size_t i = 0; i < slots[type].size(); i++)
+			addItems(polybuilder, { static_cast<ShapeType>(type), static_cast<int>(i) }, slots[type][i]);
+
+	// Same state next to each other, keeping the order shapes were added in otherwise.
+	// Only the dragged shape has a model matrix, it gets batches of its own
+	auto key = [](const DrawItem& item)
+	{
+		int modelType = item.hasModel ? item.shape.type : -1;
+		int modelIndex = item.hasModel ? item.shape.index : -1;
+		return std::make_tuple(item.layer, modelType, modelIndex, item.r, item.g, item.b, item.a, item.mode);
+	};
+	std::stable_sort(items.begin(), items.end(), [&](const DrawItem& a, const DrawItem& b) { return key(a) < key(b); });
+
+	batches.clear();
+	batchFirsts.clear();
+	batchCounts.clear();
+	firstCurveBatch = 0;
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const DrawItem& item = items[i];
+		if (i == 0 || key(item) != key(items[i - 1]))
+		{
+			batches.push_back({ item.hasModel, item.shape, item.mode, item.r, item.g, item.b, item.a, batchFirsts.size(), 0 });
+			if (item.layer < LAYER_BEZIERS)
+				firstCurveBatch = batches.size();
+		}
+		batchFirsts.push_back(item.first);
+		batchCounts.push_back(item.count);
+		batches.back().count++;
+	}
+
+	batchesDirty = false;
+}
+
+void SceneRenderer::drawBatches(const PolyBuilder& polybuilder, Shader& shader, size_t begin, size_t end)
+{
+	if (begin >= end)
+		return;
+
+	shader.use();
+	int colorLocation = shader.getUniformLocation("uColor");
+	int modelLocation = shader.getUniformLocation("uModel");
+	bool modelSet = false;
+	glBindVertexArray(vao.get());
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const Batch& batch = batches[i];
+		// Read every frame, a drag only changes the matrix, not the batches
+		const Matrix3x3* model = batch.hasModel ? polybuilder.getShapeModelMatrix(batch.shape) : nullptr;
+		if (model || modelSet)
+		{
+			shader.setMat3(modelLocation, model ? *model : Matrix3x3());
+			modelSet = model != nullptr;
+		}
+		shader.setColor(colorLocation, batch.r, batch.g, batch.b, batch.a);
+		glMultiDrawArrays(batch.mode, batchFirsts.data() + batch.begin, batchCounts.data() + batch.begin, static_cast<GLsizei>(batch.count));
+	}
+
+	// Everything else drawn with this shader expects the identity
+	if (modelSet)
+		shader.setMat3(modelLocation, Matrix3x3());
+
+	glBindVertexArray(0);
+}
+
+void SceneRenderer::update(PolyBuilder& polybuilder)
+{
+	applyChanges(polybuilder);
+	upload(polybuilder);
+	if (batchesDirty)
+		rebuildBatches(polybuilder);
+}
+
+void SceneRenderer::drawPolygons(const PolyBuilder& polybuilder, Shader& shader, Shader& fillShader)
+{
+	// Filled polygons first, so they appear behind the outlines
+	const auto& filledPolygons = polybuilder.getFilledPolygons();
+	if (!filledPolygons.empty())
+	{
+		fillShader.use();
+		int fillColorLocation = fillShader.getUniformLocation("uColor");
+		// Coverage of the fills that don't have any (not part of the VAOs, so set once here)
+		glVertexAttrib1f(1, 1.0f);
+		for (const auto& filled : filledPolygons)
+		{
+			if (filled.fillPoints.empty())
+				continue;
+
+			fillShader.setColor(fillColorLocation, filled.colorR, filled.colorG, filled.colorB, filled.colorA);
+			glBindVertexArray(filled.vao);
+			glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(filled.fillPoints.size()));
+		}
+		glBindVertexArray(0);
+	}
+
+	drawBatches(polybuilder, shader, 0, firstCurveBatch);
+}
+
+void SceneRenderer::drawCurves(const PolyBuilder& polybuilder, Shader& shader)
+{
+	drawBatches(polybuilder, shader, firstCurveBatch, batches.size());
+}
@@ -27,6 +27,16 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     glAttachShader(id, fragment);
     glLinkProgram(id);
     checkCompileErrors(id, "PROGRAM");
+    cacheUniformLocations();
+
+    // Uniforms start at 0, and a zero model matrix would squash every shape into a point
+    int modelLocation = getUniformLocation("uModel");
+    if (modelLocation != -1)
+    {
+        glUseProgram(id);
+        setMat3(modelLocation, Matrix3x3());
+        glUseProgram(0);
+    }
 
     // Cleanup
     glDeleteShader(vertex);
@@ -43,9 +53,41 @@ void Shader::use() const
     glUseProgram(id);
 }
 
-void Shader::setColor(const std::string name, float r, float g, float b, float a) const
+void Shader::cacheUniformLocations()
+{
+    int uniformCount = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+    char name[256];
+    for (int i = 0; i < uniformCount; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(id, i, sizeof(name), &length, &size, &type, name);
+
+        std::string uniformName(name, length);
+        // Arrays are reported as "name[0]", but they're looked up without the index
+        if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+            uniformName.resize(uniformName.size() - 3);
+
+        uniformLocations.push_back({ uniformName, glGetUniformLocation(id, name) });
+    }
+}
+
+int Shader::getUniformLocation(const char* name) const
+{
+    for (const auto& uniform : uniformLocations)
+    {
+        if (uniform.first == name)
+            return uniform.second;
+    }
+    return -1;
+}
+
+void Shader::setColor(const char* name, float r, float g, float b, float a) const
 {
-    glUniform4f(glGetUniformLocation(id, name.c_str()), r, g, b, a);
+    glUniform4f(getUniformLocation(name), r, g, b, a);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, const std::string type)
@@ -0,0 +1,329 @@
+#include "SoftwareRaster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    uint8_t toByte(float value)
+    {
+        return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // PNG chunks end with the CRC-32 of their type and data
+    class Crc32
+    {
+    private:
+        uint32_t table[256];
+
+    public:
+        Crc32()
+        {
+            for (uint32_t n = 0; n < 256; n++)
+            {
+                uint32_t c = n;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                table[n] = c;
+            }
+        }
+
+        uint32_t update(uint32_t crc, const uint8_t* data, size_t size) const
+        {
+            crc = ~crc;
+            for (size_t i = 0; i < size; i++)
+                crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+            return ~crc;
+        }
+    };
+
+    // Writes a chunk's data as it comes, keeping its CRC (the length has to be known up front)
+    class PngChunkWriter
+    {
+    private:
+        std::ofstream& out;
+        const Crc32& crc32;
+        uint32_t crc = 0;
+
+        static void writeBigEndian(std::ofstream& out, uint32_t value)
+        {
+            uint8_t bytes[4] = { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                                 static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+            out.write(reinterpret_cast<const char*>(bytes), 4);
+        }
+
+    public:
+        PngChunkWriter(std::ofstream& out, const Crc32& crc32, const char type[4], uint32_t length)
+            : out(out), crc32(crc32)
+        {
+            writeBigEndian(out, length);
+            write(reinterpret_cast<const uint8_t*>(type), 4);
+        }
+
+        void write(const uint8_t* data, size_t size)
+        {
+            out.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            crc = crc32.update(crc, data, size);
+        }
+
+        void writeUint32(uint32_t value)
+        {
+            uint8_t bytes[4] = { static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+                                 static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value) };
+            write(bytes, 4);
+        }
+
+        void end() { writeBigEndian(out, crc); }
+    };
+}
+
+SoftwareRaster::SoftwareRaster(int width, int height)
+    : width(std::max(width, 1)), height(std::max(height, 1)),
+      pixels(static_cast<size_t>(this->width) * this->height * 4, 0)
+{
+}
+
+void SoftwareRaster::clear(float r, float g, float b, float a)
+{
+    uint8_t color[4] = { toByte(r), toByte(g), toByte(b), toByte(a) };
+    for (size_t i = 0; i < pixels.size(); i += 4)
+        std::copy(color, color + 4, pixels.begin() + i);
+}
+
+void SoftwareRaster::blendSpan(int y, int x0, int x1, float r, float g, float b, float a, uint8_t coverage)
+{
+    if (y < 0 || y >= height)
+        return;
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, width);
+    if (x0 >= x1)
+        return;
+
+    // Fixed point, alpha out of 255 : out = src * alpha + dst * (255 - alpha), alpha included
+    uint32_t alpha = (static_cast<uint32_t>(toByte(a)) * coverage + 127) / 255;
+    if (alpha == 0)
+        return;
+    uint32_t inverse = 255 - alpha;
+    uint32_t source[4] = { toByte(r) * alpha, toByte(g) * alpha, toByte(b) * alpha, alpha * alpha };
+
+    uint8_t* pixel = &pixels[(static_cast<size_t>(y) * width + x0) * 4];
+    for (int x = x0; x < x1; x++, pixel += 4)
+        for (int c = 0; c < 4; c++)
+            pixel[c] = static_cast<uint8_t>((source[c] + pixel[c] * inverse + 127) / 255);
+}
+
+void SoftwareRaster::drawFillPoints(const std::vector<Vertex>& points, int gridWidth, int gridHeight,
+    float r, float g, float b, float a, const std::vector<uint8_t>& coverage)
+{
+    bool hasCoverage = coverage.size() == points.size();
+
+    if (points.empty() || gridWidth <= 0 || gridHeight <= 0)
+        return;
+
+    // Back to the grid pixel each point was made from (the inverse of Filler::ScreenToNDC),
+    // then to the image pixels that grid pixel covers. Integer division so neighbours tile exactly
+    auto toImage = [&](const Vertex& point, int& left, int& top, int& right, int& bottom)
+    {
+        long gridX = std::lround((point.x + 1.0f) * gridWidth / 2.0f);
+        long gridY = std::lround((1.0f - point.y) * gridHeight / 2.0f);
+        left = static_cast<int>(gridX * width / gridWidth);
+        top = static_cast<int>(gridY * height / gridHeight);
+        right = std::max(left + 1, static_cast<int>((gridX + 1) * width / gridWidth));
+        bottom = std::max(top + 1, static_cast<int>((gridY + 1) * height / gridHeight));
+    };
+
+    int minX = width, minY = height, maxX = 0, maxY = 0;
+    for (const Vertex& point : points)
+    {
+        int left, top, right, bottom;
+        toImage(point, left, top, right, bottom);
+        minX = std::min(minX, left);
+        minY = std::min(minY, top);
+        maxX = std::max(maxX, right);
+        maxY = std::max(maxY, bottom);
+    }
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, width);
+    maxY = std::min(maxY, height);
+    if (minX >= maxX || minY >= maxY)
+        return;
+
+    int maskWidth = maxX - minX;
+    int maskHeight = maxY - minY;
+    mask.assign(static_cast<size_t>(maskWidth) * maskHeight, 0);
+
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        int left, top, right, bottom;
+        toImage(points[i], left, top, right, bottom);
+        left = std::max(left, minX);
+        top = std::max(top, minY);
+        right = std::min(right, maxX);
+        bottom = std::min(bottom, maxY);
+
+        uint8_t value = hasCoverage ? coverage[i] : 255;
+        for (int y = top; y < bottom; y++)
+        {
+            uint8_t* row = &mask[static_cast<size_t>(y - minY) * maskWidth];
+            for (int x = left; x < right; x++)
+                row[x - minX] = std::max(row[x - minX], value);
+        }
+    }
+
+    // Then blended a run of same coverage at a time (the inside of a shape is one long run)
+    for (int y = 0; y < maskHeight; y++)
+    {
+        const uint8_t* row = &mask[static_cast<size_t>(y) * maskWidth];
+        int x = 0;
+        while (x < maskWidth)
+        {
+            int runStart = x;
+            uint8_t value = row[x];
+            while (x < maskWidth && row[x] == value)
+                x++;
+            if (value > 0)
+                blendSpan(minY + y, minX + runStart, minX + x, r, g, b, a, value);
+        }
+    }
+}
+
+bool SoftwareRaster::writePPM(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Error: Can't write image " << path << std::endl;
+        return false;
+    }
+
+    out << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    for (int y = 0; y < height; y++)
+    {
+        const uint8_t* source = &pixels[static_cast<size_t>(y) * width * 4];
+        for (int x = 0; x < width; x++)
+        {
+            row[x * 3] = source[x * 4];
+            row[x * 3 + 1] = source[x * 4 + 1];
+            row[x * 3 + 2] = source[x * 4 + 2];
+        }
+        out.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+    }
+
+    if (!out)
+    {
+        std::cerr << "Error: Writing image " << path << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SoftwareRaster::writePNG(const std::string& path) const
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        std::cerr << "Error: Can't write image " << path << std::endl;
+        return false;
+    }
+
+    static const Crc32 crc32;
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    out.write(reinterpret_cast<const char*>(signature), 8);
+
+    {
+        PngChunkWriter header(out, crc32, "IHDR", 13);
+        header.writeUint32(static_cast<uint32_t>(width));
+        header.writeUint32(static_cast<uint32_t>(height));
+        const uint8_t format[5] = { 8, 6, 0, 0, 0 }; // 8 bits, RGBA, deflate, no filter, not interlaced
+        header.write(format, 5);
+        header.end();
+    }
+
+    // zlib stream of stored deflate blocks : every row is a 0 (no filter) followed by its pixels.
+    // Everything is known ahead, so the IDAT length can be written before the data
+    const size_t rowSize = static_cast<size_t>(width) * 4 + 1;
+    const size_t rawSize = rowSize * height;
+    const size_t maxBlock = 65535;
+    const size_t blockCount = std::max<size_t>((rawSize + maxBlock - 1) / maxBlock, 1);
+    const size_t dataSize = 2 + rawSize + blockCount * 5 + 4;
+    if (dataSize > 0x7FFFFFFFu)
+    {
+        std::cerr << "Error: " << width << "x" << height << " is too big for one uncompressed PNG chunk" << std::endl;
+        return false;
+    }
+
+    PngChunkWriter data(out, crc32, "IDAT", static_cast<uint32_t>(dataSize));
+    const uint8_t zlibHeader[2] = { 0x78, 0x01 }; // Deflate, 32K window, no dictionary
+    data.write(zlibHeader, 2);
+
+    uint32_t adlerA = 1, adlerB = 0;
+    size_t blockLeft = 0;
+    size_t written = 0;
+    auto writeRaw = [&](const uint8_t* bytes, size_t size)
+    {
+        while (size > 0)
+        {
+            if (blockLeft == 0)
+            {
+                blockLeft = std::min(maxBlock, rawSize - written);
+                bool last = written + blockLeft == rawSize;
+                uint16_t length = static_cast<uint16_t>(blockLeft);
+                const uint8_t blockHeader[5] = { static_cast<uint8_t>(last ? 1 : 0),
+                    static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+                    static_cast<uint8_t>(~length), static_cast<uint8_t>(~length >> 8) };
+                data.write(blockHeader, 5);
+            }
+
+            size_t count = std::min(size, blockLeft);
+            data.write(bytes, count);
+            // 5552 bytes is the most that can be summed before the modulo without overflowing
+            for (size_t i = 0; i < count; )
+            {
+                size_t end = std::min(count, i + 5552);
+                for (; i < end; i++)
+                {
+                    adlerA += bytes[i];
+                    adlerB += adlerA;
+                }
+                adlerA %= 65521;
+                adlerB %= 65521;
+            }
+            bytes += count;
+            size -= count;
+            blockLeft -= count;
+            written += count;
+        }
+    };
+
+    const uint8_t filter = 0;
+    for (int y = 0; y < height; y++)
+    {
+        writeRaw(&filter, 1);
+        writeRaw(&pixels[static_cast<size_t>(y) * width * 4], static_cast<size_t>(width) * 4);
+    }
+    data.writeUint32((adlerB << 16) | adlerA);
+    data.end();
+
+    {
+        PngChunkWriter end(out, crc32, "IEND", 0);
+        end.end();
+    }
+
+    if (!out)
+    {
+        std::cerr << "Error: Writing image " << path << " failed" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SoftwareRaster::write(const std::string& path) const
+{
+    if (path.size() > 4 && path.compare(path.size() - 4, 4, ".ppm") == 0)
+        return writePPM(path);
+    return writePNG(path);
+}
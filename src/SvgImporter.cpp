@@ -0,0 +1,606 @@
+#include "SvgImporter.h"
+#include "PolyBuilder.h"
+#include "MathUtils.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+    // Parses path data (or polygon points) one character at a time, so a "d" attribute
+    // of a few hundred megabytes never has to be in memory as a string
+    class PathParser
+    {
+    private:
+        const std::function<void(SvgImporter::SvgShape&)>& onShape;
+        SvgImporter::ImportStats& stats;
+
+        SvgImporter::SvgShape shape;
+        bool polygonPoints = false;
+
+        // Current command and the arguments read for it so far
+        char command = 0;
+        float args[7] = {};
+        int argCount = 0;
+        bool skipping = false; // Unknown command, ignored until the next one
+
+        // Number being read. Nothing valid is anywhere near this long
+        char number[64] = {};
+        int numberLength = 0;
+        bool numberHasDot = false;
+        bool numberHasExponent = false;
+
+        Vertex current;
+        Vertex subpathStart;
+        Vertex lastCubicControl; // For S, the reflection of the previous C / S second control point
+        Vertex lastQuadControl;  // Same for T with Q / T
+        char previousCommand = 0;
+
+        static int argumentsOf(char c)
+        {
+            switch (c)
+            {
+            case 'M': case 'L': case 'T': return 2;
+            case 'H': case 'V': return 1;
+            case 'C': return 6;
+            case 'S': case 'Q': return 4;
+            case 'A': return 7;
+            default: return 0;
+            }
+        }
+
+        static Vertex lerp(const Vertex& a, const Vertex& b, float t)
+        {
+            return Vertex(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+        }
+
+        void appendCubic(const Vertex& p0, const Vertex& c1, const Vertex& c2, const Vertex& p1)
+        {
+            shape.points.push_back(p0);
+            shape.points.push_back(c1);
+            shape.points.push_back(c2);
+            shape.points.push_back(p1);
+            stats.segments++;
+        }
+
+        // Straight lines stay a vertex list until the subpath gets its first curve
+        void switchToCurves()
+        {
+            std::vector<Vertex> polyline = std::move(shape.points);
+            shape.points.clear();
+            shape.points.reserve(polyline.size() * 4);
+            stats.segments -= polyline.size() > 0 ? polyline.size() - 1 : 0;
+            for (size_t i = 1; i < polyline.size(); i++)
+                appendCubic(polyline[i - 1], lerp(polyline[i - 1], polyline[i], 1.0f / 3.0f),
+                    lerp(polyline[i - 1], polyline[i], 2.0f / 3.0f), polyline[i]);
+            shape.curved = true;
+        }
+
+        void emitShape()
+        {
+            bool valid;
+            if (shape.curved)
+                valid = shape.points.size() >= 4;
+            else
+            {
+                // The last point back on the first one is the polygon closing itself
+                if (shape.points.size() > 1 && shape.points.back().x == shape.points.front().x &&
+                    shape.points.back().y == shape.points.front().y)
+                    shape.points.pop_back();
+                valid = shape.points.size() >= 3;
+            }
+
+            if (valid)
+            {
+                if (shape.curved)
+                    stats.sequences++;
+                else
+                    stats.polygons++;
+                onShape(shape);
+            }
+            else if (!shape.points.empty())
+                stats.skippedShapes++;
+
+            shape.points.clear();
+            shape.curved = false;
+            shape.closed = false;
+        }
+
+        void moveTo(const Vertex& point)
+        {
+            emitShape();
+            shape.points.push_back(point);
+            current = subpathStart = point;
+        }
+
+        void lineTo(const Vertex& point)
+        {
+            // A drawing command right after Z starts a new subpath from the closing point
+            if (shape.points.empty())
+                shape.points.push_back(current);
+
+            if (shape.curved)
+                appendCubic(current, lerp(current, point, 1.0f / 3.0f), lerp(current, point, 2.0f / 3.0f), point);
+            else
+            {
+                shape.points.push_back(point);
+                stats.segments++;
+            }
+            current = point;
+        }
+
+        void cubicTo(const Vertex& c1, const Vertex& c2, const Vertex& point)
+        {
+            if (shape.points.empty())
+                shape.points.push_back(current);
+            if (!shape.curved)
+                switchToCurves();
+
+            appendCubic(current, c1, c2, point);
+            lastCubicControl = c2;
+            current = point;
+        }
+
+        void quadTo(const Vertex& control, const Vertex& point)
+        {
+            // Degree elevation, a quadratic is exactly this cubic
+            Vertex start = current;
+            cubicTo(lerp(start, control, 2.0f / 3.0f), lerp(point, control, 2.0f / 3.0f), point);
+            lastQuadControl = control;
+        }
+
+        void closePath()
+        {
+            if (!shape.points.empty())
+            {
+                if (shape.curved && (current.x != subpathStart.x || current.y != subpathStart.y))
+                    lineTo(subpathStart);
+                shape.closed = true;
+                emitShape();
+            }
+            current = subpathStart;
+        }
+
+        void execute()
+        {
+            bool relative = command >= 'a';
+            char upper = relative ? static_cast<char>(command - 'a' + 'A') : command;
+            float offsetX = relative ? current.x : 0.0f;
+            float offsetY = relative ? current.y : 0.0f;
+            auto point = [&](int i) { return Vertex(args[i] + offsetX, args[i + 1] + offsetY); };
+
+            switch (upper)
+            {
+            case 'M':
+                moveTo(point(0));
+                // More pairs after a moveto are linetos
+                command = relative ? 'l' : 'L';
+                break;
+            case 'L': lineTo(point(0)); break;
+            case 'H': lineTo(Vertex(args[0] + offsetX, current.y)); break;
+            case 'V': lineTo(Vertex(current.x, args[0] + offsetY)); break;
+            case 'C': cubicTo(point(0), point(2), point(4)); break;
+            case 'S':
+            {
+                Vertex c1 = (previousCommand == 'C' || previousCommand == 'S')
+                    ? Vertex(2.0f * current.x - lastCubicControl.x, 2.0f * current.y - lastCubicControl.y) : current;
+                cubicTo(c1, point(0), point(2));
+                break;
+            }
+            case 'Q': quadTo(point(0), point(2)); break;
+            case 'T':
+            {
+                Vertex control = (previousCommand == 'Q' || previousCommand == 'T')
+                    ? Vertex(2.0f * current.x - lastQuadControl.x, 2.0f * current.y - lastQuadControl.y) : current;
+                quadTo(control, point(0));
+                break;
+            }
+            case 'A':
+                // Only the end point matters to keep the rest of the path in place
+                lineTo(Vertex(args[5] + offsetX, args[6] + offsetY));
+                stats.approximatedArcs++;
+                break;
+            }
+            previousCommand = upper;
+        }
+
+        void pushArgument(float value)
+        {
+            if (command == 0 || skipping)
+                return;
+
+            args[argCount++] = value;
+            if (argCount == argumentsOf(command >= 'a' ? static_cast<char>(command - 'a' + 'A') : command))
+            {
+                execute();
+                argCount = 0;
+            }
+        }
+
+        void flushNumber()
+        {
+            if (numberLength == 0)
+                return;
+
+            number[numberLength] = '\0';
+            pushArgument(std::strtof(number, nullptr));
+            numberLength = 0;
+            numberHasDot = false;
+            numberHasExponent = false;
+        }
+
+        void appendToNumber(char c)
+        {
+            if (numberLength < static_cast<int>(sizeof(number)) - 1)
+                number[numberLength++] = c;
+        }
+
+        void startCommand(char c)
+        {
+            // Arguments left over from the previous command aren't enough for anything
+            argCount = 0;
+
+            char upper = (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+            if (upper == 'Z')
+            {
+                closePath();
+                command = 0;
+                skipping = false;
+                previousCommand = 'Z';
+                return;
+            }
+
+            skipping = argumentsOf(upper) == 0;
+            command = skipping ? 0 : c;
+        }
+
+    public:
+        PathParser(const std::function<void(SvgImporter::SvgShape&)>& onShape, SvgImporter::ImportStats& stats)
+            : onShape(onShape), stats(stats) {}
+
+        // A "points" attribute is path data with only numbers : an implicit M, then L, then Z
+        void beginPolygon()
+        {
+            begin();
+            polygonPoints = true;
+            command = 'M';
+        }
+
+        void begin()
+        {
+            shape = SvgImporter::SvgShape();
+            polygonPoints = false;
+            command = 0;
+            argCount = 0;
+            skipping = false;
+            numberLength = 0;
+            numberHasDot = false;
+            numberHasExponent = false;
+            current = subpathStart = Vertex();
+            previousCommand = 0;
+        }
+
+        // The large arc and sweep flags of an arc are a single digit, and files often don't separate them
+        // ("a1 1 0 00 1 5 5"), so there every digit is a whole number
+        bool expectingArcFlag() const
+        {
+            return (command == 'A' || command == 'a') && !skipping && (argCount == 3 || argCount == 4);
+        }
+
+        void feed(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                if (numberLength == 0 && expectingArcFlag())
+                {
+                    appendToNumber(c);
+                    flushNumber();
+                    return;
+                }
+                appendToNumber(c);
+                return;
+            }
+
+            switch (c)
+            {
+            case '.':
+                // "1.5.5" is two numbers
+                if (numberHasDot || numberHasExponent)
+                    flushNumber();
+                appendToNumber(c);
+                numberHasDot = true;
+                return;
+            case '-':
+            case '+':
+                if (numberLength > 0 && (number[numberLength - 1] == 'e' || number[numberLength - 1] == 'E'))
+                    appendToNumber(c);
+                else
+                {
+                    flushNumber();
+                    appendToNumber(c);
+                }
+                return;
+            case 'e':
+            case 'E':
+                if (numberLength > 0 && !numberHasExponent)
+                {
+                    appendToNumber(c);
+                    numberHasExponent = true;
+                    return;
+                }
+                break;
+            default:
+                break;
+            }
+
+            flushNumber();
+            if (!polygonPoints && ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')))
+                startCommand(c);
+        }
+
+        void end()
+        {
+            flushNumber();
+            if (polygonPoints)
+                closePath();
+            else
+                emitShape();
+        }
+    };
+
+    // Just enough of XML to find attributes : tags, quoted values, comments. Everything else is text to skip
+    class SvgScanner
+    {
+    private:
+        enum State
+        {
+            TEXT,
+            TAG_NAME,
+            IN_TAG,
+            ATTRIBUTE_NAME,
+            BEFORE_VALUE,
+            VALUE,
+            COMMENT
+        };
+
+        enum Element
+        {
+            OTHER,
+            PATH,
+            POLYGON
+        };
+
+        PathParser& parser;
+        State state = TEXT;
+        Element element = OTHER;
+        std::string name; // Tag or attribute name, capped so a broken file can't grow it
+        char quote = 0;
+        bool parsingValue = false;
+        char previous[2] = {};
+
+        static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+        void appendToName(char c)
+        {
+            if (name.size() < 32)
+                name.push_back(c);
+        }
+
+    public:
+        explicit SvgScanner(PathParser& parser) : parser(parser) {}
+
+        void feed(char c)
+        {
+            switch (state)
+            {
+            case TEXT:
+                if (c == '<')
+                {
+                    state = TAG_NAME;
+                    name.clear();
+                }
+                break;
+
+            case TAG_NAME:
+                if (isSpace(c) || c == '>' || c == '/')
+                {
+                    element = name == "path" ? PATH : name == "polygon" ? POLYGON : OTHER;
+                    state = IN_TAG;
+                    if (c == '>')
+                        state = TEXT;
+                    break;
+                }
+                appendToName(c);
+                if (name == "!--")
+                {
+                    state = COMMENT;
+                    previous[0] = previous[1] = 0;
+                }
+                break;
+
+            case IN_TAG:
+                if (c == '>')
+                    state = TEXT;
+                else if (c == '"' || c == '\'')
+                {
+                    // Quoted text without a name (<!DOCTYPE ... "...">), skipped like a value
+                    quote = c;
+                    parsingValue = false;
+                    state = VALUE;
+                }
+                else if (!isSpace(c) && c != '/' && c != '=')
+                {
+                    name.clear();
+                    appendToName(c);
+                    state = ATTRIBUTE_NAME;
+                }
+                break;
+
+            case ATTRIBUTE_NAME:
+                if (c == '=')
+                    state = BEFORE_VALUE;
+                else if (c == '>')
+                    state = TEXT;
+                else if (isSpace(c))
+                    state = BEFORE_VALUE;
+                else
+                    appendToName(c);
+                break;
+
+            case BEFORE_VALUE:
+                if (c == '"' || c == '\'')
+                {
+                    quote = c;
+                    parsingValue = (element == PATH && name == "d") || (element == POLYGON && name == "points");
+                    if (parsingValue)
+                    {
+                        if (element == POLYGON)
+                            parser.beginPolygon();
+                        else
+                            parser.begin();
+                    }
+                    state = VALUE;
+                }
+                else if (c == '>')
+                    state = TEXT;
+                else if (!isSpace(c) && c != '=')
+                {
+                    // Attribute without a value, this is the next one's name
+                    name.clear();
+                    appendToName(c);
+                    state = ATTRIBUTE_NAME;
+                }
+                break;
+
+            case VALUE:
+                if (c == quote)
+                {
+                    if (parsingValue)
+                        parser.end();
+                    parsingValue = false;
+                    state = IN_TAG;
+                }
+                else if (parsingValue)
+                    parser.feed(c);
+                break;
+
+            case COMMENT:
+                if (c == '>' && previous[0] == '-' && previous[1] == '-')
+                    state = TEXT;
+                previous[0] = previous[1];
+                previous[1] = c;
+                break;
+            }
+        }
+    };
+}
+
+namespace SvgImporter
+{
+    bool readFile(const std::string& path, const std::function<void(SvgShape&)>& onShape, ImportStats& stats)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+        {
+            std::cerr << "Error: Can't open SVG file " << path << std::endl;
+            return false;
+        }
+
+        PathParser parser(onShape, stats);
+        SvgScanner scanner(parser);
+
+        // The only buffer that depends on the file is the shape being parsed
+        std::vector<char> chunk(64 * 1024);
+        while (in)
+        {
+            in.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            std::streamsize read = in.gcount();
+            for (std::streamsize i = 0; i < read; i++)
+                scanner.feed(chunk[i]);
+        }
+
+        if (in.bad())
+        {
+            std::cerr << "Error: Reading SVG file " << path << " failed" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    bool importFile(PolyBuilder& polybuilder, const std::string& path)
+    {
+        // First pass : only the bounds, nothing is kept
+        float minX = std::numeric_limits<float>::max(), minY = std::numeric_limits<float>::max();
+        float maxX = std::numeric_limits<float>::lowest(), maxY = std::numeric_limits<float>::lowest();
+        ImportStats boundsStats;
+        bool read = readFile(path, [&](SvgShape& shape)
+            {
+                for (const Vertex& point : shape.points)
+                {
+                    minX = std::min(minX, point.x);
+                    minY = std::min(minY, point.y);
+                    maxX = std::max(maxX, point.x);
+                    maxY = std::max(maxY, point.y);
+                }
+            }, boundsStats);
+        if (!read)
+            return false;
+
+        if (boundsStats.polygons + boundsStats.sequences == 0)
+        {
+            std::cerr << "Error: No path or polygon found in " << path << std::endl;
+            return false;
+        }
+
+        // Fits the drawing in 90% of the view, keeping its proportions, with y going up
+        float size = std::max(maxX - minX, maxY - minY);
+        float scale = size > 0.0f ? 1.8f / size : 1.0f;
+        float centerX = (minX + maxX) * 0.5f;
+        float centerY = (minY + maxY) * 0.5f;
+        Affine2x3 toView(scale, 0.0f, -centerX * scale,
+                         0.0f, -scale, centerY * scale);
+
+        float stepSize = polybuilder.getGlobalStepSize();
+        ImportStats stats;
+        polybuilder.beginEdit("Import SVG");
+        read = readFile(path, [&](SvgShape& shape)
+            {
+                MathUtils::transformVertices(toView, shape.points.data(), shape.points.data(), shape.points.size());
+
+                if (!shape.curved)
+                {
+                    Polygon polygon;
+                    polygon.type = POLYGON;
+                    polygon.setVertices(std::move(shape.points));
+                    // Flipping y flipped the orientation, and the rest of the app wants counter clockwise
+                    if (polygon.isClockwise())
+                        polygon.reverseOrientation();
+                    polybuilder.addFinishedPolygon(std::move(polygon));
+                    return;
+                }
+
+                // C0 : imported corners stay corners. A closed subpath already ends on its start point,
+                // so the points are used as they are and each curve is generated once
+                CubicBezierSequence sequence(0, stepSize, 0);
+                const Vertex* points = shape.points.data();
+                sequence.loadControlPoints(points, points + shape.points.size(), shape.closed);
+                sequence.regenerateCurves();
+                polybuilder.addFinishedSequence(std::move(sequence));
+            }, stats);
+        polybuilder.endEdit();
+
+        if (!read)
+            return false;
+
+        std::cout << "Imported " << stats.polygons << " polygons and " << stats.sequences << " sequences ("
+            << stats.segments << " segments) from " << path << std::endl;
+        if (stats.approximatedArcs > 0)
+            std::cout << stats.approximatedArcs << " arcs were replaced by straight lines" << std::endl;
+        if (stats.skippedShapes > 0)
+            std::cout << stats.skippedShapes << " subpaths were too short to import" << std::endl;
+        return true;
+    }
+}
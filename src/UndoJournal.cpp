@@ -0,0 +1,208 @@
+#include "UndoJournal.h"
+
+namespace
+{
+    size_t shapeMemory(const ShapeObject& shape)
+    {
+        if (const Polygon* polygon = std::get_if<Polygon>(&shape))
+            return sizeof(Polygon) + polygon->getVertices().size() * sizeof(Vertex);
+
+        if (const Bezier* bezier = std::get_if<Bezier>(&shape))
+            return sizeof(Bezier) + (bezier->getControlPoints().size() + bezier->getGeneratedCurve().size()
+                + bezier->getConvexHull().size()) * sizeof(Vertex);
+
+        if (const CubicBezierSequence* sequence = std::get_if<CubicBezierSequence>(&shape))
+        {
+            size_t memory = sizeof(CubicBezierSequence);
+            for (const Bezier& curve : sequence->getCurves())
+                memory += sizeof(Bezier) + (curve.getControlPoints().size() + curve.getGeneratedCurve().size()
+                    + curve.getConvexHull().size()) * sizeof(Vertex);
+            return memory;
+        }
+
+        return 0;
+    }
+
+    // SET_CURVES of the same sequence : the union of both sets of curves. A curve keeps its "before" from
+    // the first command that touched it and its "after" from the last one, so one drag stays one command
+    // even when the constraints reach a different number of curves at each step
+    void mergeCurves(JournalCommand& last, JournalCommand& next)
+    {
+        if (last.curveIndices == next.curveIndices)
+        {
+            last.after = std::move(next.after);
+            return;
+        }
+
+        std::vector<size_t> curveIndices;
+        std::vector<Vertex> before, after;
+        curveIndices.reserve(last.curveIndices.size() + next.curveIndices.size());
+        before.reserve(curveIndices.capacity() * 4);
+        after.reserve(curveIndices.capacity() * 4);
+
+        size_t i = 0, j = 0;
+        while (i < last.curveIndices.size() || j < next.curveIndices.size())
+        {
+            bool inLast = i < last.curveIndices.size() && (j == next.curveIndices.size() || last.curveIndices[i] <= next.curveIndices[j]);
+            bool inNext = j < next.curveIndices.size() && (i == last.curveIndices.size() || next.curveIndices[j] <= last.curveIndices[i]);
+
+            curveIndices.push_back(inLast ? last.curveIndices[i] : next.curveIndices[j]);
+            const Vertex* from = inLast ? &last.before[i * 4] : &next.before[j * 4];
+            const Vertex* to = inNext ? &next.after[j * 4] : &last.after[i * 4];
+            before.insert(before.end(), from, from + 4);
+            after.insert(after.end(), to, to + 4);
+
+            if (inLast) i++;
+            if (inNext) j++;
+        }
+
+        last.curveIndices = std::move(curveIndices);
+        last.before = std::move(before);
+        last.after = std::move(after);
+    }
+
+    // Folds next into last when they're the same kind of change to the same thing, so a drag
+    // made of hundreds of small moves is still a single command
+    bool merge(JournalCommand& last, JournalCommand& next)
+    {
+        if (last.kind != next.kind || last.shape.type != next.shape.type || last.shape.index != next.shape.index)
+            return false;
+
+        switch (next.kind)
+        {
+        case JournalCommand::MOVE_VERTEX:
+            if (last.vertexIndex != next.vertexIndex)
+                return false;
+            last.to = next.to;
+            return true;
+        case JournalCommand::APPLY_MATRIX:
+            last.matrix = next.matrix * last.matrix;
+            return true;
+        case JournalCommand::SET_POINTS:
+            last.after = std::move(next.after);
+            return true;
+        case JournalCommand::SET_CURVES:
+            mergeCurves(last, next);
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+size_t JournalCommand::memory() const
+{
+    return sizeof(JournalCommand) + (before.capacity() + after.capacity()) * sizeof(Vertex)
+        + curveIndices.capacity() * sizeof(size_t) + shapeMemory(storedShape);
+}
+
+void UndoJournal::beginStep(const std::string& name)
+{
+    if (openDepth++ == 0)
+        openStep.name = name;
+}
+
+void UndoJournal::endStep()
+{
+    if (openDepth == 0)
+        return;
+    if (--openDepth > 0)
+        return;
+
+    if (!openStep.commands.empty())
+        pushUndoStep(std::move(openStep));
+    openStep = JournalStep();
+}
+
+void UndoJournal::record(JournalCommand&& command)
+{
+    // Something new happened, what was undone can't come back anymore
+    clearRedo();
+
+    if (openDepth > 0)
+    {
+        if (openStep.commands.empty() || !merge(openStep.commands.back(), command))
+            openStep.commands.push_back(std::move(command));
+        return;
+    }
+
+    JournalStep step;
+    switch (command.kind)
+    {
+    case JournalCommand::MOVE_VERTEX: step.name = "Move vertex"; break;
+    case JournalCommand::APPLY_MATRIX: step.name = "Transform"; break;
+    case JournalCommand::SET_POINTS:
+    case JournalCommand::SET_CURVES: step.name = "Edit points"; break;
+    case JournalCommand::ADD_SHAPE: step.name = "Add shape"; break;
+    case JournalCommand::REMOVE_SHAPE: step.name = "Remove shape"; break;
+    }
+    step.commands.push_back(std::move(command));
+    pushUndoStep(std::move(step));
+}
+
+void UndoJournal::pushUndoStep(JournalStep&& step)
+{
+    step.memory = 0;
+    for (const JournalCommand& command : step.commands)
+        step.memory += command.memory();
+    memoryUsed += step.memory;
+    undoSteps.push_back(std::move(step));
+    trim();
+}
+
+void UndoJournal::clearRedo()
+{
+    for (const JournalStep& step : redoSteps)
+        memoryUsed -= step.memory;
+    redoSteps.clear();
+}
+
+void UndoJournal::trim()
+{
+    // Always keeps the last step, even if it's bigger than the whole budget
+    while (undoSteps.size() > 1 && (memoryUsed > memoryBudget || undoSteps.size() > maxSteps))
+    {
+        memoryUsed -= undoSteps.front().memory;
+        undoSteps.pop_front();
+    }
+}
+
+JournalStep UndoJournal::takeUndo()
+{
+    JournalStep step = std::move(undoSteps.back());
+    undoSteps.pop_back();
+    memoryUsed -= step.memory;
+    return step;
+}
+
+JournalStep UndoJournal::takeRedo()
+{
+    JournalStep step = std::move(redoSteps.back());
+    redoSteps.pop_back();
+    memoryUsed -= step.memory;
+    return step;
+}
+
+void UndoJournal::pushRedo(JournalStep&& step)
+{
+    // Undoing moved shapes in or out of the commands, so the size changed
+    step.memory = 0;
+    for (const JournalCommand& command : step.commands)
+        step.memory += command.memory();
+    memoryUsed += step.memory;
+    redoSteps.push_back(std::move(step));
+}
+
+void UndoJournal::pushUndoAfterRedo(JournalStep&& step)
+{
+    pushUndoStep(std::move(step));
+}
+
+void UndoJournal::clear()
+{
+    undoSteps.clear();
+    redoSteps.clear();
+    openStep = JournalStep();
+    openDepth = 0;
+    memoryUsed = 0;
+}
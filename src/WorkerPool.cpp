@@ -0,0 +1,148 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+
+// Set while a thread runs tasks, so a task that calls parallelFor again doesn't wait on itself
+static thread_local bool insideBatch = false;
+
+WorkerPool::WorkerPool(unsigned int threadCount)
+{
+	// The calling thread takes part in every batch, so it counts as one of them
+	for (unsigned int i = 1; i < threadCount; i++)
+		workers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+}
+
+WorkerPool& WorkerPool::instance()
+{
+	static WorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+	return pool;
+}
+
+void WorkerPool::workerLoop()
+{
+	insideBatch = true;
+	unsigned long long seenBatch = 0;
+
+	while (true)
+	{
+		unsigned long long batch;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return stopping || batchId != seenBatch; });
+			if (stopping)
+				return;
+			batch = batchId;
+		}
+
+		seenBatch = batch;
+		runTasks(batch);
+	}
+}
+
+void WorkerPool::runTasks(unsigned long long batch)
+{
+	while (true)
+	{
+		// Claim a chunk of indices, so we don't lock once per curve
+		size_t begin, end;
+		const std::function<void(size_t)>* task;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (batchId != batch || nextIndex >= taskCount)
+				return;
+			begin = nextIndex;
+			end = std::min(taskCount, begin + chunkSize);
+			nextIndex = end;
+			task = currentTask;
+		}
+
+		// An exception can't leave a worker thread (that's std::terminate), so it's handed to the caller
+		std::exception_ptr error;
+		try
+		{
+			for (size_t i = begin; i < end; i++)
+				(*task)(i);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finishedCount += end - begin;
+		if (error)
+		{
+			if (!firstError)
+				firstError = error;
+			// No point running the rest, count it as done so the caller wakes up
+			finishedCount += taskCount - nextIndex;
+			nextIndex = taskCount;
+		}
+		if (finishedCount == taskCount)
+			doneCondition.notify_all();
+	}
+}
+
+void WorkerPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0)
+		return;
+
+	// Nothing to gain (or a nested call from a worker), just do it here
+	if (workers.empty() || count == 1 || insideBatch)
+	{
+		for (size_t i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	std::lock_guard<std::mutex> callerLock(callerMutex);
+
+	unsigned long long batch;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		taskCount = count;
+		// A few chunks per thread keeps them busy even if some curves are much longer than others
+		chunkSize = std::max<size_t>(1, count / (getThreadCount() * 4));
+		nextIndex = 0;
+		finishedCount = 0;
+		firstError = nullptr;
+		batch = ++batchId;
+	}
+	wakeCondition.notify_all();
+
+	{
+		// Reset even if something goes wrong, or every later batch would run serially
+		struct BatchGuard
+		{
+			BatchGuard() { insideBatch = true; }
+			~BatchGuard() { insideBatch = false; }
+		} guard;
+		runTasks(batch);
+	}
+
+	std::exception_ptr error;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		doneCondition.wait(lock, [&] { return finishedCount == taskCount; });
+		currentTask = nullptr;
+		error = firstError;
+		firstError = nullptr;
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+}
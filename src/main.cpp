@@ -11,6 +11,10 @@
 #include "Filler.h"
 #include "CommonTypes.h"
 #include "Bezier.h"
+#include "PreviewStream.h"
+#include "SceneRenderer.h"
+#include "SceneFile.h"
+#include "SvgImporter.h"
 
 bool openContextMenu;
 bool showFillSettings = true;
@@ -38,6 +42,15 @@ static void KeyCallback(GLFWwindow* window, int key, int scancode, int action, i
 
     if (key == GLFW_KEY_KP_ADD && action == GLFW_PRESS)
         GUI::tryDuplicateVertex(window, polybuilder);
+
+    // Ctrl+Z undo, Ctrl+Y or Ctrl+Shift+Z redo (held down repeats)
+    if ((action == GLFW_PRESS || action == GLFW_REPEAT) && (mods & GLFW_MOD_CONTROL))
+    {
+        if (key == GLFW_KEY_Z && !(mods & GLFW_MOD_SHIFT))
+            polybuilder.undo();
+        else if (key == GLFW_KEY_Y || key == GLFW_KEY_Z)
+            polybuilder.redo();
+    }
 }
 
 static void MouseButtonCallback(GLFWwindow* window, int button, int action, int mods)
@@ -106,7 +119,7 @@ static void setupCallbacks(GLFWwindow* window)
     glfwSetCursorPosCallback(window, CursorPositionCallback);
 }
 
-int main()
+int main(int argc, char** argv)
 {
     // Initialize GLFW
     if (!glfwInit()) {
@@ -164,151 +177,103 @@ int main()
     ImGui_ImplGlfw_InitForOpenGL(window, true);	// Second param install_callback=true will install GLFW callbacks and chain to existing ones.
     ImGui_ImplOpenGL3_Init();
 
-    const char* vertexShaderPath = "shaders/vertex.glsl";
-    const char* vertexFillShaderPath = "shaders/vertex_fill.glsl";
-    const char* fragmentShaderPath = "shaders/fragment.glsl";
-
-    Shader shader = Shader(vertexShaderPath, fragmentShaderPath);
-    // Fill shader uses normal point size, vertex shader uses bigger points
-    Shader fillShader = Shader(vertexFillShaderPath, fragmentShaderPath);
+    // Everything owning GL objects lives in this block, so it's destroyed while there's still a context
+    {
+        const char* vertexShaderPath = "shaders/vertex.glsl";
+        const char* vertexFillShaderPath = "shaders/vertex_fill.glsl";
+        const char* vertexMarkerShaderPath = "shaders/vertex_marker.glsl";
+        const char* fragmentShaderPath = "shaders/fragment.glsl";
+        const char* fragmentFillShaderPath = "shaders/fragment_fill.glsl";
+
+        Shader shader = Shader(vertexShaderPath, fragmentShaderPath);
+        // Fill shader uses normal point size, vertex shader uses bigger points
+        Shader fillShader = Shader(vertexFillShaderPath, fragmentFillShaderPath);
+        // Intersection markers are instanced, their shader places each cross
+        Shader markerShader = Shader(vertexMarkerShaderPath, fragmentShaderPath);
+
+        // Everything being built goes through this, one upload per frame
+        PreviewStream previewStream;
+        SceneRenderer sceneRenderer;
+
+        // A scene (or an SVG drawing) given on the command line is loaded once there's a context for its buffers
+        if (argc > 1)
+        {
+            std::string path = argv[1];
+            if (path.size() > 4 && path.compare(path.size() - 4, 4, ".svg") == 0)
+                SvgImporter::importFile(polybuilder, path);
+            else
+                SceneFile::load(polybuilder, path);
+        }
 
 
-    float maxPointSize[2];
-    glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, maxPointSize);
-    std::cout << "Max point size supported: " << maxPointSize[1] << std::endl;
+        float maxPointSize[2];
+        glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, maxPointSize);
+        std::cout << "Max point size supported: " << maxPointSize[1] << std::endl;
 
-    // Render loop
-    while (!glfwWindowShouldClose(window))
-    {
-        // Poll events (keyboard, mouse)
-        glfwPollEvents();
-
-        // Start the ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
-
-        // Draw all the ImGui part (in GUI namespace)
-        GUI::drawVertexInfoPanel(polybuilder); // Top left panel
-        GUI::drawBezierInfoPanel(polybuilder);
-        GUI::handleContextMenu(&openContextMenu, polybuilder); // Right click menu
-        GUI::drawHoverTooltip(window, polybuilder); // Tooltip when hovering vertices
-        GUI::drawFillSettingsPanel(&showFillSettings); // Fill settings panel
-        GUI::drawBezierSettingsPanel(polybuilder);
-        if (polybuilder.isBuilding())
-            GUI::drawBuildingHelpTextbox(window);
-        GUI::drawTransformationHelpTextbox(window);
-
-        // Rendering
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-
-        // Draw filled polygons first (so they appear behind the outlines)
-        for (const auto& filled : polybuilder.getFilledPolygons())
+        // Render loop
+        while (!glfwWindowShouldClose(window))
         {
-            if (!filled.fillPoints.empty()) {
-                fillShader.use();
-                fillShader.setColor("uColor", filled.colorR, filled.colorG, filled.colorB, filled.colorA);
+            // Poll events (keyboard, mouse)
+            glfwPollEvents();
+
+            // Start the ImGui frame
+            ImGui_ImplOpenGL3_NewFrame();
+            ImGui_ImplGlfw_NewFrame();
+            ImGui::NewFrame();
+
+            // Draw all the ImGui part (in GUI namespace)
+            GUI::drawVertexInfoPanel(polybuilder); // Top left panel
+            GUI::drawBezierInfoPanel(polybuilder);
+            GUI::handleContextMenu(&openContextMenu, polybuilder); // Right click menu
+            GUI::drawHoverTooltip(window, polybuilder); // Tooltip when hovering vertices
+            GUI::drawFillSettingsPanel(&showFillSettings); // Fill settings panel
+            GUI::drawBezierSettingsPanel(polybuilder);
+            if (polybuilder.isBuilding())
+                GUI::drawBuildingHelpTextbox(window);
+            GUI::drawTransformationHelpTextbox(window);
 
-                // Bind and draw the fill points
-                glBindVertexArray(filled.vao);
-                glDrawArrays(GL_POINTS, 0, filled.fillPoints.size());
-            }
-        }
-        
-        // Draw original and window polygons
-        for (const auto& poly : polybuilder.getFinishedPolygons())
-        {
-            if (poly.type == PolyType::POLYGON || poly.type == PolyType::WINDOW) {
-                shader.use();
-                switch (poly.type) {
-                case PolyType::POLYGON:
-                    shader.setColor("uColor", 1.0f, 0.0f, 0.0f, 1.0f); // Red for regular polygons
-                    break;
-                case PolyType::WINDOW:
-                    shader.setColor("uColor", 0.0f, 1.0f, 0.0f, 1.0f); // Green for window polygons
-                    break;
-                }
-                poly.draw();
+            // Rendering
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
 
-                shader.setColor("uColor", 1.0f, 1.0f, 1.0f, 1.0f);
-                if (!poly.type == BEZIER_CURVE)
-                    poly.drawPoints();
-            }
-            else if (poly.type == BEZIER_CURVE)
-            {
-                shader.setColor("uColor", 0.0f, 1.0f, 1.0f, 1.0f);
-                poly.draw();
-            }
-        }
 
-        // Second pass: Draw clipped polygons with transparency
-        for (const auto& poly : polybuilder.getFinishedPolygons()) {
-            if (poly.type == PolyType::CLIPPED_CYRUS_BECK ||
-                poly.type == PolyType::CLIPPED_SUTHERLAND_HODGMAN) {
-
-                shader.use();
-                switch (poly.type) {
-                case PolyType::CLIPPED_CYRUS_BECK:
-                    shader.setColor("uColor", 0.0f, 0.0f, 1.0f, 0.7f); // Blue with 70% opacity
-                    break;
-                case PolyType::CLIPPED_SUTHERLAND_HODGMAN:
-                    shader.setColor("uColor", 0.8f, 0.0f, 0.8f, 0.7f); // Purple with 70% opacity
-                    break;
-                }
-                poly.draw();
+            // Every finished shape, batched by color from one shared buffer. Only what changed gets uploaded
+            sceneRenderer.update(polybuilder);
+            sceneRenderer.drawPolygons(polybuilder, shader, fillShader);
 
-                shader.setColor("uColor", 1.0f, 1.0f, 1.0f, 0.7f);
-                //poly.drawPoints();
-            }
-        }
-        
-        // Draw previews of shapes being built
-        if (polybuilder.isBuilding())
-        {
-            if (polybuilder.bezierMode)
-            {
-                polybuilder.tempBezier.drawControlPointsPreview(shader);
-                if (polybuilder.tempBezier.getControlPoints().size() > 2)
-                    polybuilder.tempBezier.drawGeneratedCurvePreview(shader);
-            }
-            else if (polybuilder.cubicSequenceMode)
+            // Draw previews of shapes being built
+            if (polybuilder.isBuilding())
             {
-                polybuilder.tempBezier.drawControlPointsPreview(shader);
-                if (polybuilder.tempBezier.getControlPoints().size() > 2)
-                    polybuilder.tempBezier.drawGeneratedCurvePreview(shader);
-                polybuilder.currentSequence.drawPreview(shader);
-            }
-            else 
-                polybuilder.tempPolygon.drawPreview(shader);
-        }
+                if (polybuilder.bezierMode)
+                    previewStream.addBezier(polybuilder.tempBezier);
+                else if (polybuilder.cubicSequenceMode)
+                {
+                    previewStream.addBezier(polybuilder.tempBezier);
+                    previewStream.addSequence(polybuilder.currentSequence);
+                }
+                else 
+                    previewStream.addPolygon(polybuilder.tempPolygon);
 
-        // Draw bziers (free degree)
-        for (const auto& bezier : polybuilder.getFinishedBeziers())
-        {
-            bezier.drawControlPoints(shader);
-            bezier.drawGeneratedCurve(shader);
-            if (bezier.getShowConvexHull())
-                bezier.drawConvexHull(shader);
-        }
+                previewStream.flush(shader);
+            }
 
-        // Draw bziers sequences
-        for (const auto& bezierSequence : polybuilder.getFinishedBezierSequences())
-        {
-            bezierSequence.draw(shader);
-        }
+            // Curves go on top of the previews, like they always did
+            sceneRenderer.drawCurves(polybuilder, shader);
 
-        polybuilder.drawIntersectionMarkers(shader);
+            polybuilder.drawIntersectionMarkers(markerShader);
 
-        // ImGui Rendering
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            // ImGui Rendering
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
-        // Swap buffers
-        glfwSwapBuffers(window);
+            // Swap buffers
+            glfwSwapBuffers(window);
+        }
     }
 
+    // The global PolyBuilder outlives main, its markers and fills can't wait for that
+    polybuilder.releaseGL();
+
     // Clean up ImGui
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();